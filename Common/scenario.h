@@ -0,0 +1,608 @@
+// Escenario compartido por sdwn.cc y no_sdwn.cc (se copia junto a ellos en scratch/): la
+// descripción declarativa de una corrida (ScenarioSpec, leída de un archivo con --scenario),
+// la parte común de la topología (movilidad de las STAs, canal y PHY realistas), el resumen
+// por STA y el CSV por flujo. Cada programa traduce el ScenarioSpec a sus propias variables;
+// lo único que cambia entre ellos es el AP.
+#ifndef SDWN_SCENARIO_H
+#define SDWN_SCENARIO_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// *********************************************************************************
+// ********************************* ScenarioSpec **********************************
+// *********************************************************************************
+// Formato "clave = valor" ('#' comenta el resto de la línea). Las claves de cada clase de STA
+// van bajo [H], [M], [L] o [NRT] (VO, VI, BE, BK). Las claves ausentes conservan el valor que ya
+// tenga el ScenarioSpec, así que un barrido fija en el archivo lo común y varía el resto por
+// línea de comandos o manifest:
+//
+//   packetSize = 512        timeMin = 10        mobility = mixer      # no | yes | mixer
+//   radio = 50              delayBetweenStartsMs = 25                 apMode = pofi   # plain | pofi
+//   realistic = true        seed = 0            run = 1               category = SDWN_EDCA
+//   [H]
+//   stas = 15   cwMin = 3   cwMax = 7   aifsn = 2   ampdu = 8192   interval = 1   tos = 0xe0
+struct StaClassSpec {
+    uint32_t stas = 0;
+    uint32_t cwMin = 15;
+    uint32_t cwMax = 1023;
+    uint32_t aifsn = 2;
+    uint32_t ampduSize = 0;         // MaxAmpduSize de la AC en bytes
+    uint32_t intervalS = 1;         // Intervalo entre ecos
+    uint32_t tos = 0;
+};
+
+struct ScenarioSpec {
+    static constexpr std::array<const char*, 4> CLASSES {{"H", "M", "L", "NRT"}};
+    static constexpr std::array<const char*, 4> ACS {{"VO", "VI", "BE", "BK"}};
+
+    std::array<StaClassSpec, 4> classes;
+    uint32_t packetSize = 512;
+    double timeMin = 10.0;
+    double radio = 50.0;
+    double delayBetweenStartsMs = 25.0;
+    std::string mobility = "mixer";
+    std::string apMode = "pofi";        // "plain" (DCF sin QoS + eco UDP) o "pofi" (PoFiAp + KDNController)
+    bool realistic = true;
+    uint32_t rngSeed = 0;
+    uint32_t run = 1;
+    std::string category;
+
+    uint32_t TotalStas() const {
+        return classes[0].stas + classes[1].stas + classes[2].stas + classes[3].stas;
+    }
+
+    // Clase de la STA de índice global sta: las classes[0].stas primeras son H, luego M, L y NRT
+    uint32_t ClassOf(uint32_t sta) const {
+        uint32_t p = 0;
+        while (p < 3 && sta >= classes[p].stas) {
+            sta -= classes[p].stas;
+            p++;
+        }
+        return p;
+    }
+};
+
+inline bool LoadScenarioFile(const std::string& path, ScenarioSpec& spec, std::string& error) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = "no se pudo abrir el escenario: " + path;
+        return false;
+    }
+
+    const std::map<std::string, uint32_t*> counts = {
+        {"packetSize", &spec.packetSize}, {"seed", &spec.rngSeed}, {"run", &spec.run}
+    };
+    const std::map<std::string, double*> reals = {
+        {"timeMin", &spec.timeMin}, {"radio", &spec.radio}, {"delayBetweenStartsMs", &spec.delayBetweenStartsMs}
+    };
+    const std::map<std::string, std::string*> words = {
+        {"mobility", &spec.mobility}, {"apMode", &spec.apMode}, {"category", &spec.category}
+    };
+    const std::map<std::string, uint32_t StaClassSpec::*> classKeys = {
+        {"stas", &StaClassSpec::stas}, {"cwMin", &StaClassSpec::cwMin}, {"cwMax", &StaClassSpec::cwMax},
+        {"aifsn", &StaClassSpec::aifsn}, {"ampdu", &StaClassSpec::ampduSize},
+        {"interval", &StaClassSpec::intervalS}, {"tos", &StaClassSpec::tos}
+    };
+
+    auto trim = [](std::string text) {
+        text.erase(0, text.find_first_not_of(" \t\r"));
+        text.erase(text.find_last_not_of(" \t\r") + 1);
+        return text;
+    };
+
+    StaClassSpec* section = nullptr;            // nullptr = claves generales
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        const std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+        if (line.front() == '[' && line.back() == ']') {
+            const std::string name = trim(line.substr(1, line.size() - 2));
+            auto it = std::find(ScenarioSpec::CLASSES.begin(), ScenarioSpec::CLASSES.end(), name);
+            if (it == ScenarioSpec::CLASSES.end()) {
+                error = where + "clase de STA desconocida [" + name + "] (H, M, L o NRT)";
+                return false;
+            }
+            section = &spec.classes[it - ScenarioSpec::CLASSES.begin()];
+            continue;
+        }
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = where + "se esperaba 'clave = valor'";
+            return false;
+        }
+        const std::string key = trim(line.substr(0, eq));
+        const std::string value = trim(line.substr(eq + 1));
+
+        try {
+            if (section) {
+                auto it = classKeys.find(key);
+                if (it == classKeys.end()) {
+                    error = where + "clave de clase desconocida: " + key;
+                    return false;
+                }
+                section->*(it->second) = static_cast<uint32_t>(std::stoul(value, nullptr, 0));    // tos admite 0x..
+            } else if (auto it = counts.find(key); it != counts.end()) {
+                *it->second = static_cast<uint32_t>(std::stoul(value));
+            } else if (auto it = reals.find(key); it != reals.end()) {
+                *it->second = std::stod(value);
+            } else if (auto it = words.find(key); it != words.end()) {
+                *it->second = value;
+            } else if (key == "realistic") {
+                if (value != "true" && value != "false" && value != "1" && value != "0") {
+                    error = where + "realistic debe ser true o false";
+                    return false;
+                }
+                spec.realistic = value == "true" || value == "1";
+            } else {
+                error = where + "clave desconocida: " + key;
+                return false;
+            }
+        } catch (const std::exception&) {
+            error = where + "valor inválido para " + key + ": " + value;
+            return false;
+        }
+    }
+
+    if (spec.mobility != "yes" && spec.mobility != "no" && spec.mobility != "mixer") {
+        error = path + ": mobility debe ser 'yes', 'no' o 'mixer'";
+        return false;
+    }
+    if (spec.apMode != "plain" && spec.apMode != "pofi") {
+        error = path + ": apMode debe ser 'plain' o 'pofi'";
+        return false;
+    }
+    for (uint32_t p = 0; p < spec.classes.size(); ++p) {
+        const StaClassSpec& cls = spec.classes[p];
+        if (cls.cwMin > cls.cwMax || cls.intervalS == 0 || cls.tos > 0xff) {
+            error = path + ": clase " + ScenarioSpec::CLASSES[p] + " con cwMin > cwMax, interval = 0 o tos > 0xff";
+            return false;
+        }
+    }
+    return true;
+}
+
+// *********************************************************************************
+// ****************************** TOPOLOGÍA COMÚN **********************************
+// *********************************************************************************
+// STAs en un disco de 0.6 * radio alrededor de center (el AP de su celda, o el origen)
+inline void SetupMobility(ns3::NodeContainer& wifiStaNodes, double radio, uint32_t RngSeed,
+                          const std::string& mobilityType, const ns3::Vector& center) {
+    using namespace ns3;
+
+    uint32_t fixedSeed = 42;
+    double Radio = 0.6 * radio;
+    // Margen de seguridad para evitar que NS_ASSERT falle por precisión decimal
+    double epsilon = 0.1;
+
+    Ptr<UniformRandomVariable> randVar = CreateObject<UniformRandomVariable>();
+    randVar->SetStream(fixedSeed);
+
+    MobilityHelper mobility;
+
+    if (mobilityType == "no") {
+        std::cout << "Configurando las STAs como fijas (Disco)\n";
+        mobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
+                  "rho", DoubleValue(Radio),
+                  "X", DoubleValue(center.x),
+                  "Y", DoubleValue(center.y));
+        mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+        mobility.Install(wifiStaNodes);
+
+    } else if (mobilityType == "yes") {
+        std::cout << "Configurando las STAs como moviles (Caminata Humana)\n";
+
+        mobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
+                  "rho", DoubleValue(Radio),
+                  "X", DoubleValue(center.x),
+                  "Y", DoubleValue(center.y));
+
+        // CORRECCIÓN: Expandimos los Bounds ligeramente (+ epsilon)
+        mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
+                    "Bounds", RectangleValue(Rectangle(center.x - Radio - epsilon, center.x + Radio + epsilon,
+                                                       center.y - Radio - epsilon, center.y + Radio + epsilon)),
+                    "Distance", DoubleValue(1.5),
+                    "Speed", StringValue("ns3::UniformRandomVariable[Min=1.0|Max=1.3]"),
+                    "Time", TimeValue(Seconds(2.0)),
+                    "Mode", StringValue("Time"));
+
+        mobility.Install(wifiStaNodes);
+
+    } else if (mobilityType == "mixer") {
+        uint32_t totalNodes = wifiStaNodes.GetN();
+        uint32_t maxMobileNodes = totalNodes * 0.2;
+        uint32_t mobileCount = 0;
+
+        std::cout << "Configurando mezcla: Máximo " << maxMobileNodes << " móviles (20%)\n";
+
+        // Las primeras maxMobileNodes STAs son móviles y el resto fijas: un helper por grupo
+        NodeContainer mobileNodes;
+        NodeContainer fixedNodes;
+        for (uint32_t i = 0; i < totalNodes; ++i) {
+            if (mobileCount < maxMobileNodes) {
+                mobileCount++;
+                mobileNodes.Add(wifiStaNodes.Get(i));
+            } else {
+                fixedNodes.Add(wifiStaNodes.Get(i));
+            }
+        }
+
+        MobilityHelper mobileMobility;
+        mobileMobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
+                  "rho", DoubleValue(Radio),
+                  "X", DoubleValue(center.x),
+                  "Y", DoubleValue(center.y));
+
+        // CORRECCIÓN: Expandimos los Bounds aquí también
+        mobileMobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
+                              "Bounds", RectangleValue(Rectangle(center.x - Radio - epsilon, center.x + Radio + epsilon,
+                                               center.y - Radio - epsilon, center.y + Radio + epsilon)),
+                              "Distance", DoubleValue(1.0),
+                              "Speed", StringValue("ns3::UniformRandomVariable[Min=1.0|Max=1.3]"),
+                              "Time", TimeValue(Seconds(2.0)));
+        mobileMobility.Install(mobileNodes);
+
+        MobilityHelper fixedMobility;
+        fixedMobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
+                  "rho", DoubleValue(Radio),
+                  "X", DoubleValue(center.x),
+                  "Y", DoubleValue(center.y));
+
+        fixedMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+        fixedMobility.Install(fixedNodes);
+    } else {
+        NS_FATAL_ERROR("Error: mobilityType '" << mobilityType << "' no es válido.");
+    }
+}
+
+// Canal realista: retardo de propagación constante y, con lossModels, log-distance + Nakagami
+// (sdwn.cc con lossCache los crea él mismo dentro de CachedPropagationLossModel)
+inline void ConfigureRealisticChannel(ns3::YansWifiChannelHelper& wifiChannel, bool lossModels) {
+    using namespace ns3;
+
+    // Configuración del canal con modelo realista
+    wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+    if (!lossModels) {
+        return;
+    }
+
+    // Modelo de pérdida por distancia
+    wifiChannel.AddPropagationLoss("ns3::LogDistancePropagationLossModel",
+                                "Exponent", DoubleValue(3.0),
+                                "ReferenceLoss", DoubleValue(46.6777));
+
+    // Modelo de desvanecimiento Nakagami (se encadena al anterior)
+    wifiChannel.AddPropagationLoss("ns3::NakagamiPropagationLossModel");
+}
+
+// Configuración realista para 802.11n en 5 GHz
+inline void ConfigureRealisticPhy(ns3::YansWifiPhyHelper& wifiPhy) {
+    using namespace ns3;
+
+    wifiPhy.Set("TxPowerStart", DoubleValue(16.0));
+    wifiPhy.Set("TxPowerEnd", DoubleValue(16.0));
+
+    // Agregar try-catch para compatibilidad
+    try {
+        wifiPhy.Set("RxNoiseFigure", DoubleValue(7.0));
+        wifiPhy.Set("RxGain", DoubleValue(0.0));
+        wifiPhy.Set("TxGain", DoubleValue(0.0));
+        wifiPhy.Set("CcaEdThreshold", DoubleValue(-62.0));
+    } catch (std::exception& e) {
+        std::cout << "Nota: Algunos atributos no disponibles en esta versión de NS3\n";
+    }
+}
+
+// Resumen de la STA index por consola. Sin QoS (apMode=plain y no_sdwn.cc) el MAC solo crea el
+// Txop DCF, no los <AC>_Txop, así que se informa ese en lugar de la EDCAF de la AC
+inline void Sta_Information(uint32_t index, uint32_t tosValue, const std::string& ac,
+                            const ns3::Ipv4InterfaceContainer& staInterfaces,
+                            const ns3::NetDeviceContainer& wifiStaDevices) {
+    using namespace ns3;
+
+    // Obtener la dirección IP del nodo
+    Ipv4Address ip = staInterfaces.GetAddress(index);
+
+    // Obtener la dirección MAC del nodo
+    Ptr<WifiNetDevice> wifiStaDevice = DynamicCast<WifiNetDevice>(wifiStaDevices.Get(index));
+    Mac48Address macAddress = Mac48Address::ConvertFrom(wifiStaDevice->GetAddress());
+
+    Ptr<WifiMac> macLayer = wifiStaDevice->GetMac();
+    Ptr<Txop> txop;
+    std::string AC = "DCF";
+
+    if (macLayer->GetQosSupported()) {
+        // Configuración de TXOP según la categoría de acceso (AC)
+        PointerValue ptr;
+        macLayer->GetAttribute(ac + "_Txop", ptr);
+        Ptr<QosTxop> edca = ptr.Get<QosTxop>();
+
+        // Extraer el valor AC (Access Category) asociado.
+        switch (edca->GetAccessCategory()) {
+            case AC_BE: AC = "AC_BE"; break;
+            case AC_BK: AC = "AC_BK"; break;
+            case AC_VI: AC = "AC_VI"; break;
+            case AC_VO: AC = "AC_VO"; break;
+            default: break;
+        }
+        txop = edca;
+    } else {
+        txop = macLayer->GetTxop();
+    }
+
+    // Imprimir los valores
+    std::cout << "Device " << index + 1 << " : "
+              << "IP: " << ip << ", "
+              << "Tos: 0x" << std::hex << tosValue << std::dec << ", "
+              << "AC: " << AC << ", "
+              << "Max CW: " << txop->GetMaxCw(0) << ", "
+              << "Min CW: " << txop->GetMinCw(0) << ", "
+              << "Txop Limit: " << txop->GetTxopLimit(0) << ", "
+              << "MAC: " << macAddress << std::endl;
+}
+
+// *********************************************************************************
+// ******************************* RESULTADOS POR FLUJO ****************************
+// *********************************************************************************
+// Contadores por flujo que consume WriteFlowResults (subconjunto de FlowMonitor::FlowStats).
+// sdwn.cc los toma de su sonda ligera; con FlowMonitor salen de CollectFlowMonitorRecords.
+struct FlowRecord {
+    uint32_t flowId = 0;
+    ns3::Ipv4Address source;
+    ns3::Ipv4Address destination;
+    uint8_t protocol = 0;
+    uint32_t txPackets = 0;
+    uint32_t rxPackets = 0;
+    uint32_t lostPackets = 0;
+    uint64_t txBytes = 0;
+    uint64_t rxBytes = 0;
+    ns3::Time delaySum;
+    ns3::Time timeFirstTxPacket;
+    ns3::Time timeLastRxPacket;
+};
+
+inline std::vector<FlowRecord> CollectFlowMonitorRecords(ns3::Ptr<ns3::FlowMonitor> flowMonitor,
+                                                         ns3::Ptr<ns3::Ipv4FlowClassifier> classifier) {
+    std::vector<FlowRecord> records;
+    for (const auto& flow : flowMonitor->GetFlowStats()) {
+        ns3::Ipv4FlowClassifier::FiveTuple flowClass = classifier->FindFlow(flow.first);
+        FlowRecord record;
+        record.flowId = flow.first;
+        record.source = flowClass.sourceAddress;
+        record.destination = flowClass.destinationAddress;
+        record.protocol = flowClass.protocol;
+        record.txPackets = flow.second.txPackets;
+        record.rxPackets = flow.second.rxPackets;
+        record.lostPackets = flow.second.lostPackets;
+        record.txBytes = flow.second.txBytes;
+        record.rxBytes = flow.second.rxBytes;
+        record.delaySum = flow.second.delaySum;
+        record.timeFirstTxPacket = flow.second.timeFirstTxPacket;
+        record.timeLastRxPacket = flow.second.timeLastRxPacket;
+        records.push_back(record);
+    }
+    return records;
+}
+
+// Escenario de la corrida tal como aparece en cada fila del CSV (CW ya resueltos, p. ej. por el RF)
+struct FlowRunInfo {
+    std::string category;
+    uint32_t packetSize = 0;
+    std::array<uint32_t, 4> stas {};    // H, M, L, NRT
+    std::array<uint32_t, 4> cwMin {};
+    std::array<uint32_t, 4> cwMax {};
+    uint32_t run = 1;
+    uint32_t seed = 0;
+    std::string mobility;
+
+    uint32_t TotalStas() const {
+        return stas[0] + stas[1] + stas[2] + stas[3];
+    }
+};
+
+struct FlowCsvOptions {
+    bool writeCsv = true;           // false: solo métricas y consola (p. ej. salida binaria de sdwn.cc)
+    std::string batchPath;          // No vacío: CSV único por lotes (append, Run/Seed/MobilityType por fila, sin resumen)
+    uint32_t logEvery = 1;          // Flujos por consola: uno de cada logEvery (0 = ninguno)
+};
+
+// Métricas por flujo (en el orden de los FlowRecord) y "Resumen General" de la corrida
+struct FlowResults {
+    std::vector<double> throughputKbps;
+    std::vector<double> delayMs;
+    double totalThroughputKbps = 0.0;
+    double averageDelayMs = 0.0;
+    double stddevDelayMs = 0.0;
+    double lossRatePct = 0.0;
+    double maxThroughputKbps = 0.0;
+    uint32_t maxFlowId = 0;
+    uint32_t totalSent = 0;
+    uint32_t totalReceived = 0;
+    uint32_t totalLost = 0;
+};
+
+// CSV por corrida: scratch/Estadisticas/<category>/1S/<PacketSize>/<nStaWifi>/
+inline std::string FlowCsvPath(const FlowRunInfo& info) {
+    const std::string packetsize = std::to_string(info.packetSize);
+    const std::string nSta = std::to_string(info.TotalStas());
+    const std::string filepath_statistics = "scratch/Estadisticas/" + info.category + "/1S/" + packetsize + "/" + nSta + "/";
+    std::filesystem::create_directories(filepath_statistics);
+
+    auto joined = [](const std::array<uint32_t, 4>& cw) {
+        return std::to_string(cw[0]) + "-" + std::to_string(cw[1]) + "-" + std::to_string(cw[2]) + "-" + std::to_string(cw[3]);
+    };
+    const std::string filename = info.category + "_" + nSta + "STA_" + packetsize + "B_" + "CWMin(" + joined(info.cwMin) + ")"
+                                 + "_CWMax(" + joined(info.cwMax) + ")" + "_Mobility_" + info.mobility + "_Run" + std::to_string(info.run);
+    return filepath_statistics + filename + ".csv";
+}
+
+// Calcula las métricas de cada flujo, escribe el CSV (por corrida o por lotes) y muestra el
+// resumen por consola. Devuelve false si no se pudo abrir el CSV.
+inline bool WriteFlowResults(const std::vector<FlowRecord>& stats, const FlowRunInfo& info,
+                             const FlowCsvOptions& options, FlowResults& results) {
+    // Variables para métricas agregadas
+    double totalDelay = 0.0;
+    double latencySum = 0.0;
+    double latencySquaredSum = 0.0;
+    results = FlowResults();
+
+    // Por lotes: un único CSV para todas las corridas, con Run/Seed por fila y sin resumen
+    const bool batch = !options.batchPath.empty();
+    const std::string csvFilename = batch ? options.batchPath : FlowCsvPath(info);
+    const bool writeHeader = !batch || !std::filesystem::exists(csvFilename) || std::filesystem::file_size(csvFilename) == 0;
+
+    std::ofstream csvFile;
+    if (options.writeCsv) {
+        csvFile.open(csvFilename, batch ? std::ios::app : std::ios::trunc);
+        if (!csvFile.is_open()) {
+            std::cerr << "Error: no se pudo abrir el archivo CSV: " << csvFilename << std::endl;
+            return false;
+        }
+    }
+
+    // Encabezados CSV
+    if (options.writeCsv && writeHeader) {
+        csvFile << "FlowID,Packet Size,nStaWifi,nStaH,nStaM,nStaL,nStaNRT,CWminH,CWmaxH,CWminM,CWmaxM,CWminL,CWmaxL,CWminNRT,CWmaxNRT,SourceAddress,DestAddress,Throughput(Kbps),Delay(ms),LostPackets,SentPackets,ReceivedPackets"
+                << (batch ? ",Run,Seed,MobilityType" : "") << "\n";
+    }
+
+    // Procesar cada flujo
+    for (const FlowRecord& flowStats : stats) {
+        const uint32_t flowId = flowStats.flowId;
+
+        // Calcular throughput
+        double throughput = 0.0;
+        if (flowStats.timeLastRxPacket > flowStats.timeFirstTxPacket) {
+            throughput = (flowStats.rxBytes * 8.0) /
+                         (flowStats.timeLastRxPacket.GetSeconds() - flowStats.timeFirstTxPacket.GetSeconds()) /
+                         1000; // Kbps
+        }
+
+        // Calcular delay
+        double delay = (flowStats.rxPackets > 0) ? (flowStats.delaySum.GetSeconds() / flowStats.rxPackets) : 0.0;
+
+        // Actualizar métricas agregadas
+        results.totalThroughputKbps += throughput;
+        totalDelay += delay * flowStats.rxPackets;
+        results.totalLost += flowStats.lostPackets;
+        results.totalSent += flowStats.txPackets;
+        results.totalReceived += flowStats.rxPackets;
+
+        // Actualizar métricas avanzadas
+        if (throughput > results.maxThroughputKbps) {
+            results.maxThroughputKbps = throughput;
+            results.maxFlowId = flowId;
+        }
+
+        latencySum += delay;
+        latencySquaredSum += delay * delay;
+
+        results.throughputKbps.push_back(throughput);
+        results.delayMs.push_back(delay * 1000);
+        double packetLoss = (flowStats.txPackets > 0) ?
+                            (double)flowStats.lostPackets / flowStats.txPackets * 100 : 0.0;
+
+        // Escribir en CSV
+        if (options.writeCsv) {
+            csvFile << flowId << ","
+                    << info.packetSize << ","
+                    << info.TotalStas() << ","
+                    << info.stas[0] << ","
+                    << info.stas[1] << ","
+                    << info.stas[2] << ","
+                    << info.stas[3] << ","
+                    << info.cwMin[0] << ","
+                    << info.cwMax[0] << ","
+                    << info.cwMin[1] << ","
+                    << info.cwMax[1] << ","
+                    << info.cwMin[2] << ","
+                    << info.cwMax[2] << ","
+                    << info.cwMin[3] << ","
+                    << info.cwMax[3] << ","
+                    << flowStats.source << ","
+                    << flowStats.destination << ","
+                    << std::fixed << std::setprecision(2) << throughput << ","
+                    << delay * 1000 << ","
+                    << flowStats.lostPackets << ","
+                    << flowStats.txPackets << ","
+                    << flowStats.rxPackets;
+            if (batch) {
+                csvFile << "," << info.run << "," << info.seed << "," << info.mobility;
+            }
+            csvFile << "\n";
+        }
+
+        // Mostrar por consola (uno de cada logEvery flujos; nada con 0)
+        if (options.logEvery == 0 || flowId % options.logEvery != 0) {
+            continue;
+        }
+        std::cout << "Flujo ID: " << flowId
+                  << ", Protocolo: " << static_cast<uint32_t>(flowStats.protocol)
+                  << ", Desde: " << flowStats.source
+                  << ", Hacia: " << flowStats.destination
+                  << "\n\tTasa de transferencia: " << throughput << " Kbps"
+                  << "\n\tLatencia promedio: " << delay * 1000 << " ms"
+                  << "\n\tPérdida de paquetes: " << flowStats.lostPackets << " ("
+                  << packetLoss << "%)"
+                  << "\n\tPaquetes enviados: " << flowStats.txPackets
+                  << "\n\tPaquetes recibidos: " << flowStats.rxPackets << "\n";
+    }
+
+    // Cálculos finales
+    double averageDelay = results.totalReceived > 0 ? totalDelay / results.totalReceived : 0.0;
+    double meanLatency = stats.size() > 0 ? latencySum / stats.size() : 0.0;
+    double variance = stats.size() > 0 ? (latencySquaredSum / stats.size()) - (meanLatency * meanLatency) : 0.0;
+    results.averageDelayMs = averageDelay * 1000;
+    results.stddevDelayMs = std::sqrt(variance) * 1000;
+    results.lossRatePct = results.totalSent > 0 ? (double)results.totalLost / results.totalSent * 100 : 0.0;
+
+    // Escribir resumen en CSV
+    if (options.writeCsv && !batch) {
+        csvFile << "\nResumen General\n";
+        csvFile << "Metrica,Valor\n";
+        csvFile << "Tasa de transferencia total (Kbps)," << results.totalThroughputKbps << "\n";
+        csvFile << "Latencia promedio (ms)," << results.averageDelayMs << "\n";
+        csvFile << "Desviación estándar latencia (ms)," << results.stddevDelayMs << "\n";
+        csvFile << "Porcentaje de pérdida de paquetes (%)," << results.lossRatePct << "\n";
+        csvFile << "Tasa de transferencia máxima (Kbps)," << results.maxThroughputKbps << "\n";
+        csvFile << "Flujo con máximo throughput," << results.maxFlowId << "\n";
+        csvFile << "Total paquetes enviados," << results.totalSent << "\n";
+        csvFile << "Total paquetes recibidos," << results.totalReceived << "\n";
+        csvFile << "Total paquetes perdidos," << results.totalLost << "\n";
+    }
+
+    // Mostrar resumen por consola
+    std::cout << "\nResumen General:\n";
+    std::cout << "Tasa de transferencia total: " << results.totalThroughputKbps << " Kbps\n";
+    std::cout << "Latencia promedio: " << results.averageDelayMs << " ms\n";
+    std::cout << "Desviación estándar de la latencia: " << results.stddevDelayMs << " ms\n";
+    std::cout << "Porcentaje de pérdida de paquetes: " << results.lossRatePct << " %\n";
+    std::cout << "Tasa de transferencia máxima: " << results.maxThroughputKbps << " Kbps (Flujo ID: " << results.maxFlowId << ")\n";
+    std::cout << "Total paquetes enviados: " << results.totalSent << "\n";
+    std::cout << "Total paquetes recibidos: " << results.totalReceived << "\n";
+    std::cout << "Total paquetes perdidos: " << results.totalLost << "\n";
+    return true;
+}
+
+#endif
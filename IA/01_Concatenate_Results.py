@@ -24,6 +24,72 @@ def assign_priorities(df, nStaH, nStaM, nStaL):
     return priority_list
 
 
+# --- Esquema de los archivos binarios columnares .sdwncol (ver sdwn.cc, ColumnarRunHeader) ---
+COLUMNAR_HEADER = np.dtype([
+    ("magic", "S4"), ("version", "<u4"), ("blockBytes", "<u4"), ("nFlows", "<u4"),
+    ("run", "<u4"), ("seed", "<u4"), ("packetSize", "<u4"), ("nStaWifi", "<u4"),
+    ("nSta", "<u4", (4,)), ("cw", "<u4", (8,)), ("mobility", "<u4"), ("maxFlowId", "<u4"),
+    ("totalSent", "<u4"), ("totalReceived", "<u4"), ("totalLost", "<u4"), ("reserved", "<u4"),
+    ("totalThroughputKbps", "<f8"), ("averageDelayMs", "<f8"), ("stddevDelayMs", "<f8"),
+    ("lossRatePct", "<f8"), ("maxThroughputKbps", "<f8"),
+])
+CW_COLUMNS = ["CWminH", "CWmaxH", "CWminM", "CWmaxM", "CWminL", "CWmaxL", "CWminNRT", "CWmaxNRT"]
+PRIORITIES = np.array(["HIGH", "MEDIUM", "LOW", "NRT"])
+
+
+def ipv4_to_str(values):
+    return [f"{v >> 24}.{(v >> 16) & 255}.{(v >> 8) & 255}.{v & 255}" for v in values.tolist()]
+
+
+def read_columnar(file_path):
+    """
+    Lee un archivo .sdwncol con un único memmap y devuelve las filas de las STAs
+    (los primeros nStaWifi flujos de cada corrida), con las mismas columnas que los CSV.
+    """
+    raw = np.memmap(file_path, dtype=np.uint8, mode="r")
+    cols = {name: [] for name in ["FlowID", "SourceAddress", "DestAddress", "Throughput(Kbps)", "Delay(ms)",
+                                  "LostPackets", "SentPackets", "ReceivedPackets", "Priority", "RUN",
+                                  "Packet Size", "nStaWifi", "nStaH", "nStaM", "nStaL", "nStaNRT", *CW_COLUMNS]}
+    offset = 0
+    while offset + COLUMNAR_HEADER.itemsize <= raw.size:
+        h = np.frombuffer(raw, dtype=COLUMNAR_HEADER, count=1, offset=offset)[0]
+        if h["magic"] != b"SDWC" or h["version"] != 1:
+            raise ValueError(f"bloque inválido en el byte {offset}")
+        n = int(h["nFlows"])
+        k = min(n, int(h["nStaWifi"]))
+        pos = offset + COLUMNAR_HEADER.itemsize
+
+        def column(dtype):
+            nonlocal pos
+            values = np.frombuffer(raw, dtype=dtype, count=n, offset=pos)
+            pos += values.nbytes
+            return values[:k]
+
+        cols["Throughput(Kbps)"].append(column("<f8"))
+        cols["Delay(ms)"].append(column("<f8"))
+        cols["FlowID"].append(column("<u4"))
+        cols["SourceAddress"].append(column("<u4"))
+        cols["DestAddress"].append(column("<u4"))
+        cols["LostPackets"].append(column("<u4"))
+        cols["SentPackets"].append(column("<u4"))
+        cols["ReceivedPackets"].append(column("<u4"))
+        cols["Priority"].append(np.repeat(PRIORITIES, h["nSta"])[:k])
+        for name, value in [("RUN", h["run"]), ("Packet Size", h["packetSize"]), ("nStaWifi", h["nStaWifi"]),
+                            ("nStaH", h["nSta"][0]), ("nStaM", h["nSta"][1]),
+                            ("nStaL", h["nSta"][2]), ("nStaNRT", h["nSta"][3]),
+                            *zip(CW_COLUMNS, h["cw"])]:
+            cols[name].append(np.full(k, value))
+        offset += int(h["blockBytes"])
+
+    if not cols["FlowID"]:
+        return pd.DataFrame()
+    data = pd.DataFrame({name: np.concatenate(parts) for name, parts in cols.items()})
+    data["SourceAddress"] = ipv4_to_str(data["SourceAddress"].to_numpy())
+    data["DestAddress"] = ipv4_to_str(data["DestAddress"].to_numpy())
+    data["Source Folder"] = os.path.dirname(file_path)
+    return data
+
+
 # --- Ocultar ventana principal de Tkinter ---
 Tk().withdraw()
 
@@ -42,18 +108,21 @@ if not root_folder:
     raise Exception("No se seleccionó ninguna carpeta.")
 
 
-# --- Buscar todos los archivos CSV recursivamente ---
+# --- Buscar todos los archivos CSV y columnares recursivamente ---
 csv_files_info = []
+columnar_files = []
 
-print("🔍 Buscando archivos CSV...")
+print("🔍 Buscando archivos CSV y .sdwncol...")
 for root, dirs, files in os.walk(root_folder):
     for file in files:
-        if file.endswith(".csv"):
+        if file.endswith(".csv") and file != "All Data Results.csv":
             file_name = file[:-4]
             full_path = os.path.join(root, file)
             csv_files_info.append((file_name, full_path))
+        elif file.endswith(".sdwncol"):
+            columnar_files.append(os.path.join(root, file))
 
-print(f"📊 Se encontraron {len(csv_files_info)} archivos CSV.\n")
+print(f"📊 Se encontraron {len(csv_files_info)} archivos CSV y {len(columnar_files)} archivos .sdwncol.\n")
 
 # --- Inicializar DataFrame vacío ---
 full_data = pd.DataFrame()
@@ -96,6 +165,15 @@ for f, file_path in tqdm(csv_files_info, desc="📄 Procesando CSV", unit="archi
     except Exception as e:
         tqdm.write(f"❌ Error procesando {f}.csv: {e}")
 
+# --- Archivos columnares: un memmap por archivo, sin parsear texto ---
+for file_path in tqdm(columnar_files, desc="📦 Procesando .sdwncol", unit="archivo"):
+    try:
+        data_columnar = read_columnar(file_path)
+        if not data_columnar.empty:
+            all_filtered_dfs.append(data_columnar)
+    except Exception as e:
+        tqdm.write(f"❌ Error procesando {file_path}: {e}")
+
 # --- Concatenar una sola vez al final ---
 if all_filtered_dfs:
     print("\n📦 Consolidando datos...")
@@ -88,7 +88,8 @@ def run_simulation(params):
         f'--RngSeed={seed} '
         f'--category={CATEGORY} '
         f'--mobilityType={MOBILITY_TYPE} '
-        f'--enablePcap={"true" if ENABLE_PCAP else "false"}'
+        f'--enablePcap={"true" if ENABLE_PCAP else "false"} '
+        f'--resultsFormat=csv'
     )
 
     try:
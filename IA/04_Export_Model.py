@@ -0,0 +1,108 @@
+import os
+import struct
+import joblib
+import logging
+import numpy as np
+from collections import deque
+from tkinter import Tk, filedialog
+
+# ==============================
+# 1. CONFIGURACIÓN
+# ==============================
+# Formato binario plano (little-endian) que lee TreeEnsemble en sdwn.cc (--surrogateModel):
+#   "SDWNRF1\0" | uint32 nFeatures, nTargets, nTrees, nNodes, nLeaves
+#   nombres de features y targets (uint32 longitud + bytes UTF-8)
+#   int32 raíz de cada árbol
+#   nodos {int32 feature, int32 child, float64 threshold}: feature = -1 en hojas (child = índice
+#   de hoja); en nodos internos los hijos son contiguos (izquierdo = child, derecho = child + 1)
+#   float64 valores de hoja [nLeaves x nTargets] (espacio escalado, como predice el RF)
+#   float64 RobustScaler center/scale, PowerTransformer mean/scale/lambda [nTargets cada uno]
+MAGIC = b"SDWNRF1\0"
+NODE_DTYPE = np.dtype([('feature', '<i4'), ('child', '<i4'), ('threshold', '<f8')])
+
+logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+# ==============================
+# 2. APLANADO DE ÁRBOLES
+# ==============================
+def flatten_tree(estimator, nodes, leaves):
+    """Reordena un árbol de sklearn en anchura con los hermanos contiguos."""
+    t = estimator.tree_
+    root = len(nodes)
+    nodes.append(None)
+    queue = deque([(0, root)])
+    while queue:
+        src, dst = queue.popleft()
+        if t.children_left[src] == -1:
+            nodes[dst] = (-1, len(leaves), 0.0)
+            leaves.append(np.asarray(t.value[src][:, 0], dtype='<f8'))
+        else:
+            child = len(nodes)
+            nodes.extend([None, None])
+            # sklearn va a la izquierda si x <= threshold: el hijo es child + (x > threshold)
+            nodes[dst] = (int(t.feature[src]), child, float(t.threshold[src]))
+            queue.append((t.children_left[src], child))
+            queue.append((t.children_right[src], child + 1))
+    return root
+
+def write_strings(f, names):
+    for name in names:
+        data = str(name).encode('utf-8')
+        f.write(struct.pack('<I', len(data)))
+        f.write(data)
+
+def column_or(values, default, n):
+    return np.full(n, default, dtype='<f8') if values is None else np.asarray(values, dtype='<f8')
+
+# ==============================
+# 3. EXPORTACIÓN
+# ==============================
+def export_package(package, output_path):
+    model = package['model']
+    scaler = package['scaler']
+    pt = package['transformer']
+    features = list(package['features'])
+    targets = list(package['targets'])
+    n_targets = len(targets)
+
+    nodes, leaves, roots = [], [], []
+    for estimator in model.estimators_:
+        roots.append(flatten_tree(estimator, nodes, leaves))
+
+    pt_scaler = pt._scaler if getattr(pt, 'standardize', False) else None
+    tail = [
+        column_or(scaler.center_, 0.0, n_targets),
+        column_or(scaler.scale_, 1.0, n_targets),
+        column_or(None if pt_scaler is None else pt_scaler.mean_, 0.0, n_targets),
+        column_or(None if pt_scaler is None else pt_scaler.scale_, 1.0, n_targets),
+        np.asarray(pt.lambdas_, dtype='<f8'),
+    ]
+
+    with open(output_path, 'wb') as f:
+        f.write(MAGIC)
+        f.write(struct.pack('<5I', len(features), n_targets, len(roots), len(nodes), len(leaves)))
+        write_strings(f, features)
+        write_strings(f, targets)
+        np.asarray(roots, dtype='<i4').tofile(f)
+        np.array(nodes, dtype=NODE_DTYPE).tofile(f)
+        np.vstack(leaves).astype('<f8').tofile(f)
+        for column in tail:
+            column.tofile(f)
+
+    size_mb = os.path.getsize(output_path) / 1e6
+    logging.info(f"✅ {len(roots)} árboles, {len(nodes)} nodos, {len(leaves)} hojas -> {output_path} ({size_mb:.1f} MB)")
+
+# ==============================
+# 4. EJECUCIÓN
+# ==============================
+if __name__ == "__main__":
+    Tk().withdraw()
+    model_path = filedialog.askopenfilename(
+        title="Selecciona el modelo optimizado (.joblib)",
+        filetypes=[("Joblib Files", "*.joblib")]
+    )
+    if not model_path:
+        raise Exception("No se seleccionó ningún modelo.")
+
+    logging.info(f"📦 Cargando modelo maestro desde: {model_path}")
+    export_package(joblib.load(model_path), os.path.splitext(model_path)[0] + ".sdwnrf")
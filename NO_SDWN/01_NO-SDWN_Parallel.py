@@ -18,6 +18,8 @@ CATEGORY = "NO-SDWN-TEST" #
 # Parámetros SDWN específicos
 MOBILITY_TYPE = "mixer"  # "yes", "no", o "mixer"
 ENABLE_PCAP = False
+AP_MODE = "plain"  # no_sdwn solo admite "plain" (DCF + eco UDP)
+LOG_LEVEL = "off"  # "off" (producción), "sampled" o "all"
 
 # Configuración de dispositivos por prioridad
 CONFIGURACION_DEVICES = {
@@ -40,6 +42,18 @@ os.makedirs(f"scratch/Estadisticas/{CATEGORY}/Logs", exist_ok=True)
 os.makedirs(f"scratch/Estadisticas/{CATEGORY}/Results_Finals/", exist_ok=True)
 CSV_FILE = f"scratch/Estadisticas/{CATEGORY}/Results_Finals/{CATEGORY}_Summary.csv"
 
+# ================================
+# ARCHIVO DE ESCENARIO (scenario.h)
+# ================================
+# Lo fijo del barrido va al archivo; lo que varía por corrida (STAs, tamaño, semilla) se pasa
+# por línea de comandos, que tiene prioridad sobre el archivo
+SCENARIO_FILE = f"scratch/Estadisticas/{CATEGORY}/{CATEGORY}.scenario"
+with open(SCENARIO_FILE, "w") as f:
+    f.write(f"category = {CATEGORY}\n")
+    f.write(f"timeMin = {TIME_SIM_MIN}\n")
+    f.write(f"mobility = {MOBILITY_TYPE}\n")
+    f.write(f"apMode = {AP_MODE}\n")
+
 # ================================
 # FUNCIÓN PARA EJECUTAR UNA SIMULACIÓN
 # ================================
@@ -61,13 +75,12 @@ def run_simulation(params):
     cmd = (
         f'{BIN_PATH} '
         f'--nStaWifi={nStaWifi} --nStaH={nStaH} --nStaM={nStaM} --nStaL={nStaL} --nStaNRT={nStaNRT} '
+        f'--scenario={SCENARIO_FILE} '
         f'--PacketSize={packet_size} '
-        f'--TimeSimulationMin={TIME_SIM_MIN} '
         f'--nCorrida={corrida} '
         f'--RngSeed={seed} '
-        f'--category={CATEGORY} '
-        f'--mobilityType={MOBILITY_TYPE} '
-        f'--enablePcap={"true" if ENABLE_PCAP else "false"}'
+        f'--enablePcap={"true" if ENABLE_PCAP else "false"} '
+        f'--logLevel={LOG_LEVEL}'
     )
 
     with open(log_path, "w") as log_file:
@@ -7,6 +7,7 @@
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/flow-monitor-module.h"
 #include "ns3/animation-interface.h"
+#include "scenario.h"                 // ScenarioSpec + topología común (compartido con sdwn.cc)
 
 #include <iomanip>
 #include <cstdlib>
@@ -25,7 +26,7 @@ uint32_t PacketSize = 512;          // Packet size in bytes
 double radio = 50.0;                // Coverage radius in meters
 uint16_t port = 8080;               // Port for UDP communication
 double TimeSimulationMin = 10.0;    // Simulation time in minutes
-uint32_t interval = 1;              // Interval between packets in seconds
+std::array<uint32_t, 4> classInterval {{1, 1, 1, 1}};   // Interval between packets in seconds per class H, M, L, NRT
 uint32_t nCorrida = 1;              // Run number
 bool enablePcap = false;            // Enable PCAP capture
 bool enableAnimation = false;       // Enable animation output
@@ -35,6 +36,7 @@ std::string category = "NO-SDWN";   // Category for file organization
 uint32_t RngSeed = 0;               // Random seed for simulation
 std::string mobilityType = "mixer";    // "yes", "no", o "mixer"
 bool model_realist = true;          // Usar modelo de propagación realista (log-distance + Nakagami)
+std::string scenarioFile = "";      // Escenario declarativo (scenario.h); la línea de comandos lo sobreescribe
 
 
 uint32_t nStaH = 3;                 // Number of High priority STAs (VO)
@@ -55,16 +57,16 @@ uint32_t CwMaxNRT = 1023;                   // CWmax NRT priority (BK)
 
 std::string AC;                                                     // Access Category
 
+std::string logLevel = "all";               // "off" (producción), "sampled" (1 de cada logEvery) o "all"
+uint32_t logEvery = 100;                    // Muestreo de la salida por flujo en modo "sampled"
+uint32_t flowLogEvery = 1;                  // Derivado de logLevel/logEvery
+
 // *********************************************************************************
 // *********************************** Functions ***********************************
 // *********************************************************************************
-void AnalyzeFlowMonitorResults(Ptr<FlowMonitor>, Ptr<Ipv4FlowClassifier>, 
-                            uint32_t , std::string , std::string , 
-                            uint8_t, uint32_t , uint32_t, uint32_t , 
-                            uint32_t , uint32_t , uint32_t , uint32_t , uint32_t, uint32_t, uint32_t, uint32_t,uint32_t);
-void SetupMobility(NodeContainer& wifiStaNodes, double radio, uint32_t RngSeed, 
-                   const std::string& mobilityType);
-void Sta_Information(uint32_t index, uint32_t tosValue,std::string ac,  Ipv4InterfaceContainer StaInterfaces, NetDeviceContainer wifiStaDevices);
+void AnalyzeFlowMonitorResults(Ptr<FlowMonitor>, Ptr<Ipv4FlowClassifier>, const ScenarioSpec&);
+ScenarioSpec ScenarioFromGlobals();
+void ApplyScenario(const ScenarioSpec& spec);
 // *********************************************************************************
 // ************************************* Main **************************************
 // *********************************************************************************
@@ -81,6 +83,7 @@ int main(int argc, char* argv[]) {
     cmd.AddValue("RngSeed", "Random seed for simulation", RngSeed);
     cmd.AddValue("category", "Category for file organization", category);
     cmd.AddValue("mobilityType", "Mobility type: yes, no, or mixer", mobilityType);
+    cmd.AddValue("scenario", "Scenario file (STA classes, traffic, mobility; apMode must be plain); command-line values override it", scenarioFile);
     
     // nStas por prioridad (si cualquiera >0 -> usamos distribución ordenada y NO iteramos devices)
     cmd.AddValue("nStaH", "Number of High priority STAs (VO)", nStaH);
@@ -97,14 +100,38 @@ int main(int argc, char* argv[]) {
     cmd.AddValue("enablePcap", "Enable PCAP capture", enablePcap);
     cmd.AddValue("enableAnimation", "Enable animation output", enableAnimation);
     cmd.AddValue("enableXml", "Enable XML flow monitor output", enableXml);
+    cmd.AddValue("logLevel", "Logging: off (production), sampled (every logEvery-th flow) or all", logLevel);
+    cmd.AddValue("logEvery", "Per-flow console output sampling period in sampled mode", logEvery);
     
     cmd.Parse(argc, argv);
+
+    // Escenario declarativo: el archivo es la base y se vuelve a aplicar la línea de comandos encima
+    if (!scenarioFile.empty()) {
+        ScenarioSpec spec = ScenarioFromGlobals();
+        std::string error;
+        if (!LoadScenarioFile(scenarioFile, spec, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        if (spec.apMode != "plain") {
+            std::cerr << "Error: no_sdwn solo implementa apMode=plain (el PoFiAp está en sdwn.cc)\n";
+            return 1;
+        }
+        ApplyScenario(spec);
+        cmd.Parse(argc, argv);
+    }
+    const ScenarioSpec scenario = ScenarioFromGlobals();
     
     // ========== VALIDAR PARÁMETRO DE MOVILIDAD ==========
     if (mobilityType != "yes" && mobilityType != "no" && mobilityType != "mixer") {
         std::cerr << "Error: mobilityType debe ser 'yes', 'no' o 'mixer'\n";
         return 1;
     }
+    if (logLevel != "off" && logLevel != "sampled" && logLevel != "all") {
+        std::cerr << "Error: logLevel debe ser 'off', 'sampled' o 'all'\n";
+        return 1;
+    }
+    flowLogEvery = (logLevel == "off") ? 0 : (logLevel == "sampled" ? std::max<uint32_t>(logEvery, 1) : 1);
     
     // ========== CONFIGURACIÓN DE SEMILLA ==========
     Time::SetResolution(Time::NS);
@@ -124,10 +151,12 @@ int main(int argc, char* argv[]) {
     std::cout << "STAs (H/M/L/NRT): " << nStaH << "/" << nStaM << "/" << nStaL << "/" << nStaNRT << "\n";
     std::cout << "PacketSize: " << PacketSize << " bytes, Time: " << TimeSimulationMin << " min, Corridas: " << (int)nCorrida << "\n";
     std::cout << "Mobility Type: " << mobilityType << "\n";
+    if (!scenarioFile.empty()) {
+        std::cout << "Scenario: " << scenarioFile << "\n";
+    }
     std::cout << "===========================================\n";
     
     // ========== CÁLCULOS ==========
-    uint32_t MaxPackets = static_cast<uint32_t>((TimeSimulationMin * 60) / interval);
     Time delayBetweenStarts = MilliSeconds(delayBetweenStartsMs);
     double simulationTimeSeconds = TimeSimulationMin * 60.0;
     
@@ -139,7 +168,7 @@ int main(int argc, char* argv[]) {
     wifiStaNodes.Create(nStaWifi);
     
     // ========== CONFIGURAR MOVILIDAD ==========
-    SetupMobility(wifiStaNodes, radio, RngSeed, mobilityType);
+    SetupMobility(wifiStaNodes, radio, RngSeed, mobilityType, Vector(0.0, 0.0, 0.0));
     
     // ========== AP FIJO EN EL CENTRO ==========
     MobilityHelper apMobility;
@@ -162,40 +191,18 @@ int main(int argc, char* argv[]) {
     // YansWifiChannelHelper wifiChannel  = YansWifiChannelHelper::Default();
     YansWifiChannelHelper wifiChannel;
     
-    if (model_realist)
-        {
-            // Configuración del canal con modelo realista
-            wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-            
-            // 2. Modelo de pérdida por distancia (Se agrega primero)
-            wifiChannel.AddPropagationLoss("ns3::LogDistancePropagationLossModel",
-                                        "Exponent", DoubleValue(3.0),
-                                        "ReferenceLoss", DoubleValue(46.6777));
-
-            // 3. Modelo de desvanecimiento Nakagami (Se encadena automáticamente al anterior)
-            wifiChannel.AddPropagationLoss("ns3::NakagamiPropagationLossModel");
-        }
+    if (model_realist) {
+        ConfigureRealisticChannel(wifiChannel, true);
+    }
 
     wifiPhy.SetChannel(wifiChannel.Create());
 
     // Configuración realista para 802.11n en 5GHz
     wifiPhy.Set("ChannelSettings", StringValue("{36, 20, BAND_5GHZ, 0}"));
     
-    if (model_realist)
-        {
-            wifiPhy.Set("TxPowerStart", DoubleValue(16.0));
-            wifiPhy.Set("TxPowerEnd", DoubleValue(16.0));
-
-            // Agregar try-catch para compatibilidad
-            try {
-                wifiPhy.Set("RxNoiseFigure", DoubleValue(7.0));
-                wifiPhy.Set("RxGain", DoubleValue(0.0));
-                wifiPhy.Set("TxGain", DoubleValue(0.0));
-                wifiPhy.Set("CcaEdThreshold", DoubleValue(-62.0));
-            } catch (std::exception& e) {
-                std::cout << "Nota: Algunos atributos no disponibles en esta versión de NS3\n";
-            }
-        }
+    if (model_realist) {
+        ConfigureRealisticPhy(wifiPhy);
+    }
         
     WifiMacHelper wifiMac;
     Ssid ssid = Ssid("NO_SDWN_NS3");
@@ -237,6 +244,8 @@ int main(int argc, char* argv[]) {
     Time startTime = Seconds(1.0);
     
     for (uint32_t i = 0; i < wifiStaNodes.GetN(); ++i) {
+        const uint32_t interval = classInterval[scenario.ClassOf(i)];
+        const uint32_t MaxPackets = static_cast<uint32_t>((TimeSimulationMin * 60) / interval);
 
         UdpEchoClientHelper echoClient(apInterface.GetAddress(0), port);
         echoClient.SetAttribute("MaxPackets", UintegerValue(MaxPackets));
@@ -251,7 +260,7 @@ int main(int argc, char* argv[]) {
         // Delay fijo entre inicio de STAs
         startTime += delayBetweenStarts;
 
-        //Sta_Information(i, staInterfaces, wifiStaDevices);
+        //Sta_Information(i, 0, "BE", staInterfaces, wifiStaDevices);
     }
     
     // ========== MONITOR DE FLUJO ==========
@@ -317,7 +326,7 @@ int main(int argc, char* argv[]) {
     }
     
     // ========== ANÁLISIS DE RESULTADOS ==========
-    AnalyzeFlowMonitorResults(flowMonitor, classifier, nStaWifi, category, std::to_string(PacketSize), nCorrida, CwMinH, CwMaxH, CwMinM, CwMaxM, CwMinL, CwMaxL, CwMinNRT, CwMaxNRT, nStaH, nStaM, nStaL, nStaNRT);
+    AnalyzeFlowMonitorResults(flowMonitor, classifier, ScenarioFromGlobals());
 
     Simulator::Destroy();
     
@@ -325,240 +334,70 @@ int main(int argc, char* argv[]) {
 }
 
 // *********************************************************************************
-// ***************************** FUNCIÓN AUXILIAR DE MOVILIDAD *********************
+// ***************************** ESCENARIO DECLARATIVO *****************************
 // *********************************************************************************
-
-void SetupMobility(NodeContainer& wifiStaNodes, double radio, uint32_t RngSeed, 
-                   const std::string& mobilityType) {
-    
-    uint32_t fixedSeed = 42; 
-    double Radio = 0.6 * radio;
-    // Margen de seguridad para evitar que NS_ASSERT falle por precisión decimal
-    double epsilon = 0.1; 
-    
-    Ptr<UniformRandomVariable> randVar = CreateObject<UniformRandomVariable>();
-    randVar->SetStream(fixedSeed);
-    
-    MobilityHelper mobility;
-
-    if (mobilityType == "no") {
-        std::cout << "Configurando las STAs como fijas (Disco)\n";
-        mobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                  "rho", DoubleValue(Radio),
-                  "X", DoubleValue(0.0),
-                  "Y", DoubleValue(0.0));
-        mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-        mobility.Install(wifiStaNodes);
-        
-    } else if (mobilityType == "yes") {
-        std::cout << "Configurando las STAs como moviles (Caminata Humana)\n";
-        
-        mobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                  "rho", DoubleValue(Radio),
-                  "X", DoubleValue(0.0),
-                  "Y", DoubleValue(0.0));
-        
-        // CORRECCIÓN: Expandimos los Bounds ligeramente (+ epsilon)
-        mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
-                    "Bounds", RectangleValue(Rectangle(-Radio - epsilon, Radio + epsilon, -Radio - epsilon, Radio + epsilon)),
-                    "Distance", DoubleValue(1.5),
-                    "Speed", StringValue("ns3::UniformRandomVariable[Min=1.0|Max=1.3]"),
-                    "Time", TimeValue(Seconds(2.0)),
-                    "Mode", StringValue("Time"));
-        
-        mobility.Install(wifiStaNodes);
-        
-    } else if (mobilityType == "mixer") {
-        uint32_t totalNodes = wifiStaNodes.GetN();
-        uint32_t maxMobileNodes = totalNodes * 0.2; 
-        uint32_t mobileCount = 0;
-        
-        std::cout << "Configurando mezcla: Máximo " << maxMobileNodes << " móviles (20%)\n";
-
-        for (uint32_t i = 0; i < totalNodes; ++i) {
-            if (mobileCount < maxMobileNodes) {
-                mobileCount++;
-                MobilityHelper mobileMobility;
-                mobileMobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                          "rho", DoubleValue(Radio), 
-                          "X", DoubleValue(0.0),
-                          "Y", DoubleValue(0.0));
-                
-                // CORRECCIÓN: Expandimos los Bounds aquí también
-                mobileMobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
-                                      "Bounds", RectangleValue(Rectangle(-Radio - epsilon, Radio + epsilon, -Radio - epsilon, Radio + epsilon)),
-                                      "Distance", DoubleValue(1.0),
-                                      "Speed", StringValue("ns3::UniformRandomVariable[Min=1.0|Max=1.3]"),
-                                      "Time", TimeValue(Seconds(2.0)));
-                
-                mobileMobility.Install(wifiStaNodes.Get(i));
-            } else {
-                MobilityHelper fixedMobility;
-                fixedMobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                          "rho", DoubleValue(Radio),
-                          "X", DoubleValue(0.0),
-                          "Y", DoubleValue(0.0));
-                
-                fixedMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-                fixedMobility.Install(wifiStaNodes.Get(i));
-            }
-        }
-    } else {
-        NS_FATAL_ERROR("Error: mobilityType '" << mobilityType << "' no es válido.");
+// SetupMobility y el canal/PHY realistas están en scenario.h (comunes con sdwn.cc). Sin QoS,
+// de cada clase solo cuentan el número de STAs y el intervalo; su EDCA y ToS no se aplican.
+ScenarioSpec ScenarioFromGlobals() {
+    const std::array<uint32_t, 4> stas {{nStaH, nStaM, nStaL, nStaNRT}};
+    ScenarioSpec spec;
+    for (uint32_t p = 0; p < 4; ++p) {
+        spec.classes[p].stas = stas[p];
+        spec.classes[p].intervalS = classInterval[p];
     }
+    spec.packetSize = PacketSize;
+    spec.timeMin = TimeSimulationMin;
+    spec.radio = radio;
+    spec.delayBetweenStartsMs = delayBetweenStartsMs;
+    spec.mobility = mobilityType;
+    spec.apMode = "plain";
+    spec.realistic = model_realist;
+    spec.rngSeed = RngSeed;
+    spec.run = nCorrida;
+    spec.category = category;
+    return spec;
 }
 
+void ApplyScenario(const ScenarioSpec& spec) {
+    const std::array<uint32_t*, 4> stas {{&nStaH, &nStaM, &nStaL, &nStaNRT}};
+    for (uint32_t p = 0; p < 4; ++p) {
+        *stas[p] = spec.classes[p].stas;
+        classInterval[p] = spec.classes[p].intervalS;
+    }
+    nStaWifi = spec.TotalStas();
+    PacketSize = spec.packetSize;
+    TimeSimulationMin = spec.timeMin;
+    radio = spec.radio;
+    delayBetweenStartsMs = spec.delayBetweenStartsMs;
+    mobilityType = spec.mobility;
+    model_realist = spec.realistic;
+    RngSeed = spec.rngSeed;
+    nCorrida = spec.run;
+    category = spec.category;
+}
 
 // *********************************************************************************
 // ***************************** FUNCIÓN DE ANÁLISIS *******************************
 // *********************************************************************************
 
-void AnalyzeFlowMonitorResults(Ptr<FlowMonitor> flowMonitor, Ptr<Ipv4FlowClassifier> classifier, uint32_t nStaWifi, std::string category, std::string packetsize, uint8_t nCorrida, uint32_t CwMinH, uint32_t CwMaxH, uint32_t CwMinM, uint32_t CwMaxM, uint32_t CwMinL, uint32_t CwMaxL, uint32_t CwMinNRT, uint32_t CwMaxNRT, uint32_t nStaH, uint32_t nStaM, uint32_t nStaL, uint32_t nStaNRT) {
-    auto stats = flowMonitor->GetFlowStats();
-
-    // Variables para métricas agregadas
-    double totalThroughput = 0.0;
-    double totalDelay = 0.0;
-    uint32_t totalLostPackets = 0;
-    uint32_t totalPacketsSent = 0;
-    uint32_t totalPacketsReceived = 0;
-    
-    // Variables para análisis avanzado
-    double maxThroughput = 0.0;
-    FlowId maxFlowId = 0;
-    double latencySum = 0.0;
-    double latencySquaredSum = 0.0;
-    
-    // Vectores para distribución
-    std::vector<double> throughputs;
-    std::vector<double> delays;
-    std::map<uint32_t, double> packetLossByFlow;
-
-    // Crear archivo CSV
-
-    // Nombre del archivo CSV con número de STAs
-    const std::string filepath_statistics = "scratch/Estadisticas/" + category + "/1S/" + packetsize+"/"+ std::to_string(nStaWifi)+"/" ;
-    fs::create_directories(filepath_statistics);
-
-    const std::string filename =  category + "_" +std::to_string(nStaWifi) + "STA_" + packetsize + "B_" +"CWMin(" + std::to_string(CwMinH) + "-" + std::to_string(CwMinM)+ "-" + std::to_string(CwMinL) + "-" + std::to_string(CwMinNRT) + ")" +"_CWMax(" + std::to_string(CwMaxH) + "-" + std::to_string(CwMaxM)+ "-" + std::to_string(CwMaxL) + "-" + std::to_string(CwMaxNRT) + ")" + "_Mobility_" + mobilityType + "_Run" + std::to_string(nCorrida);
-
-    const std::string csvFilename = filepath_statistics + filename + ".csv";        
-
-    std::ofstream csvFile(csvFilename);
-    if (!csvFile.is_open()) {
-        std::cerr << "Error: no se pudo abrir el archivo CSV: " << csvFilename << std::endl;
-        return;
-    }
-
-    // Encabezados CSV
-    csvFile << "FlowID,Packet Size,nStaWifi,nStaH,nStaM,nStaL,nStaNRT,CWminH,CWmaxH,CWminM,CWmaxM,CWminL,CWmaxL,CWminNRT,CWmaxNRT,SourceAddress,DestAddress,Throughput(Kbps),Delay(ms),LostPackets,SentPackets,ReceivedPackets\n";
-
-    // Procesar cada flujo
-    for (const auto &flow : stats) {
-        auto flowId = flow.first;
-        auto flowStats = flow.second;
-        auto flowClass = classifier->FindFlow(flowId);
-
-        // Calcular throughput
-        double throughput = 0.0;
-        if (flowStats.timeLastRxPacket > flowStats.timeFirstTxPacket) {
-            throughput = (flowStats.rxBytes * 8.0) / 
-                         (flowStats.timeLastRxPacket.GetSeconds() - flowStats.timeFirstTxPacket.GetSeconds()) / 
-                         1000; // Kbps
-        }
-
-        // Calcular delay
-        double delay = (flowStats.rxPackets > 0) ? (flowStats.delaySum.GetSeconds() / flowStats.rxPackets) : 0.0;
-
-        // Actualizar métricas agregadas
-        totalThroughput += throughput;
-        totalDelay += delay * flowStats.rxPackets;
-        totalLostPackets += flowStats.lostPackets;
-        totalPacketsSent += flowStats.txPackets;
-        totalPacketsReceived += flowStats.rxPackets;
-
-        // Actualizar métricas avanzadas
-        if (throughput > maxThroughput) {
-            maxThroughput = throughput;
-            maxFlowId = flowId;
-        }
-        
-        latencySum += delay;
-        latencySquaredSum += delay * delay;
-
-        // Almacenar para distribución
-        throughputs.push_back(throughput);
-        delays.push_back(delay);
-        packetLossByFlow[flowId] = (flowStats.txPackets > 0) ? 
-                                 (double)flowStats.lostPackets / flowStats.txPackets * 100 : 0.0;
-
-        // Escribir en CSV
-        csvFile << flowId << ","
-                << packetsize << ","
-                << nStaWifi << ","
-                << nStaH << ","
-                << nStaM << ","
-                << nStaL << ","
-                << nStaNRT << ","
-                << CwMinH << ","
-                << CwMaxH << ","
-                << CwMinM << ","
-                << CwMaxM << ","
-                << CwMinL << ","
-                << CwMaxL << ","
-                << CwMinNRT << ","
-                << CwMaxNRT << ","
-                << flowClass.sourceAddress << ","
-                << flowClass.destinationAddress << ","
-                << std::fixed << std::setprecision(2) << throughput << ","
-                << delay * 1000 << ","
-                << flowStats.lostPackets << ","
-                << flowStats.txPackets << ","
-                << flowStats.rxPackets << "\n";
-                
-        // Mostrar por consola
-        std::cout << "Flujo ID: " << flowId
-                  << ", Protocolo: " << flowClass.protocol
-                  << ", Desde: " << flowClass.sourceAddress
-                  << ", Hacia: " << flowClass.destinationAddress
-                  << "\n\tTasa de transferencia: " << throughput << " Kbps"
-                  << "\n\tLatencia promedio: " << delay * 1000 << " ms"
-                  << "\n\tPérdida de paquetes: " << flowStats.lostPackets << " (" 
-                  << packetLossByFlow[flowId] << "%)"
-                  << "\n\tPaquetes enviados: " << flowStats.txPackets
-                  << "\n\tPaquetes recibidos: " << flowStats.rxPackets << "\n";
+// Mismo CSV por flujo que sdwn.cc (WriteFlowResults en scenario.h). Sin QoS los CW no se
+// aplican; se escriben los globales CwMin*/CwMax* para conservar las columnas
+void AnalyzeFlowMonitorResults(Ptr<FlowMonitor> flowMonitor, Ptr<Ipv4FlowClassifier> classifier, const ScenarioSpec& spec) {
+    FlowRunInfo info;
+    info.category = spec.category;
+    info.packetSize = spec.packetSize;
+    for (uint32_t p = 0; p < 4; ++p) {
+        info.stas[p] = spec.classes[p].stas;
     }
+    info.cwMin = {{CwMinH, CwMinM, CwMinL, CwMinNRT}};
+    info.cwMax = {{CwMaxH, CwMaxM, CwMaxL, CwMaxNRT}};
+    info.run = spec.run;
+    info.seed = spec.rngSeed;
+    info.mobility = spec.mobility;
 
-    // Cálculos finales
-    double averageDelay = totalPacketsReceived > 0 ? totalDelay / totalPacketsReceived : 0.0;
-    double packetLossRate = totalPacketsSent > 0 ? (double)totalLostPackets / totalPacketsSent * 100 : 0.0;
-    double meanLatency = stats.size() > 0 ? latencySum / stats.size() : 0.0;
-    double variance = stats.size() > 0 ? (latencySquaredSum / stats.size()) - (meanLatency * meanLatency) : 0.0;
-    double stddevLatency = std::sqrt(variance);
-
-    // Escribir resumen en CSV
-    csvFile << "\nResumen General\n";
-    csvFile << "Metrica,Valor\n";
-    csvFile << "Tasa de transferencia total (Kbps)," << totalThroughput << "\n";
-    csvFile << "Latencia promedio (ms)," << averageDelay * 1000 << "\n";
-    csvFile << "Desviación estándar latencia (ms)," << stddevLatency * 1000 << "\n";
-    csvFile << "Porcentaje de pérdida de paquetes (%)," << packetLossRate << "\n";
-    csvFile << "Tasa de transferencia máxima (Kbps)," << maxThroughput << "\n";
-    csvFile << "Flujo con máximo throughput," << maxFlowId << "\n";
-    csvFile << "Total paquetes enviados," << totalPacketsSent << "\n";
-    csvFile << "Total paquetes recibidos," << totalPacketsReceived << "\n";
-    csvFile << "Total paquetes perdidos," << totalLostPackets << "\n";
-
-    // Mostrar resumen por consola
-    std::cout << "\nResumen General:\n";
-    std::cout << "Tasa de transferencia total: " << totalThroughput << " Kbps\n";
-    std::cout << "Latencia promedio: " << averageDelay * 1000 << " ms\n";
-    std::cout << "Desviación estándar de la latencia: " << stddevLatency * 1000 << " ms\n";
-    std::cout << "Porcentaje de pérdida de paquetes: " << packetLossRate << " %\n";
-    std::cout << "Tasa de transferencia máxima: " << maxThroughput << " Kbps (Flujo ID: " << maxFlowId << ")\n";
-    std::cout << "Total paquetes enviados: " << totalPacketsSent << "\n";
-    std::cout << "Total paquetes recibidos: " << totalPacketsReceived << "\n";
-    std::cout << "Total paquetes perdidos: " << totalLostPackets << "\n";
+    FlowCsvOptions options;
+    options.logEvery = flowLogEvery;
 
-    csvFile.close();
+    FlowResults results;
+    WriteFlowResults(CollectFlowMonitorRecords(flowMonitor, classifier), info, options, results);
 }
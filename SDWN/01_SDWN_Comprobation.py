@@ -18,6 +18,7 @@ CATEGORY = "SDWN-EDCA-TEST" # or "SDWN-EDCA-15-1023"
 # Parámetros SDWN específicos
 MOBILITY_TYPE = "mixer"  # "yes", "no", o "mixer"
 ENABLE_PCAP = False
+AP_MODE = "pofi"  # "plain" (DCF + eco UDP) o "pofi" (PoFiAp + KDNController)
 
 # Configuración de dispositivos por prioridad
 CONFIGURACION_DEVICES = {
@@ -48,6 +49,20 @@ os.makedirs(f"scratch/Estadisticas/{CATEGORY}/Logs", exist_ok=True)
 os.makedirs(f"scratch/Estadisticas/{CATEGORY}/Results_Finals/", exist_ok=True)
 CSV_FILE = f"scratch/Estadisticas/{CATEGORY}/Results_Finals/{CATEGORY}_Summary.csv"
 
+# ================================
+# ARCHIVO DE ESCENARIO (scenario.h)
+# ================================
+# Lo fijo del barrido va al archivo; lo que varía por corrida (STAs, tamaño, semilla) se pasa
+# por línea de comandos, que tiene prioridad sobre el archivo
+SCENARIO_FILE = f"scratch/Estadisticas/{CATEGORY}/{CATEGORY}.scenario"
+with open(SCENARIO_FILE, "w") as f:
+    f.write(f"category = {CATEGORY}\n")
+    f.write(f"timeMin = {TIME_SIM_MIN}\n")
+    f.write(f"mobility = {MOBILITY_TYPE}\n")
+    f.write(f"apMode = {AP_MODE}\n")
+    for clase, (cw_min, cw_max) in CW_PARAMS.items():
+        f.write(f"[{clase}]\ncwMin = {cw_min}\ncwMax = {cw_max}\n")
+
 # ================================
 # FUNCIÓN PARA EJECUTAR UNA SIMULACIÓN
 # ================================
@@ -69,17 +84,12 @@ def run_simulation(params):
     cmd = (
         f'{BIN_PATH} '
         f'--nStaWifi={nStaWifi} --nStaH={nStaH} --nStaM={nStaM} --nStaL={nStaL} --nStaNRT={nStaNRT} '
-        f'--CwMinH={CW_PARAMS["H"][0]} --CwMaxH={CW_PARAMS["H"][1]} '
-        f'--CwMinM={CW_PARAMS["M"][0]} --CwMaxM={CW_PARAMS["M"][1]} '
-        f'--CwMinL={CW_PARAMS["L"][0]} --CwMaxL={CW_PARAMS["L"][1]} '
-        f'--CwMinNRT={CW_PARAMS["NRT"][0]} --CwMaxNRT={CW_PARAMS["NRT"][1]} '
+        f'--scenario={SCENARIO_FILE} '
         f'--PacketSize={packet_size} '
-        f'--TimeSimulationMin={TIME_SIM_MIN} '
         f'--nCorrida={corrida} '
         f'--RngSeed={seed} '
-        f'--category={CATEGORY} '
-        f'--mobilityType={MOBILITY_TYPE} '
-        f'--enablePcap={"true" if ENABLE_PCAP else "false"}'
+        f'--enablePcap={"true" if ENABLE_PCAP else "false"} '
+        f'--resultsFormat=csv'
     )
 
     with open(log_path, "w") as log_file:
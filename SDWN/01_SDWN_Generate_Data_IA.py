@@ -24,9 +24,26 @@ NUM_SIMULACIONES_UNICAS = 1000  # Configuraciones únicas
 CATEGORY = "SDWN_IA"
 MOBILITY_TYPE = "mixer"  # "yes", "no", o "mixer"
 ENABLE_PCAP = False
+LOG_LEVEL = "off"  # "off" (producción), "sampled" o "all"
+METRICS_WINDOW_S = 10    # Ventana de métricas por AC en segundos simulados
+CONVERGENCE_TOL = 0.0    # >0: detener cada corrida cuando IC95/media < tol (TIME_SIM_MIN pasa a ser el máximo)
+
+# Modo por lotes: cada worker ejecuta un manifest con muchas corridas en un único proceso
+BATCH_MODE = True
+RUNS_PER_MANIFEST = 250
 
 os.makedirs(f"scratch/Estadisticas/{CATEGORY}/Logs/", exist_ok=True)
 os.makedirs(f"scratch/Estadisticas/{CATEGORY}/Results_Finals/", exist_ok=True)
+os.makedirs(f"scratch/Estadisticas/{CATEGORY}/Manifests/", exist_ok=True)
+
+# Lo fijo del barrido va al archivo de escenario (scenario.h); las STAs, CW, tamaño y semilla de
+# cada corrida siguen por línea de comandos o manifest, que tienen prioridad sobre el archivo
+SCENARIO_FILE = f"scratch/Estadisticas/{CATEGORY}/{CATEGORY}.scenario"
+with open(SCENARIO_FILE, "w") as f:
+    f.write(f"category = {CATEGORY}\n")
+    f.write(f"timeMin = {TIME_SIM_MIN}\n")
+    f.write(f"mobility = {MOBILITY_TYPE}\n")
+    f.write("apMode = pofi\n")
 CSV_FILE = f"scratch/Estadisticas/{CATEGORY}/Results_Finals/Simulations_Summary.csv"
 
 # ================================
@@ -98,13 +115,12 @@ def run_simulation(params):
         f'--CwMinM={CwMinM} --CwMaxM={CwMaxM} '
         f'--CwMinL={CwMinL} --CwMaxL={CwMaxL} '
         f'--CwMinNRT={CwMinNRT} --CwMaxNRT={CwMaxNRT} '
+        f'--scenario={SCENARIO_FILE} '
         f'--PacketSize={packet_size} '
-        f'--TimeSimulationMin={TIME_SIM_MIN} '
         f'--nCorrida={corrida} '
         f'--RngSeed={seed} '
-        f'--category={CATEGORY} '
-        f'--mobilityType={MOBILITY_TYPE} '
-        f'--enablePcap={"true" if ENABLE_PCAP else "false"}'
+        f'--enablePcap={"true" if ENABLE_PCAP else "false"} '
+        f'--logLevel={LOG_LEVEL}'
     )
 
     try:
@@ -118,6 +134,55 @@ def run_simulation(params):
     except subprocess.TimeoutExpired:
         return f"[{sim_id}] ⏰ Timeout", False
 
+# ================================
+# FUNCIÓN PARA EJECUTAR UN MANIFEST (MODO POR LOTES)
+# ================================
+MANIFEST_COLUMNS = [
+    "nStaH", "nStaM", "nStaL", "nStaNRT",
+    "CwMinH", "CwMaxH", "CwMinM", "CwMaxM",
+    "CwMinL", "CwMaxL", "CwMinNRT", "CwMaxNRT",
+    "PacketSize", "RngSeed", "nCorrida"
+]
+
+def write_manifest(batch_id, chunk):
+    manifest_path = f"scratch/Estadisticas/{CATEGORY}/Manifests/Manifest_{batch_id}.csv"
+    with open(manifest_path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(MANIFEST_COLUMNS)
+        for (sim_id, packet_size, total, dist_id, dist, cwH, cwM, cwL, cwNRT, corrida, seed) in chunk:
+            writer.writerow([*dist, *cwH, *cwM, *cwL, *cwNRT, packet_size, seed, corrida])
+    return manifest_path
+
+def run_manifest(params):
+    batch_id, manifest_path, n_runs = params
+    log_path = os.path.join(f"scratch/Estadisticas/{CATEGORY}/Logs/", f"Batch_{batch_id}.log")
+    output_path = f"scratch/Estadisticas/{CATEGORY}/Results_Finals/Batch_{batch_id}.sdwncol"
+    targets_path = f"scratch/Estadisticas/{CATEGORY}/Results_Finals/Online_Targets_{batch_id}.csv"
+
+    BIN_PATH = "./build/scratch/ns3.45-sdwn-default"
+    cmd = (
+        f'{BIN_PATH} '
+        f'--manifest={manifest_path} '
+        f'--columnarOutput={output_path} '
+        f'--onlineStatsOutput={targets_path} '
+        f'--metricsWindowS={METRICS_WINDOW_S if CONVERGENCE_TOL > 0 else 0} '
+        f'--convergenceTol={CONVERGENCE_TOL} '
+        f'--scenario={SCENARIO_FILE} '
+        f'--enablePcap={"true" if ENABLE_PCAP else "false"} '
+        f'--logLevel={LOG_LEVEL}'
+    )
+
+    try:
+        with open(log_path, "w") as log_file:
+            result = subprocess.run(cmd, shell=True, stdout=log_file, stderr=subprocess.STDOUT, timeout=600 * n_runs)
+
+        if result.returncode != 0:
+            return f"[Batch {batch_id}] ❌ Error", False
+        else:
+            return f"[Batch {batch_id}] ✅ Completado ({n_runs} corridas)", True
+    except subprocess.TimeoutExpired:
+        return f"[Batch {batch_id}] ⏰ Timeout", False
+
 # ================================
 # GENERAR TODAS LAS SIMULACIONES Y CSV
 # ================================
@@ -193,11 +258,19 @@ exitosas = 0
 fallidas = 0
 timeouts = 0
 
+if BATCH_MODE:
+    chunks = [params_list[i:i + RUNS_PER_MANIFEST] for i in range(0, len(params_list), RUNS_PER_MANIFEST)]
+    jobs = [(batch_id, write_manifest(batch_id, chunk), len(chunk)) for batch_id, chunk in enumerate(chunks, start=1)]
+    print(f"📦 {len(jobs):,} manifests de hasta {RUNS_PER_MANIFEST} corridas\n")
+    worker, tasks = run_manifest, jobs
+else:
+    worker, tasks = run_simulation, params_list
+
 with Pool(processes=num_cpus) as pool:
     # Usar imap_unordered con tqdm para mostrar progreso
     resultados = list(tqdm(
-        pool.imap_unordered(run_simulation, params_list),
-        total=len(params_list),
+        pool.imap_unordered(worker, tasks),
+        total=len(tasks),
         desc="Ejecutando simulaciones",
         unit="sim",
         colour="green"
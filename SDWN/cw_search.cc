@@ -0,0 +1,352 @@
+// Búsqueda nativa de CW sobre el modelo sustituto, en lugar del bucle Optuna de IA/Inteligen_Agent.py.
+// Carga el mismo Random Forest exportado (.sdwnrf, IA/04_Export_Model.py) que usa sdwn.cc y, por
+// escenario (Packet Size, nStaH/M/L/NRT), recorre la rejilla de CW (9 valores, CWmax > CWmin, 4 clases:
+// 36^4 = 1.679.616 puntos) por lotes repartidos entre hilos, o por descenso por coordenadas.
+//
+// Compilación (no necesita ns-3):
+//   g++ -O3 -march=native -std=c++17 -pthread SDWN/cw_search.cc -o cw_search
+// Uso:
+//   ./cw_search --model="Master_Model/Modelo Optimizado.sdwnrf" [--scenarios=escenarios.csv]
+//               [--mode=exhaustive|coordinate] [--threads=N] [--top=K] [--output=...csv]
+#include "surrogate_model.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// ===================== Parámetros =====================
+std::string model = "";                     // Modelo .sdwnrf
+std::string scenarios = "";                 // CSV con Packet Size, nStaH, nStaM, nStaL, nStaNRT (vacío = los de Inteligen_Agent.py)
+std::string mode = "exhaustive";            // "exhaustive" (rejilla completa) o "coordinate" (descenso por coordenadas)
+uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+uint32_t top = 1;                           // Mejores configuraciones por escenario
+std::string output = "AI_Optimization_Results/Optimization_CW_Search.csv";
+
+struct Scenario {
+    uint32_t packetSize;
+    std::array<uint32_t, 4> stas;           // H, M, L, NRT
+};
+
+struct Candidate {
+    SurrogateObjective::Cw cw;
+    double score;
+    std::vector<double> prediction;         // SurrogateObjective::Outputs()
+};
+
+// *********************************************************************************
+// ********************************** ESCENARIOS ***********************************
+// *********************************************************************************
+bool LoadScenarios(const std::string& path, std::vector<Scenario>& out) {
+    if (path.empty()) {
+        // Mismos escenarios que device_configs/packet_sizes de Inteligen_Agent.py
+        out = {{1024, {25, 25, 25, 25}}, {1024, {40, 30, 20, 10}}};
+        return true;
+    }
+    std::ifstream in(path);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line)) {
+        std::cerr << "Error: no se pudo leer " << path << "\n";
+        return false;
+    }
+    auto split = [](const std::string& text) {
+        std::vector<std::string> fields;
+        std::stringstream ss(text);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            field.erase(0, field.find_first_not_of(" \t\r"));
+            field.erase(field.find_last_not_of(" \t\r") + 1);
+            fields.push_back(field);
+        }
+        return fields;
+    };
+    std::vector<std::string> header = split(line);
+    std::array<int, 5> column{-1, -1, -1, -1, -1};      // Packet Size, nStaH, nStaM, nStaL, nStaNRT
+    const std::array<const char*, 5> names{"Packet Size", "nStaH", "nStaM", "nStaL", "nStaNRT"};
+    for (size_t i = 0; i < header.size(); ++i) {
+        for (size_t c = 0; c < names.size(); ++c) {
+            if (header[i] == names[c] || (c == 0 && header[i] == "PacketSize")) {
+                column[c] = int(i);
+            }
+        }
+    }
+    for (size_t c = 0; c < names.size(); ++c) {
+        if (column[c] < 0) {
+            std::cerr << "Error: falta la columna " << names[c] << " en " << path << "\n";
+            return false;
+        }
+    }
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields = split(line);
+        if (fields.empty() || fields[0].empty()) {
+            continue;
+        }
+        Scenario scenario{};
+        std::array<uint32_t, 5> values{};
+        bool valid = true;
+        for (size_t c = 0; c < names.size() && valid; ++c) {
+            if (size_t(column[c]) >= fields.size()) {
+                std::cerr << "Error: fila incompleta en " << path << ": " << line << "\n";
+                return false;
+            }
+            try {
+                values[c] = ParseUint32Field(fields[column[c]]);
+            } catch (const std::exception&) {
+                // Como las filas del manifest de sdwn.cc: se informa y se salta
+                std::cerr << "Error: fila de " << path << " con un valor no numérico (se omite): " << line << "\n";
+                valid = false;
+            }
+        }
+        if (!valid) {
+            continue;
+        }
+        scenario.packetSize = values[0];
+        scenario.stas = {values[1], values[2], values[3], values[4]};
+        out.push_back(scenario);
+    }
+    if (out.empty()) {
+        std::cerr << "Error: ningún escenario válido en " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// *********************************************************************************
+// *********************************** BÚSQUEDA ************************************
+// *********************************************************************************
+// Inserta en una lista ordenada de como mucho k candidatos
+void KeepBest(std::vector<Candidate>& best, Candidate&& candidate, uint32_t k) {
+    if (best.size() == k && candidate.score >= best.back().score) {
+        return;
+    }
+    auto it = std::upper_bound(best.begin(), best.end(), candidate.score,
+                               [](double score, const Candidate& c) { return score < c.score; });
+    best.insert(it, std::move(candidate));
+    if (best.size() > k) {
+        best.pop_back();
+    }
+}
+
+// Rejilla completa: cada hilo toma bloques de CHUNK puntos consecutivos y los evalúa en un lote
+std::vector<Candidate> SearchExhaustive(const SurrogateObjective& objective, const Scenario& scenario,
+                                        uint32_t nThreads, uint32_t k, uint64_t& evaluations) {
+    constexpr uint64_t CHUNK = 4096;
+    const uint64_t pairs = SurrogateObjective::N_PAIRS;
+    const uint64_t total = pairs * pairs * pairs * pairs;
+    const size_t nFeatures = objective.NumFeatures();
+    const size_t nOutputs = objective.Outputs().size();
+
+    std::array<std::pair<uint32_t, uint32_t>, SurrogateObjective::N_PAIRS> pairTable;
+    for (uint32_t p = 0; p < pairs; ++p) {
+        pairTable[p] = SurrogateObjective::Pair(p);
+    }
+
+    std::atomic<uint64_t> next{0};
+    std::vector<std::vector<Candidate>> perThread(nThreads);
+    auto worker = [&](uint32_t id) {
+        std::vector<float> X(CHUNK * nFeatures, 0.0f);
+        std::vector<double> Y(CHUNK * nOutputs);
+        for (uint64_t r = 0; r < CHUNK; ++r) {
+            objective.SetScenario(&X[r * nFeatures], scenario.packetSize, scenario.stas);
+        }
+        std::vector<Candidate>& best = perThread[id];
+        for (uint64_t begin = next.fetch_add(CHUNK); begin < total; begin = next.fetch_add(CHUNK)) {
+            const uint64_t rows = std::min(CHUNK, total - begin);
+            for (uint64_t r = 0; r < rows; ++r) {
+                uint64_t index = begin + r;
+                SurrogateObjective::Cw cw;
+                for (uint32_t cls = 0; cls < 4; ++cls) {
+                    std::tie(cw[2 * cls], cw[2 * cls + 1]) = pairTable[index % pairs];
+                    index /= pairs;
+                }
+                objective.SetCw(&X[r * nFeatures], cw);
+            }
+            objective.Model().PredictBatch(X.data(), rows, objective.Outputs(), Y.data());
+            for (uint64_t r = 0; r < rows; ++r) {
+                const double* y = &Y[r * nOutputs];
+                double score = SurrogateObjective::Cost(y);
+                if (best.size() < k || score < best.back().score) {
+                    Candidate candidate{{}, score, std::vector<double>(y, y + nOutputs)};
+                    uint64_t index = begin + r;
+                    for (uint32_t cls = 0; cls < 4; ++cls) {
+                        std::tie(candidate.cw[2 * cls], candidate.cw[2 * cls + 1]) = pairTable[index % pairs];
+                        index /= pairs;
+                    }
+                    KeepBest(best, std::move(candidate), k);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (uint32_t t = 0; t < nThreads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    std::vector<Candidate> best;
+    for (std::vector<Candidate>& local : perThread) {
+        for (Candidate& candidate : local) {
+            KeepBest(best, std::move(candidate), k);
+        }
+    }
+    evaluations = total;
+    return best;
+}
+
+// Descenso por coordenadas desde varios puntos de partida (uno por hilo), quedándose con los k mejores
+std::vector<Candidate> SearchCoordinate(const SurrogateObjective& objective, const Scenario& scenario,
+                                        uint32_t nThreads, uint32_t k, uint64_t& evaluations) {
+    std::vector<SurrogateObjective::Cw> starts;
+    for (uint32_t p = 0; p < SurrogateObjective::N_PAIRS && starts.size() < std::max(nThreads, k); p += 5) {
+        auto [cwMin, cwMax] = SurrogateObjective::Pair(p);
+        starts.push_back({cwMin, cwMax, cwMin, cwMax, cwMin, cwMax, cwMin, cwMax});
+    }
+
+    std::vector<CwSearchResult> results(starts.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < starts.size(); i = next.fetch_add(1)) {
+            results[i] = CoordinateSearch(objective, scenario.packetSize, scenario.stas, starts[i]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (uint32_t t = 0; t < std::min<size_t>(nThreads, starts.size()); ++t) {
+        pool.emplace_back(worker);
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    std::vector<Candidate> best;
+    evaluations = 0;
+    for (CwSearchResult& result : results) {
+        evaluations += result.evaluations;
+        bool duplicate = std::any_of(best.begin(), best.end(), [&](const Candidate& c) { return c.cw == result.cw; });
+        if (!duplicate) {
+            KeepBest(best, Candidate{result.cw, result.score, std::move(result.prediction)}, k);
+        }
+    }
+    return best;
+}
+
+// *********************************************************************************
+// ************************************* MAIN **************************************
+// *********************************************************************************
+int main(int argc, char* argv[]) {
+    // ====== Línea de comandos: --nombre=valor ======
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            std::cerr << "Error: argumento no válido '" << arg << "' (se espera --nombre=valor)\n";
+            return 1;
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        try {
+            if (name == "model") model = value;
+            else if (name == "scenarios") scenarios = value;
+            else if (name == "mode") mode = value;
+            else if (name == "threads") threads = std::max(1u, ParseUint32Field(value));
+            else if (name == "top") top = std::max(1u, ParseUint32Field(value));
+            else if (name == "output") output = value;
+            else {
+                std::cerr << "Error: parámetro desconocido --" << name << "\n";
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: --" << name << " necesita un entero sin signo (recibido '" << value << "')\n";
+            return 1;
+        }
+    }
+    if (model.empty()) {
+        std::cerr << "Uso: cw_search --model=<modelo.sdwnrf> [--scenarios=csv] [--mode=exhaustive|coordinate] "
+                     "[--threads=N] [--top=K] [--output=csv]\n";
+        return 1;
+    }
+    if (mode != "exhaustive" && mode != "coordinate") {
+        std::cerr << "Error: mode debe ser 'exhaustive' o 'coordinate'\n";
+        return 1;
+    }
+
+    TreeEnsemble ensemble;
+    SurrogateObjective objective;
+    std::string error;
+    if (!ensemble.Load(model, error) || !objective.Bind(ensemble, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    std::vector<Scenario> scenarioList;
+    if (!LoadScenarios(scenarios, scenarioList)) {
+        return 1;
+    }
+    std::cout << "[cw_search] Modelo: " << ensemble.NumTrees() << " árboles | modo " << mode
+              << " | " << threads << " hilos | " << scenarioList.size() << " escenarios\n";
+
+    // ====== Salida: mismas columnas que Optimization_CW_Final.csv, más Rank ======
+    if (fs::path(output).has_parent_path()) {
+        fs::create_directories(fs::path(output).parent_path());
+    }
+    std::ofstream csv(output);
+    if (!csv.is_open()) {
+        std::cerr << "Error: no se pudo crear " << output << "\n";
+        return 1;
+    }
+    csv << "Packet Size,nStaWifi,nStaH,nStaM,nStaL,nStaNRT,Score";
+    for (const char* cls : SurrogateObjective::CLASSES) {
+        csv << ",CWmin" << cls << ",CWmax" << cls;
+    }
+    for (const char* cls : SurrogateObjective::CLASSES) {
+        csv << ",Delay_" << cls << "_mean,Delay_" << cls << "_std,Loss_" << cls << "_pct";
+    }
+    csv << ",Rank\n";
+    csv << std::setprecision(17);
+
+    for (const Scenario& scenario : scenarioList) {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t evaluations = 0;
+        std::vector<Candidate> best = mode == "exhaustive"
+            ? SearchExhaustive(objective, scenario, threads, top, evaluations)
+            : SearchCoordinate(objective, scenario, threads, top, evaluations);
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - t0;
+
+        const uint32_t nSta = scenario.stas[0] + scenario.stas[1] + scenario.stas[2] + scenario.stas[3];
+        for (size_t rank = 0; rank < best.size(); ++rank) {
+            const Candidate& candidate = best[rank];
+            csv << scenario.packetSize << "," << nSta;
+            for (uint32_t n : scenario.stas) {
+                csv << "," << n;
+            }
+            csv << "," << candidate.score;
+            for (uint32_t cw : candidate.cw) {
+                csv << "," << cw;
+            }
+            for (double value : candidate.prediction) {
+                csv << "," << value;
+            }
+            csv << "," << rank + 1 << "\n";
+        }
+
+        std::cout << "[cw_search] " << scenario.packetSize << " B, STAs " << scenario.stas[0] << "/" << scenario.stas[1]
+                  << "/" << scenario.stas[2] << "/" << scenario.stas[3] << ": score " << best.front().score << " CW";
+        for (uint32_t cls = 0; cls < 4; ++cls) {
+            std::cout << " " << SurrogateObjective::CLASSES[cls] << " " << best.front().cw[2 * cls] << "/" << best.front().cw[2 * cls + 1];
+        }
+        std::cout << " | " << evaluations << " evaluaciones en " << std::fixed << std::setprecision(2) << wall.count()
+                  << " s (" << std::setprecision(0) << evaluations / wall.count() << " evaluaciones/s)\n";
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+
+    std::cout << "[cw_search] Resultados en " << output << "\n";
+    return 0;
+}
@@ -11,52 +11,750 @@
 #include "ns3/wifi-mac-header.h"
 #include "ns3/packet.h"
 #include "ns3/log.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/propagation-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#include <mpi.h>
+#endif
+#include "surrogate_model.h"          // TreeEnsemble + coste de Inteligen_Agent.py (compartido con cw_search.cc)
+#include "scenario.h"                 // ScenarioSpec + topología común (compartido con no_sdwn.cc)
 
 
 #include <iomanip>
 #include <cstdlib>
 #include <filesystem>
+#include <array>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <new>
+#include <random>
+#include <tuple>
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 
 namespace fs = std::filesystem;
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("SDWN_PoFi_NS3"); 
 
+// *********************************************************************************
+// ****************************** Logs por paquete *********************************
+// *********************************************************************************
+// SDWN_PACKET_LOG=0 elimina en compilación los logs del camino de datos (modo producción).
+// Por defecto siguen a NS_LOG: presentes en builds debug/default, fuera en optimized.
+#ifndef SDWN_PACKET_LOG
+#ifdef NS3_LOG_ENABLE
+#define SDWN_PACKET_LOG 1
+#else
+#define SDWN_PACKET_LOG 0
+#endif
+#endif
+
+extern uint32_t packetLogEvery;     // 0 = sin logs por paquete, N = uno de cada N paquetes
+
+// Muestreo por paquete (su UID, que conservan las copias y el reenvío): un paquete muestreado
+// se registra en todo su camino (recepción, PacketIn/FlowMod, descarte o reenvío)
+inline bool SdwnLogPacket(uint64_t packetUid) {
+    return packetLogEvery > 0 && packetUid % packetLogEvery == 0;
+}
+
+#if SDWN_PACKET_LOG
+#define SDWN_PACKET_LOG_INFO(packetUid, msg)                                    \
+    do {                                                                        \
+        if (SdwnLogPacket(packetUid)) {                                         \
+            NS_LOG_INFO(msg);                                                   \
+        }                                                                       \
+    } while (false)
+#else
+#define SDWN_PACKET_LOG_INFO(packetUid, msg) do { } while (false)
+#endif
+
 
 // *********************************************************************************
 // ********************************* KDNController ********************************
 // *********************************************************************************
 class KDNController {
     public:
-        enum Priority { HIGH, MEDIUM, LOW };
+        enum Priority { HIGH, MEDIUM, LOW, NRT };
+
+        static const char* PriorityName(Priority priority) {
+            switch (priority) {
+                case HIGH:   return "HIGH";
+                case MEDIUM: return "MEDIUM";
+                case LOW:    return "LOW";
+                default:     return "NRT";
+            }
+        }
     
         struct FlowMod {
             Priority priority;
             uint32_t txopLimit;
+            uint64_t packetUid = 0;     // Paquete que provocó el PacketIn (solo para el muestreo de logs)
         };
     
-        FlowMod PacketIn(uint8_t tos, Ipv4Address staIp) {
-            NS_LOG_INFO("[KDNController] Received PacketIn from PoFiAp (Station: " 
+        FlowMod PacketIn(uint8_t tos, Ipv4Address staIp, uint64_t packetUid = 0) {
+            SDWN_PACKET_LOG_INFO(packetUid, "[KDNController] Received PacketIn from PoFiAp (Station: " 
                 << staIp << ", ToS: 0x" << std::hex << uint32_t(tos) << ")");
     
             FlowMod mod;
+            mod.packetUid = packetUid;
             if (tos >= 0xe0) { // Voz (AC_VO)
 				mod.priority = HIGH;
 				mod.txopLimit = 1504; // Estándar ~1.5ms
 			} else if (tos >= 0xa0) { // Video (AC_VI)
 				mod.priority = MEDIUM;
 				mod.txopLimit = 3008; // Estándar ~3ms
+			} else if (tos >= 0x20 && tos < 0x60) { // Background (AC_BK, UP 1-2)
+				mod.priority = NRT;
+				mod.txopLimit = 0;    // Tráfico masivo sin TXOP
 			} else {
 				mod.priority = LOW;
 				mod.txopLimit = 0;    // Best Effort
 			}
     
-            NS_LOG_INFO("[KDNController] Send FlowMod to PoFiAp (Station: " << staIp << ", ToS: 0x" << std::hex << uint32_t(tos) 
-                         << ", Priority:  " << (mod.priority == HIGH ? "HIGH )" :
-                                            mod.priority == MEDIUM ? "MEDIUM )" : "LOW )")) ;
+            SDWN_PACKET_LOG_INFO(packetUid, "[KDNController] Send FlowMod to PoFiAp (Station: " << staIp << ", ToS: 0x" << std::hex << uint32_t(tos) 
+                         << ", Priority:  " << PriorityName(mod.priority) << " )");
             return mod;
         }
+
+        typedef Callback<void, uint8_t, FlowMod> FlowModCallback;
+
+        // Canal de control fuera de banda modelado como cola con retardo: el PacketIn tarda
+        // latency en llegar, espera a que el controlador quede libre (un único servidor FIFO con
+        // serviceTime por mensaje) y la FlowMod vuelve tras otro latency. Con ambos a 0 el
+        // PoFiAp sigue llamando a PacketIn de forma síncrona, sin coste.
+        void SetControlChannel(Time latency, Time serviceTime) {
+            m_latency = latency;
+            m_serviceTime = serviceTime;
+        }
+
+        bool IsInstantaneous() const {
+            return !m_remote && m_latency.IsZero() && m_serviceTime.IsZero();
+        }
+
+        // cell: AP (celda) que envía el PacketIn; todas las celdas comparten este servidor FIFO
+        void SendPacketIn(uint32_t cell, uint8_t tos, Ipv4Address staIp, FlowModCallback reply, uint64_t packetUid = 0) {
+            m_packetIns++;
+            CellState& state = Cell(cell);
+            state.packetIns++;
+            m_maxOutstanding = std::max(m_maxOutstanding, m_packetIns - m_flowMods);
+            if (state.socket) {
+                RemoteMessage msg{};
+                msg.type = RemoteMessage::PACKET_IN;
+                msg.tos = tos;
+                msg.cell = cell;
+                msg.seq = ++m_remoteSeq;
+                msg.staIp = staIp.Get();
+                msg.packetUid = packetUid;
+                m_pendingFlowMods[msg.seq] = {reply, Simulator::Now()};
+                state.socket->SendTo(Encode(msg), 0, state.server);
+                return;
+            }
+            Simulator::Schedule(m_latency, &KDNController::ReceivePacketIn, this, tos, staIp, Simulator::Now(), reply, packetUid);
+        }
+
+        // ====== Retuning EDCA en lazo cerrado ======
+        struct EdcaMod {
+            uint32_t aifsn;
+            uint32_t cwMin;
+            uint32_t cwMax;
+        };
+        typedef std::array<EdcaMod, 4> EdcaSet;         // Indexado por Priority
+
+        // Estadísticas de una clase en el último periodo de control (deltas, no acumulados)
+        struct AcReport {
+            uint64_t packetsReceived = 0;
+            uint64_t packetsSent = 0;
+            uint64_t packetsDropped = 0;
+            double meanDelayMs = 0.0;
+        };
+        typedef std::array<AcReport, 4> AcReports;
+        typedef Callback<void, EdcaSet> EdcaCallback;
+
+        // targetDelayMs por clase (0 = sin objetivo): retardo en el AP por encima del cual la clase pide aire.
+        // Todas las celdas (vuelven a) partir de baseline.
+        void EnableEdcaControl(const EdcaSet& baseline, const std::array<double, 4>& targetDelayMs) {
+            m_edcaControl = true;
+            m_edcaBaseline = baseline;
+            m_targetDelayMs = targetDelayMs;
+            for (CellState& state : m_cells) {
+                state.edca = baseline;
+            }
+        }
+
+        // QosTxop de la AC de una STA asociada a la celda, destino de sus FlowMod EDCA
+        void RegisterStation(uint32_t cell, Priority priority, Ptr<QosTxop> txop) {
+            Cell(cell).stationTxops[priority].push_back(txop);
+        }
+
+        // Cada celda tiene su propio lazo EDCA: el informe de un AP solo retoca su BSS
+        void SendStatsReport(uint32_t cell, const AcReports& reports, EdcaCallback reply) {
+            m_statsReports++;
+            CellState& state = Cell(cell);
+            if (state.socket) {
+                RemoteMessage msg{};
+                msg.type = RemoteMessage::STATS_REPORT;
+                msg.cell = cell;
+                msg.reports = reports;
+                state.edcaReply = reply;        // Sin cambios no hay respuesta: no se guarda por mensaje
+                state.socket->SendTo(Encode(msg), 0, state.server);
+                return;
+            }
+            Simulator::Schedule(m_latency, &KDNController::ReceiveStatsReport, this, cell, reports, reply);
+        }
+
+        // ====== Ejecución distribuida (mpi) ======
+        // Mensajes del canal de control por el enlace troncal AP <-> controlador. Todos los ranks
+        // ejecutan el mismo binario, así que el struct viaja tal cual como carga del paquete UDP.
+        struct RemoteMessage {
+            enum Type : uint8_t { PACKET_IN, FLOW_MOD, STATS_REPORT, EDCA_MOD };
+            Type type;
+            uint8_t tos;
+            uint32_t cell;
+            uint32_t seq;
+            uint32_t staIp;
+            uint64_t packetUid;
+            FlowMod mod;
+            AcReports reports;
+            EdcaSet edca;
+        };
+        static constexpr uint16_t CONTROL_PORT = 6653;      // Puerto OpenFlow
+
+        // En el rank de la celda: este controlador es solo su extremo local y reenvía PacketIn e
+        // informes por socket al controlador del rank 0; la latencia la pone el retardo del enlace
+        void SetRemoteCell(uint32_t cell, Ptr<Socket> socket, const Address& server) {
+            CellState& state = Cell(cell);
+            state.socket = socket;
+            state.server = server;
+            socket->SetRecvCallback(MakeCallback(&KDNController::RemoteReply, this));
+            m_remote = true;
+        }
+
+        // En el rank 0: atiende los mensajes de todas las celdas con la misma cola FIFO que en local
+        void ServeRemote(Ptr<Socket> socket) {
+            m_serverSocket = socket;
+            socket->SetRecvCallback(MakeCallback(&KDNController::RemoteRequest, this));
+        }
+
+        // Política: la clase más prioritaria que supera su objetivo (o pierde paquetes en el AP) hace
+        // que todas las inferiores dupliquen su CW (valores 2^k - 1). Sin presión, cada CW vuelve a la
+        // mitad hacia la configuración de partida.
+        EdcaSet RetuneEdca(const EdcaSet& current, const AcReports& reports) const {
+            int pressured = -1;
+            for (uint32_t p = 0; p < 4; ++p) {
+                if (m_targetDelayMs[p] > 0 && reports[p].packetsSent + reports[p].packetsDropped > 0
+                    && (reports[p].meanDelayMs > m_targetDelayMs[p] || reports[p].packetsDropped > 0)) {
+                    pressured = static_cast<int>(p);
+                    break;
+                }
+            }
+
+            EdcaSet next = current;
+            for (uint32_t p = 0; p < 4; ++p) {
+                EdcaMod& mod = next[p];
+                const EdcaMod& base = m_edcaBaseline[p];
+                uint32_t cwLimit = std::max(CW_LIMIT, base.cwMax);
+                if (pressured >= 0 && static_cast<int>(p) > pressured) {
+                    mod.cwMin = std::min(2 * mod.cwMin + 1, cwLimit);
+                    mod.cwMax = std::max(std::min(2 * mod.cwMax + 1, cwLimit), mod.cwMin);
+                } else if (pressured < 0) {
+                    mod.cwMin = std::max((mod.cwMin - 1) / 2, base.cwMin);
+                    mod.cwMax = std::max((mod.cwMax - 1) / 2, base.cwMax);
+                }
+            }
+            return next;
+        }
+
+        // PacketIn atendidos, RTT PacketIn->FlowMod y mensajes pendientes como máximo
+        void PrintStats(std::ostream& os) const {
+            os << "[KDNController] Control channel latency " << m_latency.GetMicroSeconds() << " us, service "
+               << m_serviceTime.GetMicroSeconds() << " us | PacketIn " << m_packetIns << ", FlowMod " << m_flowMods
+               << " | RTT mean " << std::fixed << std::setprecision(3)
+               << (m_flowMods > 0 ? m_rttSumMs / m_flowMods : 0.0) << " ms, max " << m_rttMaxMs << " ms"
+               << " | max outstanding " << m_maxOutstanding;
+            if (m_cells.size() > 1) {
+                os << " | " << m_cells.size() << " cells";
+            }
+            if (m_remote) {
+                os << " | remote (served by rank 0)";
+            }
+            os << "\n";
+            if (m_edcaControl) {
+                os << "[KDNController] EDCA control: " << m_statsReports << " reports, " << m_edcaUpdates
+                   << " EDCA FlowMods | final CWmin/CWmax";
+                for (size_t cell = 0; cell < m_cells.size(); ++cell) {
+                    if (m_remote && !m_cells[cell].socket) {
+                        continue;       // Celda de otro rank
+                    }
+                    if (m_cells.size() > 1) {
+                        os << (cell > 0 ? ";" : "") << " cell " << cell;
+                    }
+                    for (uint32_t p = 0; p < 4; ++p) {
+                        os << " " << PriorityName(static_cast<Priority>(p)) << " "
+                           << m_cells[cell].edca[p].cwMin << "/" << m_cells[cell].edca[p].cwMax;
+                    }
+                }
+                os << "\n";
+            }
+        }
+
+        // Carga de control por celda (PacketIn asíncronos) y EDCA vigente en ella
+        uint64_t CellPacketIns(uint32_t cell) const {
+            return cell < m_cells.size() ? m_cells[cell].packetIns : 0;
+        }
+
+        uint64_t CellEdcaUpdates(uint32_t cell) const {
+            return cell < m_cells.size() ? m_cells[cell].edcaUpdates : 0;
+        }
+
+        bool EdcaControlEnabled() const {
+            return m_edcaControl;
+        }
+
+        // ====== Modelo sustituto (RF exportado) ======
+        // Comprueba que el modelo tiene las features de IA/RF Model.py y los targets del coste
+        static bool CheckSurrogate(const TreeEnsemble& model, std::string& error) {
+            SurrogateObjective objective;
+            return objective.Bind(model, error);
+        }
+
+        void SetSurrogate(std::shared_ptr<const TreeEnsemble> model) {
+            m_surrogate = std::move(model);
+            std::string error;
+            m_objective.Bind(*m_surrogate, error);
+        }
+
+        struct CwDecision {
+            EdcaSet cw;
+            double score;
+            uint32_t evaluations;
+            double wallUs;
+        };
+
+        // Elige CWmin/CWmax por clase para la mezcla de STAs (H, M, L, NRT) y tamaño de paquete,
+        // minimizando el coste de IA/Inteligen_Agent.py sobre la rejilla 802.11 {3..1023} por
+        // descenso por coordenadas desde start (la AIFSN se conserva).
+        CwDecision ChooseCw(const std::array<uint32_t, 4>& stas, uint32_t packetSize, const EdcaSet& start) const {
+            auto t0 = std::chrono::steady_clock::now();
+            SurrogateObjective::Cw cw;
+            for (uint32_t p = 0; p < 4; ++p) {
+                cw[2 * p] = start[p].cwMin;
+                cw[2 * p + 1] = start[p].cwMax;
+            }
+            CwSearchResult result = CoordinateSearch(m_objective, packetSize, stas, cw);
+
+            CwDecision decision{start, result.score, uint32_t(result.evaluations), 0.0};
+            for (uint32_t p = 0; p < 4; ++p) {
+                decision.cw[p].cwMin = result.cw[2 * p];
+                decision.cw[p].cwMax = result.cw[2 * p + 1];
+            }
+            decision.wallUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            return decision;
+        }
+
+        bool HasSurrogate() const {
+            return static_cast<bool>(m_surrogate);
+        }
+
+    private:
+        static constexpr uint32_t CW_LIMIT = 1023;
+
+        struct CellState {
+            EdcaSet edca{};                                         // EDCA vigente en la celda
+            std::array<std::vector<Ptr<QosTxop>>, 4> stationTxops;
+            uint64_t packetIns = 0;
+            uint64_t edcaUpdates = 0;
+            Ptr<Socket> socket;                                     // mpi: enlace troncal hacia el rank 0
+            Address server;
+            EdcaCallback edcaReply;                                 // mpi: PoFiAp que espera la FlowMod EDCA
+        };
+
+        CellState& Cell(uint32_t cell) {
+            if (cell >= m_cells.size()) {
+                m_cells.resize(cell + 1, CellState{m_edcaBaseline});
+            }
+            return m_cells[cell];
+        }
+
+        void ReceiveStatsReport(uint32_t cell, AcReports reports, EdcaCallback reply) {
+            Time start = std::max(Simulator::Now(), m_busyUntil);
+            m_busyUntil = start + m_serviceTime;
+            CellState& state = Cell(cell);
+            EdcaSet next = RetuneEdca(state.edca, reports);
+            bool changed = false;
+            for (uint32_t p = 0; p < 4; ++p) {
+                changed |= next[p].cwMin != state.edca[p].cwMin || next[p].cwMax != state.edca[p].cwMax;
+            }
+            if (!changed) {
+                return;     // Sin cambios no hay FlowMod
+            }
+            state.edca = next;
+            state.edcaUpdates++;
+            m_edcaUpdates++;
+            NS_LOG_INFO("[KDNController] EDCA FlowMod cell " << cell << " CWmin/CWmax H " << next[HIGH].cwMin << "/" << next[HIGH].cwMax
+                << " M " << next[MEDIUM].cwMin << "/" << next[MEDIUM].cwMax
+                << " L " << next[LOW].cwMin << "/" << next[LOW].cwMax
+                << " NRT " << next[NRT].cwMin << "/" << next[NRT].cwMax);
+            Simulator::Schedule(m_busyUntil - Simulator::Now() + m_latency,
+                                &KDNController::DeliverEdca, this, cell, next, reply);
+        }
+
+        // La FlowMod EDCA llega a la vez a las STAs registradas en la celda y a su AP
+        void DeliverEdca(uint32_t cell, EdcaSet set, EdcaCallback reply) {
+            for (uint32_t p = 0; p < 4; ++p) {
+                for (const Ptr<QosTxop>& txop : m_cells[cell].stationTxops[p]) {
+                    txop->SetAifsn(set[p].aifsn);
+                    txop->SetMinCw(set[p].cwMin);
+                    txop->SetMaxCw(set[p].cwMax);
+                }
+            }
+            reply(set);
+        }
+
+        static Ptr<Packet> Encode(const RemoteMessage& msg) {
+            return Create<Packet>(reinterpret_cast<const uint8_t*>(&msg), sizeof(msg));
+        }
+
+        static bool Decode(Ptr<Packet> packet, RemoteMessage& msg) {
+            if (packet->GetSize() != sizeof(msg)) {
+                return false;
+            }
+            packet->CopyData(reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
+            return true;
+        }
+
+        // Rank 0: cada mensaje entra en la cola FIFO como si viniera de un AP local y la respuesta
+        // vuelve al socket que lo envió
+        void RemoteRequest(Ptr<Socket> socket) {
+            Address from;
+            while (Ptr<Packet> packet = socket->RecvFrom(from)) {
+                RemoteMessage msg;
+                if (!Decode(packet, msg)) {
+                    continue;
+                }
+                if (msg.type == RemoteMessage::PACKET_IN) {
+                    SendPacketIn(msg.cell, msg.tos, Ipv4Address(msg.staIp),
+                                 MakeCallback(&KDNController::ReplyFlowMod, this).Bind(from, msg.cell, msg.seq), msg.packetUid);
+                } else if (msg.type == RemoteMessage::STATS_REPORT) {
+                    SendStatsReport(msg.cell, msg.reports, MakeCallback(&KDNController::ReplyEdca, this).Bind(from, msg.cell));
+                }
+            }
+        }
+
+        void ReplyFlowMod(Address to, uint32_t cell, uint32_t seq, uint8_t tos, FlowMod mod) {
+            RemoteMessage msg{};
+            msg.type = RemoteMessage::FLOW_MOD;
+            msg.tos = tos;
+            msg.cell = cell;
+            msg.seq = seq;
+            msg.mod = mod;
+            m_serverSocket->SendTo(Encode(msg), 0, to);
+        }
+
+        void ReplyEdca(Address to, uint32_t cell, EdcaSet set) {
+            RemoteMessage msg{};
+            msg.type = RemoteMessage::EDCA_MOD;
+            msg.cell = cell;
+            msg.edca = set;
+            m_serverSocket->SendTo(Encode(msg), 0, to);
+        }
+
+        // Rank de la celda: la FlowMod llega al PoFiAp que la pidió y la EDCA a las STAs de la celda
+        void RemoteReply(Ptr<Socket> socket) {
+            while (Ptr<Packet> packet = socket->Recv()) {
+                RemoteMessage msg;
+                if (!Decode(packet, msg)) {
+                    continue;
+                }
+                if (msg.type == RemoteMessage::FLOW_MOD) {
+                    auto it = m_pendingFlowMods.find(msg.seq);
+                    if (it == m_pendingFlowMods.end()) {
+                        continue;
+                    }
+                    auto [reply, sentAt] = it->second;
+                    m_pendingFlowMods.erase(it);
+                    DeliverFlowMod(msg.tos, msg.mod, sentAt, reply);
+                } else if (msg.type == RemoteMessage::EDCA_MOD) {
+                    CellState& state = Cell(msg.cell);
+                    state.edca = msg.edca;
+                    state.edcaUpdates++;
+                    m_edcaUpdates++;
+                    DeliverEdca(msg.cell, msg.edca, state.edcaReply);
+                }
+            }
+        }
+
+        void ReceivePacketIn(uint8_t tos, Ipv4Address staIp, Time sentAt, FlowModCallback reply, uint64_t packetUid) {
+            Time start = std::max(Simulator::Now(), m_busyUntil);
+            m_busyUntil = start + m_serviceTime;
+            FlowMod mod = PacketIn(tos, staIp, packetUid);
+            Simulator::Schedule(m_busyUntil - Simulator::Now() + m_latency,
+                                &KDNController::DeliverFlowMod, this, tos, mod, sentAt, reply);
+        }
+
+        void DeliverFlowMod(uint8_t tos, FlowMod mod, Time sentAt, FlowModCallback reply) {
+            m_flowMods++;
+            double rttMs = (Simulator::Now() - sentAt).GetSeconds() * 1000.0;
+            m_rttSumMs += rttMs;
+            m_rttMaxMs = std::max(m_rttMaxMs, rttMs);
+            reply(tos, mod);
+        }
+
+        Time m_latency;                 // Un sentido del canal de control
+        Time m_serviceTime;             // Procesamiento por PacketIn
+        Time m_busyUntil;
+        uint64_t m_packetIns = 0;
+        uint64_t m_flowMods = 0;
+        uint64_t m_maxOutstanding = 0;
+        double m_rttSumMs = 0.0;
+        double m_rttMaxMs = 0.0;
+
+        bool m_edcaControl = false;
+        EdcaSet m_edcaBaseline{};
+        std::array<double, 4> m_targetDelayMs{};
+        std::vector<CellState> m_cells;                 // Indexado por celda (AP)
+        bool m_remote = false;                          // mpi: alguna celda se sirve desde el rank 0
+        Ptr<Socket> m_serverSocket;                     // mpi: socket del controlador en el rank 0
+        uint32_t m_remoteSeq = 0;
+        std::unordered_map<uint32_t, std::pair<FlowModCallback, Time>> m_pendingFlowMods;   // mpi: por seq
+        uint64_t m_statsReports = 0;
+        uint64_t m_edcaUpdates = 0;
+
+        std::shared_ptr<const TreeEnsemble> m_surrogate;
+        SurrogateObjective m_objective;
     };
+// *********************************************************************************
+// ******************************* PoFiScheduler ***********************************
+// *********************************************************************************
+// Disciplina de servicio entre las colas por clase del PoFiAp (índice = KDNController::Priority).
+// ProcessQueue le pasa la cabeza de cada cola y solo pregunta qué clase servir.
+class PoFiScheduler {
+    public:
+        static constexpr uint32_t N_CLASSES = 4;
+
+        struct ClassHead {
+            bool backlogged = false;    // Hay paquetes en la cola de la clase
+            bool eligible = false;      // ...y la cola MAC del AC admite otro
+            uint32_t bytes = 0;         // Tamaño del paquete de cabeza
+        };
+        using Heads = std::array<ClassHead, N_CLASSES>;
+
+        virtual ~PoFiScheduler() = default;
+        virtual const char* Name() const = 0;
+        // Clase a servir, o -1 si ninguna es elegible
+        virtual int Select(const Heads& heads) = 0;
+        virtual void OnServed(uint32_t cls, uint32_t bytes) {}
+        // Peso relativo de la clase (quantum en DRR, peso en WFQ; sin efecto en estricta)
+        virtual void SetClassWeight(uint32_t cls, double weight) {}
+};
+
+// Prioridad estricta HIGH > MEDIUM > LOW > NRT (comportamiento original)
+class StrictPriorityScheduler : public PoFiScheduler {
+    public:
+        const char* Name() const override { return "strict"; }
+
+        int Select(const Heads& heads) override {
+            for (uint32_t c = 0; c < N_CLASSES; ++c) {
+                if (heads[c].eligible) {
+                    return c;
+                }
+            }
+            return -1;
+        }
+};
+
+// Deficit Round Robin (Shreedhar & Varghese): quantum = peso * quantumBytes por visita
+class DrrScheduler : public PoFiScheduler {
+    public:
+        DrrScheduler(const std::array<double, N_CLASSES>& weights, uint32_t quantumBytes)
+            : m_quantumBytes(std::max<uint32_t>(quantumBytes, 1)) {
+            for (uint32_t c = 0; c < N_CLASSES; ++c) {
+                SetClassWeight(c, weights[c]);
+            }
+        }
+
+        const char* Name() const override { return "drr"; }
+
+        int Select(const Heads& heads) override {
+            bool anyEligible = false;
+            for (const ClassHead& head : heads) {
+                anyEligible = anyEligible || head.eligible;
+            }
+            if (!anyEligible) {
+                return -1;
+            }
+            // Termina: cada vuelta suma un quantum > 0 a alguna clase elegible
+            while (true) {
+                const ClassHead& head = heads[m_current];
+                if (head.eligible) {
+                    if (!m_credited) {
+                        m_deficit[m_current] += m_quantum[m_current];
+                        m_credited = true;
+                    }
+                    if (head.bytes <= m_deficit[m_current]) {
+                        return m_current;
+                    }
+                } else if (!head.backlogged) {
+                    m_deficit[m_current] = 0;
+                }
+                m_current = (m_current + 1) % N_CLASSES;
+                m_credited = false;
+            }
+        }
+
+        void OnServed(uint32_t cls, uint32_t bytes) override {
+            m_deficit[cls] -= std::min<double>(bytes, m_deficit[cls]);
+        }
+
+        void SetClassWeight(uint32_t cls, double weight) override {
+            m_quantum[cls] = std::max(1.0, weight * m_quantumBytes);
+        }
+
+    private:
+        uint32_t m_quantumBytes;
+        std::array<double, N_CLASSES> m_quantum{};
+        std::array<double, N_CLASSES> m_deficit{};
+        uint32_t m_current = 0;
+        bool m_credited = false;
+};
+
+// Weighted Fair Queuing en su variante auto-sincronizada (SCFQ, Golestani) sobre la cabeza de
+// cada clase: F = max(V, F_anterior) + bytes / peso cuando un paquete llega a la cabeza; se sirve
+// la menor F y V avanza a ella. Etiquetar en la cabeza (no al encolar) evita que los paquetes
+// descartados después por la cola adelanten la etiqueta de su clase.
+class WfqScheduler : public PoFiScheduler {
+    public:
+        explicit WfqScheduler(const std::array<double, N_CLASSES>& weights) {
+            for (uint32_t c = 0; c < N_CLASSES; ++c) {
+                SetClassWeight(c, weights[c]);
+            }
+        }
+
+        const char* Name() const override { return "wfq"; }
+
+        int Select(const Heads& heads) override {
+            int best = -1;
+            for (uint32_t c = 0; c < N_CLASSES; ++c) {
+                if (!heads[c].backlogged) {
+                    continue;
+                }
+                if (!m_tagged[c]) {
+                    m_headTag[c] = std::max(m_virtualTime, m_lastFinish[c]) + heads[c].bytes / m_weight[c];
+                    m_tagged[c] = true;
+                }
+                if (heads[c].eligible && (best < 0 || m_headTag[c] < m_headTag[best])) {
+                    best = c;
+                }
+            }
+            return best;
+        }
+
+        void OnServed(uint32_t cls, uint32_t bytes) override {
+            m_virtualTime = std::max(m_virtualTime, m_headTag[cls]);
+            m_lastFinish[cls] = m_headTag[cls];
+            m_tagged[cls] = false;
+        }
+
+        void SetClassWeight(uint32_t cls, double weight) override {
+            m_weight[cls] = std::max(weight, 1e-6);
+        }
+
+    private:
+        std::array<double, N_CLASSES> m_weight{};
+        std::array<double, N_CLASSES> m_headTag{};
+        std::array<double, N_CLASSES> m_lastFinish{};
+        std::array<bool, N_CLASSES> m_tagged{};
+        double m_virtualTime = 0.0;
+};
+
+inline std::unique_ptr<PoFiScheduler> CreatePoFiScheduler(const std::string& name,
+                                                          const std::array<double, PoFiScheduler::N_CLASSES>& weights,
+                                                          uint32_t drrQuantumBytes) {
+    if (name == "drr") {
+        return std::make_unique<DrrScheduler>(weights, drrQuantumBytes);
+    }
+    if (name == "wfq") {
+        return std::make_unique<WfqScheduler>(weights);
+    }
+    return std::make_unique<StrictPriorityScheduler>();
+}
+
+// *********************************************************************************
+// ********************************** RingQueue ************************************
+// *********************************************************************************
+
+// Cola FIFO sobre un buffer circular preasignado. Push/pop son O(1) y no tocan el heap salvo
+// al crecer, que se hace por bloques de CHUNK elementos. Los elementos entran y salen por
+// movimiento, así un Ptr<Packet> no incrementa/decrementa su contador de referencias en cola.
+template <typename T>
+class RingQueue {
+    public:
+        static constexpr size_t CHUNK = 256;
+
+        explicit RingQueue(size_t initialCapacity = CHUNK)
+            : m_items(std::max<size_t>(initialCapacity, 1)) {}
+
+        bool empty() const { return m_size == 0; }
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_items.size(); }
+
+        T& front() { return m_items[m_head]; }
+        const T& front() const { return m_items[m_head]; }
+
+        void push(T&& item) {
+            if (m_size == m_items.size()) {
+                Grow(m_items.size() + CHUNK);
+            }
+            size_t tail = m_head + m_size;
+            if (tail >= m_items.size()) {
+                tail -= m_items.size();
+            }
+            m_items[tail] = std::move(item);
+            m_size++;
+        }
+
+        T pop() {
+            T item = std::move(m_items[m_head]);
+            m_items[m_head] = T();      // El hueco no retiene el paquete si T no tiene move real
+            if (++m_head == m_items.size()) {
+                m_head = 0;
+            }
+            m_size--;
+            return item;
+        }
+
+    private:
+        // Realinea el contenido al inicio de un buffer mayor (única asignación de memoria)
+        void Grow(size_t newCapacity) {
+            std::vector<T> items(newCapacity);
+            for (size_t i = 0; i < m_size; ++i) {
+                size_t from = m_head + i;
+                if (from >= m_items.size()) {
+                    from -= m_items.size();
+                }
+                items[i] = std::move(m_items[from]);
+            }
+            m_items.swap(items);
+            m_head = 0;
+        }
+
+        std::vector<T> m_items;
+        size_t m_head = 0;
+        size_t m_size = 0;
+};
+
 // *********************************************************************************
 // ************************************* PoFiAp ************************************
 // *********************************************************************************
@@ -71,6 +769,12 @@ extern uint32_t CwMinL;
 extern uint32_t CwMaxL;
 extern uint32_t CwMinNRT;
 extern uint32_t CwMaxNRT;
+extern uint32_t nStaH;
+extern uint32_t nStaM;
+extern uint32_t nStaL;
+extern uint32_t nStaNRT;
+extern uint32_t nAps;
+std::string PoFiApStatsPath();      // CSV por clase del AP ("" = desactivado, --apStatsCsv)
 // ==================================================================
 
 
@@ -79,9 +783,38 @@ class PoFiAp : public Application {
         PoFiAp() = default;
         ~PoFiAp() override = default;
         
+        // Modo de vaciado de las colas del AP:
+        //  - DRAIN_DEVICE: reenvía mientras la cola MAC del AC tenga espacio (m_txQueueLimit MPDUs)
+        //    y espera el trace "Dequeue" del WifiMacQueue cuando está llena.
+        //  - DRAIN_RATE: modelo de servicio a tasa fija (m_serviceRate), un paquete por tiempo de transmisión.
+        enum DrainMode { DRAIN_DEVICE, DRAIN_RATE };
+
+        // Gestión de las colas por clase, siempre con límite duro de paquetes (0 = sin límite):
+        //  - AQM_TAILDROP: descarta el paquete que llega con la cola llena.
+        //  - AQM_RED: descarte temprano aleatorio según la ocupación media (Floyd & Jacobson);
+        //    umbrales al 25% y 75% de la capacidad.
+        //  - AQM_CODEL: descarte en cabeza por tiempo de permanencia en el AP (RFC 8289).
+        enum AqmMode { AQM_TAILDROP, AQM_RED, AQM_CODEL };
+
+        // Paquetes de un ToS que llegan con la FlowMod aún en camino:
+        //  - PENDING_BUFFER: se retienen (hasta un límite por ToS) y se encolan al llegar la FlowMod.
+        //  - PENDING_DEFAULT: acción por defecto, se encolan ya como LOW (BE).
+        enum PendingAction { PENDING_BUFFER, PENDING_DEFAULT };
+
+        // Número de clases/AC en las tablas densas indexadas por KDNController::Priority
+        static constexpr uint32_t N_EDCA_SLOTS = 4;
+        static_assert(N_EDCA_SLOTS == PoFiScheduler::N_CLASSES, "Una cola del planificador por clase");
+
         void Setup(uint16_t port) {
             m_port = port;
         }
+
+        void SetScheduler(DrainMode mode, uint32_t txQueueLimit, DataRate serviceRate, Time pollInterval) {
+            m_drainMode = mode;
+            m_txQueueLimit = txQueueLimit;
+            m_serviceRate = serviceRate;
+            m_pollInterval = pollInterval;
+        }
         
         void StartApplication() override {
             NS_LOG_INFO("[PoFiAp] Starting application at port " << m_port);
@@ -90,93 +823,391 @@ class PoFiAp : public Application {
             InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), m_port);
             m_socket->Bind(local);
             m_socket->SetRecvCallback(MakeCallback(&PoFiAp::HandleRead, this));
+            m_metricsStart = Simulator::Now();
         
             Ptr<Ipv4> ipv4 = GetNode()->GetObject<Ipv4>();
             ipv4->TraceConnectWithoutContext("Rx", MakeCallback(&PoFiAp::Ipv4PacketReceived, this));
             m_apIpv4 = ipv4;
+
+            // Interfaz WiFi del AP: con mpi el dispositivo 0 es el enlace troncal al controlador
+            Ptr<WifiNetDevice> wifiDevice;
+            for (uint32_t d = 0; d < GetNode()->GetNDevices() && !wifiDevice; ++d) {
+                wifiDevice = DynamicCast<WifiNetDevice>(GetNode()->GetDevice(d));
+            }
+
+            // Dimensionar la tabla de estaciones con la subred de la interfaz WiFi
+            int32_t ifIndex = ipv4->GetInterfaceForDevice(wifiDevice ? Ptr<NetDevice>(wifiDevice) : GetNode()->GetDevice(0));
+            m_wifiInterface = ifIndex;
+            if (ifIndex >= 0 && ipv4->GetNAddresses(ifIndex) > 0) {
+                Ipv4InterfaceAddress ifAddr = ipv4->GetAddress(ifIndex, 0);
+                uint32_t hostMask = ~ifAddr.GetMask().Get();
+                if (hostMask <= 0xffff) {
+                    SetStationSubnet(ifAddr.GetLocal().CombineMask(ifAddr.GetMask()), hostMask);
+                }
+            }
+
+            // Enganchar las colas MAC por AC para saber cuándo el dispositivo libera espacio
+            if (wifiDevice) {
+                m_wifiMac = wifiDevice->GetMac();
+                for (AcIndex ac : {AC_VO, AC_VI, AC_BE, AC_BK}) {
+                    m_wifiMac->GetTxopQueue(ac)->TraceConnectWithoutContext(
+                        "Dequeue", MakeCallback(&PoFiAp::DeviceQueueDequeue, this));
+                }
+                for (uint32_t p = 0; p < N_EDCA_SLOTS; ++p) {
+                    m_edca[p].txop = m_wifiMac->GetQosTxop(PriorityToAc(static_cast<KDNController::Priority>(p)));
+                }
+            } else if (m_drainMode == DRAIN_DEVICE) {
+                NS_LOG_ERROR("[PoFiAp] No WifiNetDevice on the AP node, falling back to rate drain mode");
+                m_drainMode = DRAIN_RATE;
+            }
+
+            if (!m_controlPeriod.IsZero()) {
+                m_controlEvent = Simulator::Schedule(m_controlPeriod, &PoFiAp::ReportStats, this);
+            }
 		}
         
         
         void StopApplication() override {
-            //PoFiApStats();
+            const std::string statsPath = PoFiApStatsPath();
+            if (!statsPath.empty()) {
+                PoFiApStats(statsPath);
+            }
             NS_LOG_INFO("[PoFiAp] Stopping application");
+            Simulator::Cancel(m_drainEvent);
+            Simulator::Cancel(m_controlEvent);
             if (m_socket) {
                 m_socket->Close();
             }
         }
         
-        void PrintRoutingTable() {
-            std::cout << "Tabla de Enrutamiento del Nodo AP:" << std::endl;
-            Ptr<OutputStreamWrapper> stream = Create<OutputStreamWrapper>(&std::cout);
-            m_apIpv4->GetRoutingProtocol()->PrintRoutingTable(stream, Time::S);
+        void SetRxCopyHeader(bool copyHeader) {
+            m_rxCopyHeader = copyHeader;
         }
-    
-        struct QueueItem {
-            uint8_t tos;
-            Ptr<Packet> packet;
-            Ipv4Address sender;
-            Time arrivalTime;  
-            
-            bool operator<(const QueueItem& other) const {
-                return tos < other.tos;
-            }
-        };
-        
-        struct Metrics {
-            uint32_t packetsReceived = 0;
-            uint32_t packetsSent = 0;
-            uint32_t packetsLost = 0;
-            uint64_t bytesReceived = 0;
-            uint64_t bytesSent = 0;
-            double latencyTotal = 0.0;
-            double jitterTotal = 0.0;
-        };
-        
-        std::map<KDNController::Priority, Metrics> metricsMap;
 
-		struct EdcaConfig {
-    		uint32_t aifsn;
-    		uint32_t cwMin;
-    		uint32_t cwMax;
-    		uint32_t ampduSize;
-		};
+        void SetQueueManagement(AqmMode mode, const std::array<uint32_t, N_EDCA_SLOTS>& capacity, Time codelTarget, Time codelInterval) {
+            m_aqm = mode;
+            m_queueCapacity = capacity;
+            m_codelTarget = codelTarget;
+            m_codelInterval = codelInterval;
+        }
 
-		std::map<std::string, EdcaConfig> edcaParams {
-    		{"VO", {2, CwMinH, CwMaxH, 8192}},
-    		{"VI", {2, CwMinM, CwMaxM, 16384}},
-    		{"BE", {3, CwMinL, CwMaxL, 32768}},
-    		{"BK", {7, CwMinNRT, CwMaxNRT, 65535}}
-		};
+        // Controlador de larga vida compartido (por defecto uno propio con canal instantáneo)
+        void SetController(std::shared_ptr<KDNController> controller) {
+            m_controller = std::move(controller);
+        }
 
-    private:
-        Ptr<Socket> m_socket;
-        uint16_t m_port;
-        Ptr<Ipv4> m_apIpv4;
-        
-        std::priority_queue<QueueItem> highPriorityQueue;
-        std::priority_queue<QueueItem> mediumPriorityQueue;
-        std::queue<QueueItem> lowPriorityQueue;
-        
-        std::map<Ipv4Address, uint8_t> tosMap;
-        std::map<uint8_t, KDNController::FlowMod> tosRegistry;
-        bool isProcessing = false;
-        
-        void Ipv4PacketReceived(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface) {
-            Ipv4Header ipHeader;
-            Ptr<Packet> copy = packet->Copy();
-            copy->RemoveHeader(ipHeader);
-        
-            Ipv4Address src = ipHeader.GetSource();
-            uint8_t tos = ipHeader.GetTos();
-            tosMap[src] = tos;
+        void SetPendingAction(PendingAction action, uint32_t bufferLimit) {
+            m_pendingAction = action;
+            m_pendingLimit = bufferLimit;
+        }
+
+        // Periodo de los informes por clase al controlador (0 = EDCA estático)
+        void SetControlPeriod(Time period) {
+            m_controlPeriod = period;
+        }
+
+        // Celda (BSS) de este AP ante el controlador compartido
+        void SetCell(uint32_t cell) {
+            m_cell = cell;
+        }
+
+        uint32_t GetCell() const {
+            return m_cell;
+        }
+
+        uint64_t GetTableMisses() const {
+            return m_control.tableMisses;
+        }
+
+        // ====== Tablas del camino de datos (también las usa --microbench=tables) ======
+        // Tabla de estaciones dimensionada para la subred de la interfaz WiFi
+        void SetStationSubnet(Ipv4Address subnet, uint32_t hostMask) {
+            m_hostMask = hostMask;
+            m_subnetBase = subnet.Get() & ~hostMask;
+            stationTable.assign(hostMask + 1, 0);
+        }
+
+        // ToS por estación: acceso directo por índice de host, mapa solo fuera de la subred
+        void StoreStationTos(Ipv4Address src, uint8_t tos) {
+            uint32_t addr = src.Get();
+            if (!stationTable.empty() && (addr & ~m_hostMask) == m_subnetBase) {
+                stationTable[addr & m_hostMask] = tos;
+                return;
+            }
+            tosOutOfSubnet[src] = tos;
+        }
+
+        uint8_t LookupStationTos(Ipv4Address src) const {
+            uint32_t addr = src.Get();
+            if (!stationTable.empty() && (addr & ~m_hostMask) == m_subnetBase) {
+                return stationTable[addr & m_hostMask];
+            }
+            auto it = tosOutOfSubnet.find(src);
+            return it != tosOutOfSubnet.end() ? it->second : 0;
+        }
+
+        bool HasFlowMod(uint8_t tos) const {
+            return flowTable[tos].installed;
+        }
+
+        // Clase del ToS: la de su FlowMod o LOW (acción por defecto) mientras no esté instalada
+        KDNController::Priority FlowPriority(uint8_t tos) const {
+            const FlowEntry& flow = flowTable[tos];
+            return flow.installed ? flow.mod.priority : KDNController::LOW;
+        }
+
+        void RecordReceived(KDNController::Priority priority, uint32_t bytes) {
+            Metrics& metrics = metricsTable[priority];
+            metrics.packetsReceived++;
+            metrics.bytesReceived += bytes;
+        }
+
+        void RecordSent(KDNController::Priority priority, uint32_t bytes, double latencyMs) {
+            Metrics& metrics = metricsTable[priority];
+            metrics.packetsSent++;
+            metrics.bytesSent += bytes;
+
+            if (metrics.packetsSent > 1) {
+                double lastLatency = metrics.latencyTotal / (metrics.packetsSent - 1);
+                double jitter = std::abs(latencyMs - lastLatency);
+                metrics.jitterTotal += jitter;
+            }
+            metrics.latencyTotal += latencyMs;
+        }
+
+        void InstallFlowMod(uint8_t tos, const KDNController::FlowMod& mod) {
+            FlowEntry& flow = flowTable[tos];
+            flow.mod = mod;
+            flow.installed = true;
+            flow.pending = false;
+            SDWN_PACKET_LOG_INFO(mod.packetUid, "[PoFiAp] Received FlowMod from KDNController with " 
+                << KDNController::PriorityName(mod.priority)
+                << " Priority and TxopLimit " 
+                << static_cast<uint32_t>(mod.txopLimit));
+            // La FlowMod nueva es lo único que puede cambiar el EDCA de esta prioridad
+            ConfigureEdca(mod.priority, mod.txopLimit);
+
+            double setupMs = (Simulator::Now() - flow.missTime).GetSeconds() * 1000.0;
+            m_control.flowSetups++;
+            m_control.setupDelaySumMs += setupMs;
+            m_control.setupDelayMaxMs = std::max(m_control.setupDelayMaxMs, setupMs);
+        }
+
+        void SetDiscipline(std::unique_ptr<PoFiScheduler> scheduler) {
+            m_scheduler = std::move(scheduler);
+        }
+
+        // Reparto del servicio y retardo en cola por clase con la disciplina activa
+        void PrintSchedulerStats(std::ostream& os) const {
+            uint64_t totalBytes = 0;
+            for (const Metrics& metrics : metricsTable) {
+                totalBytes += metrics.bytesSent;
+            }
+            os << "[PoFiAp] Scheduler " << m_scheduler->Name() << ":";
+            for (uint32_t p = 0; p < N_EDCA_SLOTS; ++p) {
+                const Metrics& metrics = metricsTable[p];
+                if (metrics.packetsSent == 0) {
+                    continue;
+                }
+                os << " " << KDNController::PriorityName(static_cast<KDNController::Priority>(p))
+                   << " share " << std::fixed << std::setprecision(1) << 100.0 * metrics.bytesSent / totalBytes << "%"
+                   << " delay " << std::setprecision(3) << metrics.latencyTotal / metrics.packetsSent << " ms"
+                   << " dropped " << metrics.packetsLost << ";";
+            }
+            os << "\n";
+        }
+
+        // Coste del plano de control visto desde el AP: fallos de tabla y espera hasta la FlowMod
+        void PrintControlStats(std::ostream& os) const {
+            os << "[PoFiAp] Control: " << m_control.tableMisses << " table misses, "
+               << m_control.flowSetups << " FlowMods installed, setup delay mean " << std::fixed << std::setprecision(3)
+               << (m_control.flowSetups > 0 ? m_control.setupDelaySumMs / m_control.flowSetups : 0.0)
+               << " ms, max " << m_control.setupDelayMaxMs << " ms | "
+               << (m_pendingAction == PENDING_BUFFER ? "buffered " : "default action ")
+               << (m_pendingAction == PENDING_BUFFER ? m_control.buffered : m_control.defaultForwarded)
+               << ", buffer drops " << m_control.pendingDropped
+               << ", duplicate FlowMods " << m_control.duplicateFlowMods << "\n";
+        }
+
+        // Métricas por clase a cero (fork tras el calentamiento); tablas de flujo y colas se conservan
+        void ResetMetrics() {
+            metricsTable = {};
+            m_lastReported = {};
+            m_metricsStart = Simulator::Now();
+        }
+
+        // Paquetes clasificados en Ipv4PacketReceived y ruta usada (tiempo y asignaciones por paquete: --microbench=rxpeek)
+        void PrintRxStats(std::ostream& os) const {
+            os << "[PoFiAp] Rx classification: " << m_rxClassified << " packets ("
+               << (m_rxCopyHeader ? "Copy+RemoveHeader" : "PeekHeader") << ")\n";
+        }
+
+        void PrintRoutingTable() {
+            std::cout << "Tabla de Enrutamiento del Nodo AP:" << std::endl;
+            Ptr<OutputStreamWrapper> stream = Create<OutputStreamWrapper>(&std::cout);
+            m_apIpv4->GetRoutingProtocol()->PrintRoutingTable(stream, Time::S);
+        }
+    
+        struct QueueItem {
+            uint8_t tos;
+            Ptr<Packet> packet;
+            Ipv4Address sender;
+            Time arrivalTime;  
+            
+            // Orden de las antiguas std::priority_queue (mayor ToS primero; a igual ToS, orden de
+            // llegada). Las colas por clase son ahora FIFO; se conserva para el microbench "queues".
+            bool operator<(const QueueItem& other) const {
+                if (tos != other.tos) {
+                    return tos < other.tos;
+                }
+                return arrivalTime > other.arrivalTime;
+            }
+        };
+        
+        struct Metrics {
+            uint32_t packetsReceived = 0;
+            uint32_t packetsSent = 0;
+            uint32_t packetsLost = 0;       // Descartados en el AP (cola llena/AQM), no en el aire
+            uint64_t bytesReceived = 0;
+            uint64_t bytesSent = 0;
+            double latencyTotal = 0.0;
+            double jitterTotal = 0.0;
+        };
+        
+        std::array<Metrics, N_EDCA_SLOTS> metricsTable{};   // Indexada por KDNController::Priority
+
+		struct EdcaConfig {
+    		uint32_t aifsn;
+    		uint32_t cwMin;
+    		uint32_t cwMax;
+    		uint32_t ampduSize;
+		};
+
+		// Política EDCA indexada por KDNController::Priority (HIGH=VO, MEDIUM=VI, LOW=BE, NRT=BK)
+		std::array<EdcaConfig, N_EDCA_SLOTS> edcaParams {{
+    		{2, CwMinH, CwMaxH, 8192},
+    		{2, CwMinM, CwMaxM, 16384},
+    		{3, CwMinL, CwMaxL, 32768},
+    		{7, CwMinNRT, CwMaxNRT, 65535}
+		}};
+
+		// Cambio de política: solo se empuja al MAC si altera lo ya aplicado
+		void SetEdcaConfig(KDNController::Priority priority, const EdcaConfig& config) {
+			edcaParams[priority] = config;
+			if (m_edca[priority].configured) {
+				ConfigureEdca(priority, m_edca[priority].txopLimit);
+			}
+		}
+
+    private:
+        Ptr<Socket> m_socket;
+        uint16_t m_port;
+        Ptr<Ipv4> m_apIpv4;
+        
+        // Una FIFO por clase indexada por KDNController::Priority (NRT/BK en su propia cola, detrás de BE)
+        std::array<RingQueue<QueueItem>, N_EDCA_SLOTS> m_queues;
+        
+        // Tabla de FlowMods indexada directamente por ToS (256 entradas)
+        struct FlowEntry {
+            KDNController::FlowMod mod;
+            bool installed = false;
+            bool pending = false;       // PacketIn enviado, FlowMod en camino
+            Time missTime;              // Primer fallo de tabla del ToS
+        };
+        std::array<FlowEntry, 256> flowTable{};
+
+        // Plano de control asíncrono
+        std::shared_ptr<KDNController> m_controller = std::make_shared<KDNController>();
+        PendingAction m_pendingAction = PENDING_BUFFER;
+        uint32_t m_pendingLimit = 64;                           // Paquetes retenidos por ToS
+        std::array<std::vector<QueueItem>, 256> m_pendingPackets;
+        struct ControlStats {
+            uint64_t tableMisses = 0;
+            uint64_t buffered = 0;
+            uint64_t defaultForwarded = 0;
+            uint64_t pendingDropped = 0;
+            uint64_t duplicateFlowMods = 0;
+            uint32_t flowSetups = 0;
+            double setupDelaySumMs = 0.0;
+            double setupDelayMaxMs = 0.0;
+        } m_control;
+        Time m_controlPeriod;                                   // Informes por clase al controlador
+        EventId m_controlEvent;
+        uint32_t m_cell = 0;
+        std::array<Metrics, N_EDCA_SLOTS> m_lastReported{};     // Acumulados en el informe anterior
+        Time m_metricsStart;                                    // Inicio de metricsTable (arranque o ResetMetrics)
+
+        // ToS por estación indexado por host dentro de la subred del AP (p.ej. /24 -> 256)
+        std::vector<uint8_t> stationTable;
+        int32_t m_wifiInterface = -1;
+        uint32_t m_subnetBase = 0;
+        uint32_t m_hostMask = 0;
+        std::map<Ipv4Address, uint8_t> tosOutOfSubnet;     // Solo para orígenes fuera de la subred
+
+        // Planificador orientado a eventos (sin tick fijo de 1 ms)
+        DrainMode m_drainMode = DRAIN_DEVICE;
+        uint32_t m_txQueueLimit = 8;                  // MPDUs admitidos en la cola MAC de cada AC
+        DataRate m_serviceRate = DataRate("54Mbps");  // Tasa de servicio en modo DRAIN_RATE
+        Time m_pollInterval = MilliSeconds(1);        // Watchdog mientras el dispositivo está lleno
+        Time m_nextServiceTime;                       // Fin del servicio en curso (DRAIN_RATE)
+        EventId m_drainEvent;
+        bool m_waitingDevice = false;
+
+        bool m_rxCopyHeader = false;                  // true: ruta anterior Copy()+RemoveHeader()
+        uint64_t m_rxClassified = 0;
+        Ptr<WifiMac> m_wifiMac;
+        std::unique_ptr<PoFiScheduler> m_scheduler = std::make_unique<StrictPriorityScheduler>();
+
+        // AQM por clase
+        static constexpr double RED_MIN_FRACTION = 0.25;
+        static constexpr double RED_MAX_FRACTION = 0.75;
+        static constexpr double RED_MAX_P = 0.1;
+        static constexpr double RED_WEIGHT = 0.002;
+        AqmMode m_aqm = AQM_TAILDROP;
+        std::array<uint32_t, N_EDCA_SLOTS> m_queueCapacity{};   // Paquetes por clase (0 = sin límite)
+        Time m_codelTarget = MilliSeconds(5);
+        Time m_codelInterval = MilliSeconds(100);
+        struct AqmState {
+            double redAverage = 0.0;
+            int32_t redCount = -1;
+            Time codelFirstAbove;
+            Time codelDropNext;
+            uint32_t codelCount = 0;
+            uint32_t codelLastCount = 0;
+            bool codelDropping = false;
+        };
+        std::array<AqmState, N_EDCA_SLOTS> m_aqmState{};
+        Ptr<UniformRandomVariable> m_redRandom = CreateObject<UniformRandomVariable>();
+
+        // QosTxop resueltos una sola vez en StartApplication, con lo último aplicado a cada uno
+        struct EdcaSlot {
+            Ptr<QosTxop> txop;
+            bool configured = false;
+            EdcaConfig applied{};
+            uint32_t txopLimit = 0;
+        };
+        std::array<EdcaSlot, N_EDCA_SLOTS> m_edca;
         
-            KDNController::Priority priority = tosRegistry.count(tos) ? 
-                tosRegistry[tos].priority : KDNController::LOW;
+        void Ipv4PacketReceived(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface) {
+            if (m_wifiInterface >= 0 && interface != static_cast<uint32_t>(m_wifiInterface)) {
+                return;     // Mensajes del canal de control por el enlace troncal
+            }
+            Ipv4Header ipHeader;
+            if (m_rxCopyHeader) {
+                // Ruta anterior: copia del paquete solo para leer la cabecera
+                Ptr<Packet> copy = packet->Copy();
+                copy->RemoveHeader(ipHeader);
+            } else {
+                packet->PeekHeader(ipHeader);
+            }
+            m_rxClassified++;
         
-            metricsMap[priority].packetsReceived++;
-            metricsMap[priority].bytesReceived += packet->GetSize();
+            Ipv4Address src = ipHeader.GetSource();
+            uint8_t tos = ipHeader.GetTos();
+            StoreStationTos(src, tos);
+            RecordReceived(FlowPriority(tos), packet->GetSize());
         
-            NS_LOG_INFO("[PoFiAp] Received Packet from Station: " 
+            SDWN_PACKET_LOG_INFO(packet->GetUid(), "[PoFiAp] Received Packet from Station: " 
                 << src << " with ToS: 0x" << std::hex << uint32_t(tos));
         }
         
@@ -185,84 +1216,303 @@ class PoFiAp : public Application {
             while (Ptr<Packet> packet = socket->RecvFrom(from)) {
                 InetSocketAddress addr = InetSocketAddress::ConvertFrom(from);
                 Ipv4Address sender = addr.GetIpv4();
-                uint8_t tos = tosMap[sender];
-                KDNController::FlowMod entry; 
-        
-                if (tosRegistry.find(tos) == tosRegistry.end()) {
-                    KDNController controller;
-                    NS_LOG_INFO("[PoFiAp] Send PacketIn to KDNController with ToS: 0x" << std::hex << uint32_t(tos));
-                    tosRegistry[tos] = controller.PacketIn(tos, sender);
-                    entry = tosRegistry[tos]; // Asignación dentro del if
-                    NS_LOG_INFO("[PoFiAp] Received FlowMod from KDNController with " 
-                        << (entry.priority == 0 ? "HIGH" : 
-                           (entry.priority == 1 ? "MEDIUM" : "LOW")) 
-                        << " Priority and TxopLimit " 
-                        << static_cast<uint32_t>(entry.txopLimit));
-                } 
-                else {
-                    entry = tosRegistry[tos]; // Asignación dentro del else
-                }
-                 // Crear QueueItem con el tiempo actual
+                uint8_t tos = LookupStationTos(sender);
+                FlowEntry& flow = flowTable[tos];
+                // Crear QueueItem con el tiempo actual (la espera de la FlowMod cuenta como latencia)
                 QueueItem item{tos, packet, sender, Simulator::Now()};
-                EnqueuePacket(entry.priority, item); 
+
+                if (flow.installed) {
+                    EnqueuePacket(flow.mod.priority, std::move(item));
+                    continue;
+                }
+
+                m_control.tableMisses++;
+                SDWN_PACKET_LOG_INFO(packet->GetUid(), "[PoFiAp] Send PacketIn to KDNController with ToS: 0x" << std::hex << uint32_t(tos));
+                if (m_controller->IsInstantaneous()) {
+                    flow.missTime = Simulator::Now();
+                    InstallFlowMod(tos, m_controller->PacketIn(tos, sender, packet->GetUid()));
+                    EnqueuePacket(flow.mod.priority, std::move(item));
+                    continue;
+                }
+
+                // Fallo de tabla: un PacketIn por paquete, como un switch OpenFlow reactivo
+                if (!flow.pending) {
+                    flow.pending = true;
+                    flow.missTime = Simulator::Now();
+                }
+                m_controller->SendPacketIn(m_cell, tos, sender, MakeCallback(&PoFiAp::FlowModReceived, this), packet->GetUid());
+
+                if (m_pendingAction == PENDING_DEFAULT) {
+                    m_control.defaultForwarded++;
+                    EnqueuePacket(KDNController::LOW, std::move(item));
+                } else if (m_pendingPackets[tos].size() < m_pendingLimit) {
+                    m_control.buffered++;
+                    m_pendingPackets[tos].push_back(std::move(item));
+                } else {
+                    m_control.pendingDropped++;
+                    SDWN_PACKET_LOG_INFO(item.packet->GetUid(), "[PoFiAp] Dropped packet from " << sender
+                        << " waiting for FlowMod (ToS: 0x" << std::hex << uint32_t(tos) << ")");
+                }
+            }
+        }
+
+        // Respuesta asíncrona del controlador: instalar y liberar lo retenido en orden de llegada
+        void FlowModReceived(uint8_t tos, KDNController::FlowMod mod) {
+            if (flowTable[tos].installed) {
+                m_control.duplicateFlowMods++;   // Respuesta a un PacketIn repetido del mismo ToS
+                return;
             }
+            InstallFlowMod(tos, mod);
+            for (QueueItem& item : m_pendingPackets[tos]) {
+                EnqueuePacket(mod.priority, std::move(item));
+            }
+            m_pendingPackets[tos].clear();
         }
         
-        void EnqueuePacket(KDNController::Priority priority, const QueueItem& item) {  // Cambiar parámetros
-            std::string queueType;
-            
-            if (priority == KDNController::HIGH) {
-                highPriorityQueue.push(item);
-                queueType = "HIGH";
-            } else if (priority == KDNController::MEDIUM) {
-                mediumPriorityQueue.push(item);
-                queueType = "MEDIUM";
-            } else {
-                lowPriorityQueue.push(item);
-                queueType = "LOW";
+        void EnqueuePacket(KDNController::Priority priority, QueueItem&& item) {
+            if (!AdmitPacket(priority)) {
+                DropPacket(priority, item, m_aqm == AQM_RED ? "RED" : "queue full");
+                return;
             }
             
-            /*NS_LOG_INFO("[PoFiAp] Packet in " << queueType << " QUEUE from " << item.sender 
+            /*NS_LOG_INFO("[PoFiAp] Packet in " << KDNController::PriorityName(priority) << " QUEUE from " << item.sender 
                        << " arrived at " << item.arrivalTime.GetSeconds() << "s");*/
+            m_queues[priority].push(std::move(item));
             
-            if (!isProcessing) {
-                isProcessing = true;
-                Simulator::Schedule(MilliSeconds(1), &PoFiAp::ProcessQueue, this);
+            ScheduleDrain(m_nextServiceTime > Simulator::Now() ? m_nextServiceTime - Simulator::Now() : Time(0));
+        }
+
+        static AcIndex PriorityToAc(KDNController::Priority priority) {
+            switch (priority) {
+                case KDNController::HIGH:   return AC_VO;
+                case KDNController::MEDIUM: return AC_VI;
+                case KDNController::LOW:    return AC_BE;
+                default:                    return AC_BK;     // NRT
+            }
+        }
+
+        // Programa un vaciado solo si no hay uno pendiente: sin trabajo no hay eventos.
+        void ScheduleDrain(Time delay) {
+            if (m_drainEvent.IsPending()) {
+                return;
+            }
+            m_drainEvent = Simulator::Schedule(delay, &PoFiAp::ProcessQueue, this);
+        }
+
+        bool DeviceCanAccept(KDNController::Priority priority) const {
+            if (m_drainMode != DRAIN_DEVICE || !m_wifiMac) {
+                return true;
+            }
+            return m_wifiMac->GetTxopQueue(PriorityToAc(priority))->GetNPackets() < m_txQueueLimit;
+        }
+
+        void DeviceQueueDequeue(Ptr<const WifiMpdu> mpdu) {
+            if (m_waitingDevice) {
+                m_waitingDevice = false;
+                Simulator::Cancel(m_drainEvent);
+                ScheduleDrain(Time(0));
             }
         }
         
+        const QueueItem* QueueHead(KDNController::Priority priority) const {
+            return m_queues[priority].empty() ? nullptr : &m_queues[priority].front();
+        }
+
+        QueueItem PopQueue(KDNController::Priority priority) {
+            return m_queues[priority].pop();
+        }
+
+        size_t QueueSize(KDNController::Priority priority) const {
+            return m_queues[priority].size();
+        }
+
+        void DropPacket(KDNController::Priority priority, const QueueItem& item, const char* reason) {
+            metricsTable[priority].packetsLost++;
+            SDWN_PACKET_LOG_INFO(item.packet->GetUid(), "[PoFiAp] Dropped packet from " << item.sender << " in "
+                << KDNController::PriorityName(priority) << " queue (" << reason << ")");
+        }
+
+        // Admisión al encolar: límite duro y, con RED, descarte temprano por ocupación media
+        bool AdmitPacket(KDNController::Priority priority) {
+            const size_t length = QueueSize(priority);
+            const uint32_t capacity = m_queueCapacity[priority];
+            if (m_aqm == AQM_RED && capacity > 0) {
+                AqmState& state = m_aqmState[priority];
+                state.redAverage += RED_WEIGHT * (length - state.redAverage);
+                const double minTh = RED_MIN_FRACTION * capacity;
+                const double maxTh = RED_MAX_FRACTION * capacity;
+                if (state.redAverage >= maxTh) {
+                    state.redCount = 0;
+                    return false;
+                }
+                if (state.redAverage >= minTh) {
+                    state.redCount++;
+                    double pb = RED_MAX_P * (state.redAverage - minTh) / (maxTh - minTh);
+                    double pa = state.redCount * pb >= 1 ? 1.0 : pb / (1 - state.redCount * pb);
+                    if (m_redRandom->GetValue() < pa) {
+                        state.redCount = 0;
+                        return false;
+                    }
+                } else {
+                    state.redCount = -1;
+                }
+            }
+            return capacity == 0 || length < capacity;
+        }
+
+        // Extrae la cabeza de la clase; con CoDel puede descartar antes una o varias cabezas
+        bool DequeueItem(KDNController::Priority priority, QueueItem& out) {
+            if (m_aqm != AQM_CODEL) {
+                out = PopQueue(priority);
+                return true;
+            }
+            AqmState& state = m_aqmState[priority];
+            Time now = Simulator::Now();
+            bool okToDrop = false;
+            if (!CoDelPop(priority, out, okToDrop)) {
+                state.codelDropping = false;
+                return false;
+            }
+            if (state.codelDropping) {
+                if (!okToDrop) {
+                    state.codelDropping = false;
+                }
+                while (state.codelDropping && now >= state.codelDropNext) {
+                    DropPacket(priority, out, "CoDel");
+                    state.codelCount++;
+                    if (!CoDelPop(priority, out, okToDrop)) {
+                        state.codelDropping = false;
+                        return false;
+                    }
+                    if (!okToDrop) {
+                        state.codelDropping = false;
+                    } else {
+                        state.codelDropNext = CoDelControlLaw(state.codelDropNext, state.codelCount);
+                    }
+                }
+            } else if (okToDrop) {
+                DropPacket(priority, out, "CoDel");
+                bool more = CoDelPop(priority, out, okToDrop);
+                state.codelDropping = true;
+                uint32_t delta = state.codelCount - state.codelLastCount;
+                state.codelCount = (delta > 1 && now - state.codelDropNext < 16 * m_codelInterval) ? delta : 1;
+                state.codelDropNext = CoDelControlLaw(now, state.codelCount);
+                state.codelLastCount = state.codelCount;
+                return more;
+            }
+            return true;
+        }
+
+        // dodequeue() de RFC 8289: okToDrop si la permanencia supera target durante todo un interval
+        bool CoDelPop(KDNController::Priority priority, QueueItem& out, bool& okToDrop) {
+            AqmState& state = m_aqmState[priority];
+            okToDrop = false;
+            if (!QueueHead(priority)) {
+                state.codelFirstAbove = Time(0);
+                return false;
+            }
+            out = PopQueue(priority);
+            Time now = Simulator::Now();
+            if (now - out.arrivalTime < m_codelTarget || !QueueHead(priority)) {
+                state.codelFirstAbove = Time(0);
+            } else if (state.codelFirstAbove.IsZero()) {
+                state.codelFirstAbove = now + m_codelInterval;
+            } else if (now >= state.codelFirstAbove) {
+                okToDrop = true;
+            }
+            return true;
+        }
+
+        Time CoDelControlLaw(Time t, uint32_t count) const {
+            return t + Seconds(m_codelInterval.GetSeconds() / std::sqrt(static_cast<double>(count)));
+        }
+
+        bool QueuesEmpty() const {
+            for (const RingQueue<QueueItem>& queue : m_queues) {
+                if (!queue.empty()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
         void ProcessQueue() {
-            /*NS_LOG_INFO("[PoFiAp] HIGH QUEUE " << highPriorityQueue.size()
-                         << " MEDIUM QUEUE " << mediumPriorityQueue.size()
-                         << " LOW QUEUE " << lowPriorityQueue.size());*/
-            
-            if (highPriorityQueue.empty() && mediumPriorityQueue.empty() && lowPriorityQueue.empty()) {
-                isProcessing = false;
-                return;
+            /*NS_LOG_INFO("[PoFiAp] HIGH QUEUE " << QueueSize(KDNController::HIGH)
+                         << " MEDIUM QUEUE " << QueueSize(KDNController::MEDIUM)
+                         << " LOW QUEUE " << QueueSize(KDNController::LOW)
+                         << " NRT QUEUE " << QueueSize(KDNController::NRT));*/
+            m_waitingDevice = false;
+
+            while (!QueuesEmpty()) {
+                // La disciplina elige entre las clases cuya cola MAC admite otro paquete
+                PoFiScheduler::Heads heads;
+                for (uint32_t p = 0; p < N_EDCA_SLOTS; ++p) {
+                    auto priority = static_cast<KDNController::Priority>(p);
+                    if (const QueueItem* head = QueueHead(priority)) {
+                        heads[p] = {true, DeviceCanAccept(priority), head->packet->GetSize()};
+                    }
+                }
+                int selected = m_scheduler->Select(heads);
+                if (selected < 0) {
+                    // Dispositivo lleno: esperar al trace Dequeue, con watchdog por si no llega
+                    m_waitingDevice = true;
+                    ScheduleDrain(m_pollInterval);
+                    return;
+                }
+                QueueItem item;
+                if (!DequeueItem(static_cast<KDNController::Priority>(selected), item)) {
+                    continue;   // CoDel descartó toda la cola de la clase
+                }
+                m_scheduler->OnServed(selected, item.packet->GetSize());
+
+                // Pasar el arrivalTime a ForwardPacket
+                uint32_t size = item.packet->GetSize();
+                ForwardPacket(static_cast<KDNController::Priority>(selected), std::move(item.packet), item.tos, item.sender, item.arrivalTime);
+
+                if (m_drainMode == DRAIN_RATE) {
+                    Time serviceTime = m_serviceRate.CalculateBytesTxTime(size);
+                    m_nextServiceTime = Simulator::Now() + serviceTime;
+                    if (!QueuesEmpty()) {
+                        ScheduleDrain(serviceTime);
+                    }
+                    return;
+                }
             }
-            
-            QueueItem item;
-            if (!highPriorityQueue.empty()) {
-                item = highPriorityQueue.top();
-                highPriorityQueue.pop();
-            } else if (!mediumPriorityQueue.empty()) {
-                item = mediumPriorityQueue.top();
-                mediumPriorityQueue.pop();
-            } else {
-                item = lowPriorityQueue.front();
-                lowPriorityQueue.pop();
+        }
+
+        // Informe periódico por clase (deltas desde el anterior) hacia el controlador
+        void ReportStats() {
+            KDNController::AcReports reports;
+            for (uint32_t p = 0; p < N_EDCA_SLOTS; ++p) {
+                const Metrics& metrics = metricsTable[p];
+                const Metrics& last = m_lastReported[p];
+                KDNController::AcReport& report = reports[p];
+                report.packetsReceived = metrics.packetsReceived - last.packetsReceived;
+                report.packetsSent = metrics.packetsSent - last.packetsSent;
+                report.packetsDropped = metrics.packetsLost - last.packetsLost;
+                report.meanDelayMs = report.packetsSent > 0
+                    ? (metrics.latencyTotal - last.latencyTotal) / report.packetsSent : 0.0;
+            }
+            m_lastReported = metricsTable;
+            m_controller->SendStatsReport(m_cell, reports, MakeCallback(&PoFiAp::EdcaFlowModReceived, this));
+            m_controlEvent = Simulator::Schedule(m_controlPeriod, &PoFiAp::ReportStats, this);
+        }
+
+        void EdcaFlowModReceived(KDNController::EdcaSet set) {
+            for (uint32_t p = 0; p < N_EDCA_SLOTS; ++p) {
+                EdcaConfig config = edcaParams[p];
+                config.aifsn = set[p].aifsn;
+                config.cwMin = set[p].cwMin;
+                config.cwMax = set[p].cwMax;
+                SetEdcaConfig(static_cast<KDNController::Priority>(p), config);
             }
-            
-            // Pasar el arrivalTime a ForwardPacket
-            ForwardPacket(item.packet, item.tos, item.sender, item.arrivalTime);
-            Simulator::Schedule(MilliSeconds(1), &PoFiAp::ProcessQueue, this);
         }
 
-        void ForwardPacket(Ptr<Packet> packet, uint8_t tos, Ipv4Address originalSender, Time arrivalTime) {
-            KDNController::FlowMod entry = tosRegistry[tos];
+        // priority: clase que lo sirvió (con PENDING_DEFAULT puede no ser la de su FlowMod)
+        void ForwardPacket(KDNController::Priority priority, Ptr<Packet> packet, uint8_t tos, Ipv4Address originalSender, Time arrivalTime) {
+            const KDNController::FlowMod& entry = flowTable[tos].mod;
         
-            // 1. Configurar TXOP
-            ConfigureEdca(entry.priority, entry.txopLimit);
+            // 1. El EDCA ya se aplicó al instalar la FlowMod (ConfigureEdca)
         
             // 2. Configurar socket para el envío
             m_socket->SetIpTos(tos);
@@ -272,18 +1522,9 @@ class PoFiAp : public Application {
             Time latency = now - arrivalTime;
             double latencyMs = latency.GetSeconds() * 1000.0;
             
-            Metrics& metrics = metricsMap[entry.priority];
-            metrics.packetsSent++;
-            metrics.bytesSent += packet->GetSize();
-            
-            if (metrics.packetsSent > 1) {
-                double lastLatency = metrics.latencyTotal / (metrics.packetsSent - 1);
-                double jitter = std::abs(latencyMs - lastLatency);
-                metrics.jitterTotal += jitter;
-            }
-            metrics.latencyTotal += latencyMs;
+            RecordSent(priority, packet->GetSize(), latencyMs);
             
-            NS_LOG_INFO("[PoFiAp] Sending packet to: " << originalSender 
+            SDWN_PACKET_LOG_INFO(packet->GetUid(), "[PoFiAp] Sending packet to: " << originalSender 
                        << " | ToS: 0x" << std::hex << static_cast<uint32_t>(tos)
                        << " | Size: " << std::dec << packet->GetSize() << " bytes"
                        << " | Latency: " << latencyMs << "ms"
@@ -293,48 +1534,34 @@ class PoFiAp : public Application {
         }
         
         void ConfigureEdca(KDNController::Priority priority, uint32_t txopMicroSeconds) {
-    		Time txopLimit = MicroSeconds(txopMicroSeconds);
-
-    		Ptr<NetDevice> device = GetNode()->GetDevice(0);
-    		Ptr<WifiNetDevice> wifiDevice = DynamicCast<WifiNetDevice>(device);
+    		EdcaSlot& slot = m_edca[priority];
+    		const EdcaConfig& config = edcaParams[priority];
 
-    		if (!wifiDevice) {
-        		NS_LOG_ERROR("[PoFiAp] Device 0 is not a WifiNetDevice!");
+    		if (!slot.txop) {
+        		NS_LOG_ERROR("[PoFiAp] EDCA pointer is null for priority: " << priority);
         		return;
     		}
 
-    		Ptr<WifiMac> wifiMac = wifiDevice->GetMac();
-    		PointerValue ptr;
-    		Ptr<QosTxop> edca;
-
-    		std::string ac;
-    		switch (priority) {
-        		case KDNController::HIGH:   ac = "VO"; break;
-        		case KDNController::MEDIUM: ac = "VI"; break;
-        		case KDNController::LOW:    ac = "BE"; break;
-        		default:                     ac = "BK"; break;
-    		}
-
-    		// Obtener configuración desde el mapa
-    		EdcaConfig config = edcaParams[ac];
-
-    		// Seleccionar el atributo correcto
-    		wifiMac->GetAttribute(ac + "_Txop", ptr);
-    		edca = ptr.Get<QosTxop>();
-
-    		if (!edca) {
-        		NS_LOG_ERROR("[PoFiAp] EDCA pointer is null for AC: " << ac);
+    		// Nada que empujar si la MAC ya tiene estos parámetros
+    		if (slot.configured && slot.txopLimit == txopMicroSeconds
+    		    && slot.applied.aifsn == config.aifsn
+    		    && slot.applied.cwMin == config.cwMin
+    		    && slot.applied.cwMax == config.cwMax) {
         		return;
     		}
 
     		// Aplicar configuración
-    		edca->SetTxopLimit(txopLimit);
-    		edca->SetAifsn(config.aifsn);
-    		edca->SetMinCw(config.cwMin);
-    		edca->SetMaxCw(config.cwMax);
+    		Time txopLimit = MicroSeconds(txopMicroSeconds);
+    		slot.txop->SetTxopLimit(txopLimit);
+    		slot.txop->SetAifsn(config.aifsn);
+    		slot.txop->SetMinCw(config.cwMin);
+    		slot.txop->SetMaxCw(config.cwMax);
+    		slot.configured = true;
+    		slot.applied = config;
+    		slot.txopLimit = txopMicroSeconds;
 
     		// (Opcional) Log para confirmar configuración
-   		 	NS_LOG_INFO("[PoFiAp] Configured " << ac 
+   		 	NS_LOG_INFO("[PoFiAp] Configured AC " << slot.txop->GetAccessCategory()
                  	<< " with AIFSN=" << config.aifsn 
                  	<< ", CWmin=" << config.cwMin 
                  	<< ", CWmax=" << config.cwMax 
@@ -342,40 +1569,27 @@ class PoFiAp : public Application {
 		}
 
 
-        void PoFiApStats() {
-            uint32_t numStas = NodeList::GetNNodes() - 1; // Restamos 1 para excluir el AP
-            
-            // Nombre del archivo CSV con número de STAs
-            const std::string category = "BE+BK+VI+VO";
-            const std::string packetsize = "1024";
-        	const std::string filepath = "scratch/Finals/estadisticas/" + category + "/10S-5S-1S/Modified/" + packetsize;
-			fs::create_directories(filepath);
-            // system(("mkdir -p " + filepath).c_str());
-			const std::string csvFilename = filepath + "/SDWN_NS3_PoFiAp_"+ category + "_Priority_" + std::to_string(numStas) + "_DEVICES_" +  packetsize +"_PacketSize_10_Min_Modified.csv";
-            
-
-            // Abrir archivo CSV
-            std::ofstream csvFile(csvFilename);
-            if (!csvFile.is_open()) {
+        // Una fila por clase y celda en el CSV compartido de la corrida (append + flock, como
+        // Cell_Metrics: varias celdas, hijos del fork y trabajadores pueden escribir a la vez)
+        void PoFiApStats(const std::string& csvFilename) {
+            int fd = ::open(csvFilename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (fd < 0) {
                 NS_LOG_ERROR("No se pudo abrir el archivo CSV: " << csvFilename);
                 return;
             }
 
-            // Escribir encabezados del CSV
-            csvFile << "Priority,PacketsReceived,PacketsSent,BytesReceived,BytesSent,"
-                    << "ThroughputKbps,AvgLatencyMs,AvgJitterMs\n";
+            // Throughput sobre la ventana medida (tras ResetMetrics en los hijos del fork)
+            const double windowS = (Simulator::Now() - m_metricsStart).GetSeconds();
+            std::ostringstream csvFile;
 
-            std::map<KDNController::Priority, std::string> labels = {
-                {KDNController::HIGH, "HIGH"},
-                {KDNController::MEDIUM, "MEDIUM"},
-                {KDNController::LOW, "LOW"}
-            };
+            const std::array<std::string, N_EDCA_SLOTS> labels = {"HIGH", "MEDIUM", "LOW", "NRT"};
 
-            for (const auto& [priority, stats] : metricsMap) {
+            for (uint32_t priority = 0; priority < N_EDCA_SLOTS; ++priority) {
+                const Metrics& stats = metricsTable[priority];
                 if (stats.packetsSent == 0) continue;
 
                 // Calcular métricas
-                double throughput = (stats.bytesSent * 8.0) / Simulator::Now().GetSeconds() / 1024.0;
+                double throughput = windowS > 0 ? (stats.bytesSent * 8.0) / windowS / 1000.0 : 0.0;
                 double avgLatency = stats.latencyTotal / stats.packetsSent;
                 double avgJitter = (stats.packetsSent > 1) ? (stats.jitterTotal / (stats.packetsSent - 1)) : 0.0;
 
@@ -383,6 +1597,7 @@ class PoFiAp : public Application {
                 NS_LOG_INFO("=== " << labels[priority] << " Priority Metrics ===");
                 NS_LOG_INFO("Packets Received: " << stats.packetsReceived);
                 NS_LOG_INFO("Packets Sent:     " << stats.packetsSent);
+                NS_LOG_INFO("Dropped at AP:    " << stats.packetsLost);
                 NS_LOG_INFO("Bytes Received:   " << stats.bytesReceived);
                 NS_LOG_INFO("Bytes Sent:       " << stats.bytesSent);
                 NS_LOG_INFO("Throughput (Kbps): " << std::fixed << std::setprecision(2) << throughput);
@@ -393,9 +1608,11 @@ class PoFiAp : public Application {
                 }
 
                 // Escribir en CSV
-                csvFile << labels[priority] << ","
+                csvFile << m_cell << ","
+                        << labels[priority] << ","
                         << stats.packetsReceived << ","
                         << stats.packetsSent << ","
+                        << stats.packetsLost << ","
                         << stats.bytesReceived << ","
                         << stats.bytesSent << ","
                         << std::fixed << std::setprecision(2) << throughput << ","
@@ -410,7 +1627,17 @@ class PoFiAp : public Application {
                 csvFile << "\n";
             }
 
-            csvFile.close();
+            ::flock(fd, LOCK_EX);
+            std::string text = csvFile.str();
+            if (::lseek(fd, 0, SEEK_END) == 0) {
+                text = "Cell,Priority,PacketsReceived,PacketsSent,PacketsDroppedAP,BytesReceived,BytesSent,"
+                       "ThroughputKbps,AvgLatencyMs,AvgJitterMs\n" + text;
+            }
+            ssize_t written = ::write(fd, text.data(), text.size());
+            ::close(fd);                // También libera el flock
+            if (written != static_cast<ssize_t>(text.size())) {
+                NS_LOG_ERROR("Escritura incompleta en " << csvFilename);
+            }
             NS_LOG_INFO("Estadísticas exportadas a CSV: " << csvFilename);
         }
     };
@@ -425,12 +1652,61 @@ class PoFiApHelper {
         void SetPort(uint16_t port) {
             m_port = port;
         }
+
+        void SetScheduler(PoFiAp::DrainMode mode, uint32_t txQueueLimit, DataRate serviceRate, Time pollInterval) {
+            m_drainMode = mode;
+            m_txQueueLimit = txQueueLimit;
+            m_serviceRate = serviceRate;
+            m_pollInterval = pollInterval;
+        }
+
+        void SetRxCopyHeader(bool copyHeader) {
+            m_rxCopyHeader = copyHeader;
+        }
+
+        void SetQueueManagement(PoFiAp::AqmMode mode, const std::array<uint32_t, PoFiAp::N_EDCA_SLOTS>& capacity, Time codelTarget, Time codelInterval) {
+            m_aqm = mode;
+            m_queueCapacity = capacity;
+            m_codelTarget = codelTarget;
+            m_codelInterval = codelInterval;
+        }
+
+        void SetController(std::shared_ptr<KDNController> controller) {
+            m_controller = std::move(controller);
+        }
+
+        void SetPendingAction(PoFiAp::PendingAction action, uint32_t bufferLimit) {
+            m_pendingAction = action;
+            m_pendingLimit = bufferLimit;
+        }
+
+        void SetControlPeriod(Time period) {
+            m_controlPeriod = period;
+        }
+
+        // Disciplina entre clases: "strict", "drr" o "wfq"; pesos por clase H, M, L, NRT
+        void SetDiscipline(const std::string& name, const std::array<double, PoFiAp::N_EDCA_SLOTS>& weights, uint32_t drrQuantumBytes) {
+            m_discipline = name;
+            m_weights = weights;
+            m_drrQuantumBytes = drrQuantumBytes;
+        }
     
-        ApplicationContainer Install(NodeContainer nodes) const {
+        // cells: celda de cada AP de 'nodes' (vacío = su posición en 'nodes')
+        ApplicationContainer Install(NodeContainer nodes, const std::vector<uint32_t>& cells = {}) const {
             ApplicationContainer apps;
             for (uint32_t i = 0; i < nodes.GetN(); ++i) {
                 Ptr<PoFiAp> app = CreateObject<PoFiAp>();
                 app->Setup(m_port);
+                app->SetScheduler(m_drainMode, m_txQueueLimit, m_serviceRate, m_pollInterval);
+                app->SetRxCopyHeader(m_rxCopyHeader);
+                app->SetDiscipline(CreatePoFiScheduler(m_discipline, m_weights, m_drrQuantumBytes));
+                app->SetQueueManagement(m_aqm, m_queueCapacity, m_codelTarget, m_codelInterval);
+                if (m_controller) {
+                    app->SetController(m_controller);
+                }
+                app->SetPendingAction(m_pendingAction, m_pendingLimit);
+                app->SetControlPeriod(m_controlPeriod);
+                app->SetCell(cells.empty() ? i : cells[i]);
                 nodes.Get(i)->AddApplication(app);
                 apps.Add(app);
             }
@@ -439,41 +1715,875 @@ class PoFiApHelper {
     
     private:
         uint16_t m_port;
+        PoFiAp::DrainMode m_drainMode = PoFiAp::DRAIN_DEVICE;
+        uint32_t m_txQueueLimit = 8;
+        DataRate m_serviceRate = DataRate("54Mbps");
+        Time m_pollInterval = MilliSeconds(1);
+        bool m_rxCopyHeader = false;
+        std::string m_discipline = "strict";
+        std::array<double, PoFiAp::N_EDCA_SLOTS> m_weights{{8, 4, 2, 1}};
+        uint32_t m_drrQuantumBytes = 1500;
+        PoFiAp::AqmMode m_aqm = PoFiAp::AQM_TAILDROP;
+        std::array<uint32_t, PoFiAp::N_EDCA_SLOTS> m_queueCapacity{};
+        Time m_codelTarget = MilliSeconds(5);
+        Time m_codelInterval = MilliSeconds(100);
+        std::shared_ptr<KDNController> m_controller;     // nullptr: cada AP con su propio controlador
+        PoFiAp::PendingAction m_pendingAction = PoFiAp::PENDING_BUFFER;
+        uint32_t m_pendingLimit = 64;
+        Time m_controlPeriod;
 };
 
 // *********************************************************************************
-// ******************************* Global Variables ********************************
+// ******************************** OnlineAcStats **********************************
 // *********************************************************************************
-uint32_t nStaWifi = 10;             // Number of WiFi STAs
-uint32_t PacketSize = 512;          // Packet size in bytes
-double radio = 50.0;                // Coverage radius in meters
-uint16_t port = 8080;               // Port for UDP communication
-double TimeSimulationMin = 10.0;    // Simulation time in minutes
-uint32_t nCorrida = 1;              // Run number
-bool enablePcap = false;            // Enable PCAP capture
-bool enableAnimation = false;       // Enable animation output
-bool enableXml = false;             // Enable XML flow monitor output
-double delayBetweenStartsMs = 25.0; // Delay between STA starts in ms
-std::string category = "SDWN_EDCA"; // Category for file organization
-uint32_t RngSeed = 0;               // Random seed for simulation
-std::string mobilityType = "mixer"; // "yes", "no", o "mixer"
-bool model_realist = true;          // Modelado realista
-
-uint32_t nStaH = 3;                 // Number of High priority STAs (VO)
-uint32_t nStaM = 3;                 // Number of Medium priority STAs (VI)
-uint32_t nStaL = 2;                 // Number of Low priority STAs (BE)
-uint32_t nStaNRT = 2;               // Number of Non Real Time STAs (BK)
+// Estimador P² (Jain & Chlamtac, 1985): un cuantil en streaming con 5 marcadores, memoria O(1).
+class P2Quantile {
+    public:
+        explicit P2Quantile(double p) : m_p(p) {}
 
-uint8_t		FrameRetryLimit	= 7;                // WiFi Frame Retry Limit
-bool 		RentryPackets 	= false;            // Enable packet retry
-std::string	FragmentationThreshold = "2200";    // WiFi fragmentation threshold
+        void Add(double x) {
+            if (m_count < 5) {
+                m_q[m_count++] = x;
+                if (m_count == 5) {
+                    std::sort(m_q, m_q + 5);
+                    const double np[5] = {0, 2 * m_p, 4 * m_p, 2 + 2 * m_p, 4};
+                    const double dn[5] = {0, m_p / 2, m_p, (1 + m_p) / 2, 1};
+                    for (int i = 0; i < 5; ++i) {
+                        m_n[i] = i;
+                        m_np[i] = np[i];
+                        m_dn[i] = dn[i];
+                    }
+                }
+                return;
+            }
 
-        
+            // Celda donde cae x (ajustando los extremos si hace falta)
+            int k;
+            if (x < m_q[0]) {
+                m_q[0] = x;
+                k = 0;
+            } else if (x >= m_q[4]) {
+                m_q[4] = x;
+                k = 3;
+            } else {
+                k = 0;
+                while (x >= m_q[k + 1]) {
+                    k++;
+                }
+            }
+            for (int i = k + 1; i < 5; ++i) {
+                m_n[i]++;
+            }
+            for (int i = 0; i < 5; ++i) {
+                m_np[i] += m_dn[i];
+            }
+            m_count++;
+
+            // Mover los marcadores centrales hacia su posición deseada
+            for (int i = 1; i < 4; ++i) {
+                double d = m_np[i] - m_n[i];
+                if ((d >= 1 && m_n[i + 1] - m_n[i] > 1) || (d <= -1 && m_n[i - 1] - m_n[i] < -1)) {
+                    int s = d >= 0 ? 1 : -1;
+                    double q = Parabolic(i, s);
+                    if (m_q[i - 1] < q && q < m_q[i + 1]) {
+                        m_q[i] = q;
+                    } else {
+                        m_q[i] += s * (m_q[i + s] - m_q[i]) / (m_n[i + s] - m_n[i]);
+                    }
+                    m_n[i] += s;
+                }
+            }
+        }
+
+        double Get() const {
+            if (m_count >= 5) {
+                return m_q[2];
+            }
+            if (m_count == 0) {
+                return 0.0;
+            }
+            // Menos de 5 muestras: cuantil exacto sobre las guardadas
+            double sorted[5];
+            std::copy(m_q, m_q + m_count, sorted);
+            std::sort(sorted, sorted + m_count);
+            return sorted[std::min<uint64_t>(m_count - 1, static_cast<uint64_t>(m_p * m_count))];
+        }
+
+    private:
+        double Parabolic(int i, int s) const {
+            return m_q[i] + s / (m_n[i + 1] - m_n[i - 1]) *
+                   ((m_n[i] - m_n[i - 1] + s) * (m_q[i + 1] - m_q[i]) / (m_n[i + 1] - m_n[i]) +
+                    (m_n[i + 1] - m_n[i] - s) * (m_q[i] - m_q[i - 1]) / (m_n[i] - m_n[i - 1]));
+        }
+
+        double m_p;
+        uint64_t m_count = 0;
+        double m_q[5] = {};     // Alturas de los marcadores
+        double m_n[5] = {};     // Posiciones actuales
+        double m_np[5] = {};    // Posiciones deseadas
+        double m_dn[5] = {};    // Incremento de las posiciones deseadas por muestra
+};
+
+// Estadísticas por AC calculadas durante la simulación, sin recorrer FlowMonitor al final.
+// Emisor: traza "Tx" de cada UdpEchoClient; receptor: traza Ipv4 "Rx" del AP; se emparejan
+// por UID del paquete (mismo flujo STA -> AP que SDWN/02_Concatenate_Results.py toma del CSV).
+// WriteRow() estima, para una sola corrida, los 24 objetivos del Random Forest con la semántica
+// de IA/02_Stadistics.py (el script que genera el conjunto de entrenamiento de RF Model.py):
+// cada perdido suma lostPenaltyMs al delay de su flujo, se excluyen los flujos con
+// maxLostPackets perdidos o más y la desviación es muestral. El script agrega además todas las
+// corridas de una configuración; Flows_* permite reproducir ese agregado a partir de las filas.
+// Con EnableWindows() publica además cada N segundos una fila por AC con throughput, delay y
+// pérdida de la ventana; EnableEarlyStop() usa esas ventanas como medias por lotes y detiene
+// el simulador cuando el IC del 95% de todas las métricas baja de la tolerancia relativa.
+class OnlineAcStats {
+    public:
+        static constexpr uint32_t N_CLASSES = 4;    // H, M, L, NRT (mismo orden que KDNController::Priority)
+
+        // maxLostPackets <= 0 no excluye ningún flujo
+        OnlineAcStats(Time lossTimeout, double lostPenaltyMs, double maxLostPackets)
+            : m_lossTimeout(lossTimeout), m_lostPenaltyMs(lostPenaltyMs), m_maxLostPackets(maxLostPackets) {}
+
+        void AddStation(Ptr<Application> client, uint32_t priority) {
+            uint32_t nodeId = client->GetNode()->GetId();
+            if (nodeId >= m_nodeToFlow.size()) {
+                m_nodeToFlow.resize(nodeId + 1, NO_FLOW);
+            }
+            m_nodeToFlow[nodeId] = m_flows.size();
+            m_flows.emplace_back();
+            m_flows.back().priority = std::min(priority, N_CLASSES - 1);
+            client->TraceConnectWithoutContext("Tx", MakeCallback(&OnlineAcStats::ClientTx, this));
+        }
+
+        void AttachReceiver(Ptr<Node> node) {
+            node->GetObject<Ipv4>()->TraceConnectWithoutContext("Rx", MakeCallback(&OnlineAcStats::ReceiverRx, this));
+        }
+
+        // Métricas por ventana: una fila por AC (con flujos) cada 'window' en 'os', precedida de
+        // rowPrefix. Las ventanas que terminan antes de 'warmup' no cuentan para la convergencia.
+        void EnableWindows(Time window, std::ostream* os, const std::string& rowPrefix, Time warmup) {
+            m_window = window;
+            m_windowOs = os;
+            m_rowPrefix = rowPrefix;
+            m_warmup = warmup;
+            Simulator::Cancel(m_windowEvent);
+            m_windowEvent = Simulator::Schedule(window, &OnlineAcStats::CloseWindow, this);
+        }
+
+        void EnableEarlyStop(double tolerance, uint32_t minWindows) {
+            m_tolerance = tolerance;
+            m_minWindows = std::max<uint32_t>(minWindows, 2);
+        }
+
+        bool Converged() const {
+            return m_converged;
+        }
+
+        // Descarta lo medido hasta ahora (fork tras el calentamiento): los paquetes en vuelo
+        // ya no cuentan y cada flujo vuelve a empezar en su próximo envío
+        void Reset() {
+            for (FlowAcc& flow : m_flows) {
+                flow = FlowAcc{flow.priority};
+            }
+            m_classes.fill(AcAcc());
+            m_pending.clear();
+            m_windowAcc.fill(WindowAcc());
+            m_windowStats = {};
+            m_converged = false;
+        }
+
+        static void WriteWindowHeader(std::ostream& os) {
+            os << ",Time(s),Priority,Throughput(Kbps),Delay(ms),LostPackets(%),SentPackets,ReceivedPackets,LostPackets"
+               << ",Throughput_CI,Delay_CI,LostPackets_CI,Converged";
+        }
+
+        static void WriteHeader(std::ostream& os) {
+            for (const char* sfx : {"H", "M", "L", "NRT"}) {
+                os << ",Throughput_" << sfx << "_mean,Throughput_" << sfx << "_std"
+                   << ",Delay_" << sfx << "_mean,Delay_" << sfx << "_std"
+                   << ",LostPackets_" << sfx << "_mean,LostPackets_" << sfx << "_sum"
+                   << ",SendPackets_" << sfx << "_sum,Flows_" << sfx
+                   << ",Delay_" << sfx << "_p50,Delay_" << sfx << "_p95,Delay_" << sfx << "_p99"
+                   << ",DelayPkt_" << sfx << "_mean,DelayPkt_" << sfx << "_std"
+                   << ",Jitter_" << sfx << "_mean";
+            }
+        }
+
+        // Fila de objetivos con el estado actual; los paquetes pendientes con más de
+        // lossTimeout se cuentan como perdidos (igual que LostPacketThreshold de FlowMonitor).
+        void WriteRow(std::ostream& os) const {
+            std::vector<uint32_t> lost = LostPerFlow();
+            for (uint32_t c = 0; c < N_CLASSES; ++c) {
+                ClassSummary summary = Summarize(c, lost);
+                const AcAcc& ac = m_classes[c];
+                os << "," << summary.throughput.Mean() << "," << summary.throughput.SampleStd()
+                   << "," << summary.delay.Mean() << "," << summary.delay.SampleStd()
+                   << "," << summary.LossPct() << "," << summary.lostSum
+                   << "," << summary.sent << "," << summary.throughput.count
+                   << "," << ac.p50.Get() << "," << ac.p95.Get() << "," << ac.p99.Get()
+                   << "," << ac.delay.Mean() << "," << ac.delay.SampleStd()
+                   << "," << (summary.throughput.count > 0 ? summary.jitterSum / summary.throughput.count : 0.0);
+            }
+        }
+
+        // Delay_X_mean (ms) y LostPackets_X_mean (%) de WriteRow: los términos D_X y L_X del objetivo
+        void ClassTargets(std::array<double, N_CLASSES>& delayMs, std::array<double, N_CLASSES>& lossPct) const {
+            std::vector<uint32_t> lost = LostPerFlow();
+            for (uint32_t c = 0; c < N_CLASSES; ++c) {
+                ClassSummary summary = Summarize(c, lost);
+                delayMs[c] = summary.delay.Mean();
+                lossPct[c] = summary.LossPct();
+            }
+        }
+
+    private:
+        static constexpr size_t NO_FLOW = std::numeric_limits<size_t>::max();
+
+        struct Welford {
+            uint64_t count = 0;
+            double mean = 0.0;
+            double m2 = 0.0;
+
+            void Add(double x) {
+                count++;
+                double d = x - mean;
+                mean += d / count;
+                m2 += d * (x - mean);
+            }
+            double Mean() const { return mean; }
+            double SampleStd() const { return count > 1 ? std::sqrt(m2 / (count - 1)) : 0.0; }
+            // Semiancho del IC del 95% de la media (t de Student)
+            double HalfWidth95() const {
+                static const double t95[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                             2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086};
+                if (count < 2) {
+                    return std::numeric_limits<double>::infinity();
+                }
+                double t = count - 1 <= 20 ? t95[count - 2] : 1.96;
+                return t * SampleStd() / std::sqrt(static_cast<double>(count));
+            }
+        };
+
+        struct ClassSummary {
+            Welford throughput;             // Por flujo (Kbps)
+            Welford delay;                  // Por flujo, con penalización de perdidos (ms)
+            uint64_t sent = 0;
+            uint64_t lostSum = 0;
+            double jitterSum = 0.0;
+
+            double LossPct() const { return sent > 0 ? 100.0 * lostSum / sent : 0.0; }
+        };
+
+        struct FlowAcc {
+            uint32_t priority = 0;
+            uint32_t sent = 0;
+            uint32_t received = 0;
+            uint32_t lost = 0;              // Ya vencidos (barridos al cerrar cada ventana)
+            uint64_t rxBytes = 0;           // Bytes a nivel IP, como rxBytes de FlowMonitor
+            Time firstTx;
+            Time lastRx;
+            double delaySumMs = 0.0;
+            double lastTransitMs = 0.0;
+            double jitterMs = 0.0;          // RFC 3550: J += (|D| - J) / 16
+        };
+
+        struct AcAcc {
+            Welford delay;
+            P2Quantile p50{0.50};
+            P2Quantile p95{0.95};
+            P2Quantile p99{0.99};
+        };
+
+        struct WindowAcc {
+            uint64_t sent = 0;
+            uint64_t received = 0;
+            uint64_t lost = 0;              // Declarados perdidos durante la ventana
+            uint64_t rxBytes = 0;
+            double delaySumMs = 0.0;
+        };
+
+        enum WindowMetric { W_THROUGHPUT, W_DELAY, W_LOSS, N_WINDOW_METRICS };
+
+        struct PendingTx {
+            size_t flow;
+            Time txTime;
+        };
+
+        // Perdidos por flujo: los ya barridos más los pendientes con más de lossTimeout
+        // (igual que LostPacketThreshold de FlowMonitor)
+        std::vector<uint32_t> LostPerFlow() const {
+            Time now = Simulator::Now();
+            std::vector<uint32_t> lost(m_flows.size(), 0);
+            for (size_t f = 0; f < m_flows.size(); ++f) {
+                lost[f] = m_flows[f].lost;
+            }
+            for (const auto& pending : m_pending) {
+                if (now - pending.second.txTime > m_lossTimeout) {
+                    lost[pending.second.flow]++;
+                }
+            }
+            return lost;
+        }
+
+        // Agregado de una AC con el filtro de IA/02_Stadistics.py (LostPackets < maxLostPackets, absoluto)
+        ClassSummary Summarize(uint32_t c, const std::vector<uint32_t>& lost) const {
+            ClassSummary summary;
+            for (size_t f = 0; f < m_flows.size(); ++f) {
+                const FlowAcc& flow = m_flows[f];
+                if (flow.priority != c || flow.sent == 0 || (m_maxLostPackets > 0 && lost[f] >= m_maxLostPackets)) {
+                    continue;
+                }
+                double seconds = (flow.lastRx - flow.firstTx).GetSeconds();
+                summary.throughput.Add(seconds > 0 ? flow.rxBytes * 8.0 / seconds / 1000 : 0.0);
+                summary.delay.Add((flow.delaySumMs + m_lostPenaltyMs * lost[f]) / flow.sent);
+                summary.sent += flow.sent;
+                summary.lostSum += lost[f];
+                summary.jitterSum += flow.jitterMs;
+            }
+            return summary;
+        }
+
+        void ClientTx(Ptr<const Packet> packet) {
+            uint32_t nodeId = Simulator::GetContext();
+            if (nodeId >= m_nodeToFlow.size() || m_nodeToFlow[nodeId] == NO_FLOW) {
+                return;
+            }
+            size_t f = m_nodeToFlow[nodeId];
+            FlowAcc& flow = m_flows[f];
+            if (flow.sent++ == 0) {
+                flow.firstTx = Simulator::Now();
+            }
+            m_pending[packet->GetUid()] = {f, Simulator::Now()};
+            m_windowAcc[flow.priority].sent++;
+        }
+
+        void ReceiverRx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface) {
+            auto it = m_pending.find(packet->GetUid());
+            if (it == m_pending.end()) {
+                return;
+            }
+            FlowAcc& flow = m_flows[it->second.flow];
+            double transitMs = (Simulator::Now() - it->second.txTime).GetSeconds() * 1000.0;
+            m_pending.erase(it);
+
+            if (flow.received++ > 0) {
+                flow.jitterMs += (std::abs(transitMs - flow.lastTransitMs) - flow.jitterMs) / 16.0;
+            }
+            flow.lastTransitMs = transitMs;
+            flow.lastRx = Simulator::Now();
+            flow.rxBytes += packet->GetSize();
+            flow.delaySumMs += transitMs;
+
+            WindowAcc& window = m_windowAcc[flow.priority];
+            window.received++;
+            window.rxBytes += packet->GetSize();
+            window.delaySumMs += transitMs;
+
+            AcAcc& ac = m_classes[flow.priority];
+            ac.delay.Add(transitMs);
+            ac.p50.Add(transitMs);
+            ac.p95.Add(transitMs);
+            ac.p99.Add(transitMs);
+        }
+
+        // Pasa a perdidos los envíos pendientes con más de lossTimeout (acota m_pending)
+        void SweepLost() {
+            Time now = Simulator::Now();
+            for (auto it = m_pending.begin(); it != m_pending.end();) {
+                if (now - it->second.txTime > m_lossTimeout) {
+                    FlowAcc& flow = m_flows[it->second.flow];
+                    flow.lost++;
+                    m_windowAcc[flow.priority].lost++;
+                    it = m_pending.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        void CloseWindow() {
+            SweepLost();
+            Time now = Simulator::Now();
+            bool countsForConvergence = now >= m_warmup;
+            bool converged = m_tolerance > 0;
+
+            std::array<uint32_t, N_CLASSES> flowsPerClass{};
+            for (const FlowAcc& flow : m_flows) {
+                flowsPerClass[flow.priority]++;
+            }
+
+            for (uint32_t c = 0; c < N_CLASSES; ++c) {
+                WindowAcc& window = m_windowAcc[c];
+                if (flowsPerClass[c] == 0) {
+                    continue;
+                }
+                double sample[N_WINDOW_METRICS];
+                sample[W_THROUGHPUT] = window.rxBytes * 8.0 / m_window.GetSeconds() / 1000 / flowsPerClass[c];
+                sample[W_DELAY] = window.received > 0 ? window.delaySumMs / window.received : 0.0;
+                sample[W_LOSS] = window.sent > 0 ? 100.0 * window.lost / window.sent : 0.0;
+
+                bool classConverged = true;
+                for (uint32_t m = 0; m < N_WINDOW_METRICS; ++m) {
+                    Welford& stats = m_windowStats[c][m];
+                    if (countsForConvergence) {
+                        stats.Add(sample[m]);
+                    }
+                    double halfWidth = stats.HalfWidth95();
+                    if (stats.count < m_minWindows || halfWidth > m_tolerance * std::abs(stats.Mean())) {
+                        classConverged = false;
+                    }
+                }
+                converged = converged && classConverged;
+
+                if (m_windowOs) {
+                    *m_windowOs << m_rowPrefix << std::fixed << std::setprecision(5)
+                                << "," << now.GetSeconds() << "," << c
+                                << "," << sample[W_THROUGHPUT] << "," << sample[W_DELAY] << "," << sample[W_LOSS]
+                                << "," << window.sent << "," << window.received << "," << window.lost;
+                    for (uint32_t m = 0; m < N_WINDOW_METRICS; ++m) {
+                        *m_windowOs << "," << m_windowStats[c][m].HalfWidth95();
+                    }
+                    *m_windowOs << "," << classConverged << "\n";
+                }
+                window = WindowAcc();
+            }
+
+            if (converged) {
+                m_converged = true;
+                NS_LOG_INFO("[OnlineAcStats] Per-AC metrics converged at " << now.GetSeconds() << " s, stopping");
+                Simulator::Stop();
+                return;
+            }
+            m_windowEvent = Simulator::Schedule(m_window, &OnlineAcStats::CloseWindow, this);
+        }
+
+        Time m_lossTimeout;
+        double m_lostPenaltyMs;
+        double m_maxLostPackets;
+        std::vector<size_t> m_nodeToFlow;                       // nodeId -> índice de flujo
+        std::vector<FlowAcc> m_flows;
+        std::array<AcAcc, N_CLASSES> m_classes;
+        std::unordered_map<uint64_t, PendingTx> m_pending;      // UID -> envío aún sin recibir
+
+        Time m_window;
+        Time m_warmup;
+        EventId m_windowEvent;
+        std::ostream* m_windowOs = nullptr;
+        std::string m_rowPrefix;
+        std::array<WindowAcc, N_CLASSES> m_windowAcc{};
+        std::array<std::array<Welford, N_WINDOW_METRICS>, N_CLASSES> m_windowStats{};
+        double m_tolerance = 0.0;                               // 0 = sin parada anticipada
+        uint32_t m_minWindows = 5;
+        bool m_converged = false;
+};
+
+// *********************************************************************************
+// ******************************** EchoFlowProbe **********************************
+// *********************************************************************************
+// FlowRecord (contadores por flujo) está en scenario.h, compartido con no_sdwn.cc
+
+// Sonda ligera para los flujos de eco STA <-> AP, en lugar de FlowMonitorHelper::InstallAll
+// (que sondea todas las pilas y guarda histogramas por flujo que no se leen). Dos slots
+// preasignados por STA (subida y bajada), cada uno con un anillo fijo de paquetes en vuelo
+// emparejados por UID. Usa las mismas trazas (SendOutgoing/LocalDeliver), el mismo tamaño
+// (payload + cabecera IP), el mismo orden de FlowId y el mismo umbral de pérdida que
+// Ipv4FlowProbe/FlowMonitor. staAp[i] es el AP (celda) al que está asociada la STA i.
+class EchoFlowProbe {
+    public:
+        EchoFlowProbe(const std::vector<Ipv4Address>& staAp, const Ipv4InterfaceContainer& stas, Time lossTimeout)
+            : m_staAp(staAp), m_lossTimeout(lossTimeout) {
+            uint32_t minAddr = std::numeric_limits<uint32_t>::max();
+            uint32_t maxAddr = 0;
+            for (uint32_t i = 0; i < stas.GetN(); ++i) {
+                minAddr = std::min(minAddr, stas.GetAddress(i).Get());
+                maxAddr = std::max(maxAddr, stas.GetAddress(i).Get());
+            }
+            m_staBase = minAddr;
+            m_staIndex.assign(stas.GetN() > 0 ? maxAddr - minAddr + 1 : 0, NO_STA);
+            m_slots.resize(2 * stas.GetN());
+            for (uint32_t i = 0; i < stas.GetN(); ++i) {
+                Ipv4Address sta = stas.GetAddress(i);
+                m_staIndex[sta.Get() - m_staBase] = i;
+                m_slots[i].record.source = sta;                         // Subida: STA -> AP
+                m_slots[i].record.destination = staAp[i];
+                m_slots[stas.GetN() + i].record.source = staAp[i];      // Bajada: AP -> STA
+                m_slots[stas.GetN() + i].record.destination = sta;
+            }
+        }
+
+        void Install(NodeContainer nodes) {
+            for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+                Ptr<Ipv4> ipv4 = nodes.Get(i)->GetObject<Ipv4>();
+                ipv4->TraceConnectWithoutContext("SendOutgoing", MakeCallback(&EchoFlowProbe::SendOutgoing, this));
+                ipv4->TraceConnectWithoutContext("LocalDeliver", MakeCallback(&EchoFlowProbe::LocalDeliver, this));
+            }
+        }
+
+        // Flujos vistos, en orden de FlowId; los paquetes en vuelo con más de lossTimeout
+        // cuentan como perdidos
+        std::vector<FlowRecord> GetFlowRecords() const {
+            Time now = Simulator::Now();
+            std::vector<FlowRecord> records;
+            for (const Slot& slot : m_slots) {
+                if (slot.record.flowId == 0) {
+                    continue;
+                }
+                FlowRecord record = slot.record;
+                for (uint32_t k = 0; k < slot.count; ++k) {
+                    const InFlight& packet = slot.ring[(slot.head + k) % RING_SIZE];
+                    if (packet.uid != NO_UID && now - packet.txTime > m_lossTimeout) {
+                        record.lostPackets++;
+                    }
+                }
+                records.push_back(record);
+            }
+            std::sort(records.begin(), records.end(),
+                      [](const FlowRecord& a, const FlowRecord& b) { return a.flowId < b.flowId; });
+            return records;
+        }
+
+        size_t GetStateBytes() const {
+            return sizeof(*this) + m_slots.capacity() * sizeof(Slot) + m_staIndex.capacity() * sizeof(uint32_t)
+                   + m_staAp.capacity() * sizeof(Ipv4Address);
+        }
+
+        // Descarta lo medido hasta ahora conservando los FlowId (fork tras el calentamiento);
+        // los paquetes en vuelo ya no se emparejan
+        void Reset() {
+            for (Slot& slot : m_slots) {
+                FlowRecord& record = slot.record;
+                record = FlowRecord{record.flowId, record.source, record.destination, record.protocol};
+                slot.ring.fill(InFlight());
+                slot.head = 0;
+                slot.count = 0;
+            }
+        }
+
+    private:
+        static constexpr uint32_t RING_SIZE = 32;       // Paquetes en vuelo por flujo (1 pkt/s por STA)
+        static constexpr uint32_t NO_STA = std::numeric_limits<uint32_t>::max();
+        static constexpr uint64_t NO_UID = std::numeric_limits<uint64_t>::max();
+
+        struct InFlight {
+            uint64_t uid = NO_UID;
+            Time txTime;
+        };
+
+        struct Slot {
+            FlowRecord record;
+            std::array<InFlight, RING_SIZE> ring;
+            uint32_t head = 0;
+            uint32_t count = 0;
+        };
+
+        Slot* FindSlot(const Ipv4Header& header) {
+            if (header.GetProtocol() != UdpL4Protocol::PROT_NUMBER) {
+                return nullptr;
+            }
+            const uint32_t nStas = m_slots.size() / 2;
+            uint32_t sta = StaIndex(header.GetSource());
+            if (sta != NO_STA) {
+                return header.GetDestination() == m_staAp[sta] ? &m_slots[sta] : nullptr;
+            }
+            sta = StaIndex(header.GetDestination());
+            if (sta != NO_STA && header.GetSource() == m_staAp[sta]) {
+                return &m_slots[nStas + sta];
+            }
+            return nullptr;
+        }
+
+        uint32_t StaIndex(Ipv4Address address) const {
+            uint32_t offset = address.Get() - m_staBase;
+            return offset < m_staIndex.size() ? m_staIndex[offset] : NO_STA;
+        }
+
+        // Retira de la cabeza del anillo los huecos ya emparejados y los envíos vencidos
+        void Expire(Slot& slot, Time now) {
+            while (slot.count > 0) {
+                InFlight& oldest = slot.ring[slot.head];
+                if (oldest.uid != NO_UID && now - oldest.txTime <= m_lossTimeout) {
+                    break;
+                }
+                if (oldest.uid != NO_UID) {
+                    slot.record.lostPackets++;
+                }
+                oldest.uid = NO_UID;
+                slot.head = (slot.head + 1) % RING_SIZE;
+                slot.count--;
+            }
+        }
+
+        void SendOutgoing(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t interface) {
+            Slot* slot = FindSlot(header);
+            if (!slot) {
+                return;
+            }
+            Time now = Simulator::Now();
+            FlowRecord& record = slot->record;
+            if (record.flowId == 0) {
+                record.flowId = ++m_lastFlowId;
+                record.protocol = header.GetProtocol();
+            }
+            if (record.txPackets == 0) {
+                record.timeFirstTxPacket = now;
+            }
+            record.txPackets++;
+            record.txBytes += packet->GetSize() + header.GetSerializedSize();
+
+            Expire(*slot, now);
+            if (slot->count == RING_SIZE) {
+                // Anillo lleno: el más antiguo (aún en vuelo tras Expire) se da por perdido
+                slot->record.lostPackets++;
+                slot->ring[slot->head].uid = NO_UID;
+                Expire(*slot, now);
+            }
+            slot->ring[(slot->head + slot->count) % RING_SIZE] = {packet->GetUid(), now};
+            slot->count++;
+        }
+
+        void LocalDeliver(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t interface) {
+            Slot* slot = FindSlot(header);
+            if (!slot) {
+                return;
+            }
+            for (uint32_t k = 0; k < slot->count; ++k) {
+                InFlight& inFlight = slot->ring[(slot->head + k) % RING_SIZE];
+                if (inFlight.uid != packet->GetUid()) {
+                    continue;
+                }
+                Time now = Simulator::Now();
+                FlowRecord& record = slot->record;
+                record.rxPackets++;
+                record.rxBytes += packet->GetSize() + header.GetSerializedSize();
+                record.delaySum += now - inFlight.txTime;
+                record.timeLastRxPacket = now;
+                inFlight.uid = NO_UID;
+                Expire(*slot, now);
+                return;
+            }
+        }
+
+        std::vector<Ipv4Address> m_staAp;       // Índice de STA -> AP de su celda
+        Time m_lossTimeout;
+        uint32_t m_staBase = 0;
+        std::vector<uint32_t> m_staIndex;       // (dirección - m_staBase) -> índice de STA
+        std::vector<Slot> m_slots;              // [0, n): subida, [n, 2n): bajada
+        uint32_t m_lastFlowId = 0;
+};
+
+// *********************************************************************************
+// ************************** CachedPropagationLossModel ***************************
+// *********************************************************************************
+// Sustituye la cadena LogDistance -> Nakagami de model_realist en el YansWifiChannel. La pérdida
+// determinista se guarda por par de nodos con ConstantPositionMobilityModel y se invalida solo
+// para el nodo que cambia de posición (CourseChange); los nodos móviles se calculan siempre.
+// Con la pérdida determinista por debajo del umbral de detección menos un margen no se muestrea
+// el desvanecimiento: YansWifiChannel::Receive descarta esa señal igual que antes. El resto de
+// pares usa el mismo NakagamiPropagationLossModel, así que la distribución no cambia.
+class CachedPropagationLossModel : public PropagationLossModel {
+    public:
+        CachedPropagationLossModel(Ptr<PropagationLossModel> pathLoss, Ptr<PropagationLossModel> fading,
+                                   double detectionFloorDbm, double fadingMarginDb)
+            : m_pathLoss(pathLoss), m_fading(fading), m_cullBelowDbm(detectionFloorDbm - fadingMarginDb) {}
+
+        uint64_t Hits() const { return m_hits; }
+        uint64_t Misses() const { return m_misses; }
+        uint64_t Culled() const { return m_culled; }
+
+    private:
+        struct Node {
+            bool fixed;
+            uint32_t version = 0;       // Sube con cada CourseChange del nodo
+        };
+        struct Entry {
+            double lossDb;
+            uint32_t versionA;
+            uint32_t versionB;
+        };
+
+        double DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const override {
+            double lossDb;
+            const uint32_t ia = Index(a);
+            const uint32_t ib = Index(b);
+            if (m_nodes[ia].fixed && m_nodes[ib].fixed) {
+                // Pérdida simétrica: una entrada por par sin orden
+                const uint64_t key = ia < ib ? (uint64_t(ia) << 32 | ib) : (uint64_t(ib) << 32 | ia);
+                const uint32_t va = m_nodes[std::min(ia, ib)].version;
+                const uint32_t vb = m_nodes[std::max(ia, ib)].version;
+                auto it = m_cache.find(key);
+                if (it != m_cache.end() && it->second.versionA == va && it->second.versionB == vb) {
+                    m_hits++;
+                    lossDb = it->second.lossDb;
+                } else {
+                    m_misses++;
+                    lossDb = txPowerDbm - m_pathLoss->CalcRxPower(txPowerDbm, a, b);
+                    m_cache[key] = {lossDb, va, vb};
+                }
+            } else {
+                lossDb = txPowerDbm - m_pathLoss->CalcRxPower(txPowerDbm, a, b);
+            }
+
+            const double rxPowerDbm = txPowerDbm - lossDb;
+            if (rxPowerDbm < m_cullBelowDbm) {
+                m_culled++;
+                return rxPowerDbm;
+            }
+            return m_fading->CalcRxPower(rxPowerDbm, a, b);
+        }
+
+        // Mismos streams que la cadena original (LogDistance no usa ninguno)
+        int64_t DoAssignStreams(int64_t stream) override {
+            const int64_t used = m_pathLoss->AssignStreams(stream);
+            return used + m_fading->AssignStreams(stream + used);
+        }
+
+        uint32_t Index(Ptr<MobilityModel> model) const {
+            auto [it, inserted] = m_index.emplace(PeekPointer(model), static_cast<uint32_t>(m_nodes.size()));
+            if (inserted) {
+                const bool fixed(DynamicCast<ConstantPositionMobilityModel>(model));
+                m_nodes.push_back({fixed});
+                if (fixed) {
+                    model->TraceConnectWithoutContext(
+                        "CourseChange", MakeCallback(&CachedPropagationLossModel::NodeMoved, this).Bind(it->second));
+                }
+            }
+            return it->second;
+        }
+
+        void NodeMoved(uint32_t index, Ptr<const MobilityModel>) const {
+            m_nodes[index].version++;
+        }
+
+        Ptr<PropagationLossModel> m_pathLoss;       // LogDistance (determinista)
+        Ptr<PropagationLossModel> m_fading;         // Nakagami (se muestrea en cada trama)
+        double m_cullBelowDbm;
+        mutable std::unordered_map<const MobilityModel*, uint32_t> m_index;
+        mutable std::vector<Node> m_nodes;
+        mutable std::unordered_map<uint64_t, Entry> m_cache;
+        mutable uint64_t m_hits = 0;
+        mutable uint64_t m_misses = 0;
+        mutable uint64_t m_culled = 0;
+};
+
+// *********************************************************************************
+// ******************************* Global Variables ********************************
+// *********************************************************************************
+uint32_t nStaWifi = 10;             // Number of WiFi STAs
+uint32_t PacketSize = 512;          // Packet size in bytes
+double radio = 50.0;                // Coverage radius in meters
+uint16_t port = 8080;               // Port for UDP communication
+double TimeSimulationMin = 10.0;    // Simulation time in minutes
+uint32_t nCorrida = 1;              // Run number
+bool enablePcap = false;            // Enable PCAP capture
+bool enableAnimation = false;       // Enable animation output
+bool enableXml = false;             // Enable XML flow monitor output
+double delayBetweenStartsMs = 25.0; // Delay between STA starts in ms
+std::string category = "SDWN_EDCA"; // Category for file organization
+uint32_t RngSeed = 0;               // Random seed for simulation
+std::string mobilityType = "mixer"; // "yes", "no", o "mixer"
+bool model_realist = true;          // Modelado realista
+std::string scenarioFile = "";      // Escenario declarativo (scenario.h); la línea de comandos lo sobreescribe
+std::string apMode = "pofi";        // "pofi" (PoFiAp + KDNController) o "plain" (DCF sin QoS y eco UDP, como no_sdwn.cc)
+
+uint32_t nStaH = 3;                 // Number of High priority STAs (VO)
+uint32_t nStaM = 3;                 // Number of Medium priority STAs (VI)
+uint32_t nStaL = 2;                 // Number of Low priority STAs (BE)
+uint32_t nStaNRT = 2;               // Number of Non Real Time STAs (BK)
+
+uint8_t		FrameRetryLimit	= 7;                // WiFi Frame Retry Limit
+bool 		RentryPackets 	= false;            // Enable packet retry
+std::string	FragmentationThreshold = "2200";    // WiFi fragmentation threshold
+
+std::string apDrainMode     = "device";     // PoFiAp drain: "device" (cola MAC) o "rate" (tasa fija)
+uint32_t    apTxQueueLimit  = 8;            // MPDUs por AC en la cola MAC antes de esperar
+std::string apServiceRate   = "54Mbps";     // Tasa de servicio en modo "rate"
+double      apPollIntervalMs = 1.0;         // Watchdog (ms) mientras la cola MAC está llena
+bool        apRxCopyHeader  = false;        // Clasificar con Copy()+RemoveHeader() (ruta anterior, para comparar)
+bool        apStatsCsv      = false;        // CSV por clase del PoFiAp junto al CSV por flujo de la corrida
+std::string apScheduler     = "strict";     // Disciplina entre clases: "strict", "drr" o "wfq"
+std::string apSchedWeights  = "8,4,2,1";    // Pesos H,M,L,NRT (quantum = peso * apDrrQuantumBytes en DRR)
+uint32_t    apDrrQuantumBytes = 1500;       // Bytes por unidad de peso y vuelta en DRR
+std::array<double, PoFiAp::N_EDCA_SLOTS> schedWeights{{8, 4, 2, 1}};   // Derivado de apSchedWeights
+std::string apAqm           = "taildrop";   // Gestión de colas por clase: "taildrop", "red" o "codel"
+std::string apQueueCapacity = "0,0,0,0";    // Paquetes por clase H,M,L,NRT (0 = sin límite)
+double      apCodelTargetMs = 5.0;          // CoDel: permanencia objetivo
+double      apCodelIntervalMs = 100.0;      // CoDel: ventana de observación
+std::array<uint32_t, PoFiAp::N_EDCA_SLOTS> queueCapacity{{0, 0, 0, 0}};   // Derivado de apQueueCapacity
+
+double      controlLatencyMs = 0.0;         // Latencia de un sentido AP <-> KDNController (0 = PacketIn síncrono)
+double      controllerServiceUs = 0.0;      // Procesamiento por PacketIn en el controlador (cola FIFO)
+std::string pendingAction   = "buffer";     // Paquetes con FlowMod pendiente: "buffer" o "default" (LOW)
+uint32_t    pendingBufferLimit = 64;        // Paquetes retenidos por ToS en modo "buffer"
+double      controlPeriodS  = 0.0;          // Informes PoFiAp -> KDNController y retuning EDCA (0 = EDCA estático)
+std::string edcaTargetsMs   = "10,50,150,0";    // Retardo objetivo en el AP por clase H,M,L,NRT (0 = sin objetivo)
+std::array<double, PoFiAp::N_EDCA_SLOTS> edcaTargets{{10, 50, 150, 0}};   // Derivado de edcaTargetsMs
+uint32_t    nAps            = 1;            // APs (celdas BSS), cada uno con su PoFiAp y todos con el mismo KDNController
+std::string apLayout        = "grid";       // Disposición de los APs: "grid" o "hex"
+double      apSpacing       = 60.0;         // Distancia entre APs vecinos (m)
+std::string apChannels      = "36";         // Canales de 5 GHz repartidos por turnos entre celdas (uno = todo co-canal)
+std::vector<uint32_t> cellChannels{36};     // Derivado de apChannels
+std::string staAssociation  = "position";   // "position" (AP más cercano) o "ssid" (STA i -> celda i % nAps, colocada en ella)
+std::string cellOutput      = "";           // CSV por celda (por defecto Results_Finals/Cell_Metrics.csv)
+bool        mpi             = false;        // Ejecución distribuida (mpirun): KDNController en el rank 0, celdas en el resto
+uint32_t    mpiRank         = 0;            // Derivado de MpiInterface con mpi
+uint32_t    mpiSize         = 1;
+std::string surrogateModel  = "";           // RF exportado (.sdwnrf): el controlador elige los CW de cada corrida
+std::shared_ptr<const TreeEnsemble> surrogate;  // Cargado una vez desde surrogateModel
+
+std::string logLevel = "all";               // "off" (producción), "sampled" (1 de cada logEvery) o "all"
+uint32_t logEvery = 100;                    // Muestreo de logs por paquete en modo "sampled"
+uint32_t packetLogEvery = 1;                // Derivado de logLevel/logEvery (usado por SdwnLogPacket)
+
+std::string manifest = "";                  // CSV de escenarios a ejecutar en este mismo proceso
+std::string batchOutput = "";               // CSV único donde se acumulan los flujos de todas las corridas
+
+std::string resultsFormat = "binary";       // "binary" (columnar .sdwncol), "csv" o "both"
+std::string columnarOutput = "";            // Archivo .sdwncol (por defecto Results_Finals/Results.sdwncol)
+
+bool onlineStats = true;                    // Estimación por corrida de los objetivos del RF, calculada durante la simulación
+double onlineStatsIntervalS = 0.0;          // Emitir también cada N segundos (0 = solo al final)
+std::string onlineStatsOutput = "";         // CSV de objetivos (por defecto Results_Finals/Online_Targets.csv)
+double onlineLostPenaltyMs = 10.0;          // ms sumados al delay por paquete perdido (IA/02_Stadistics.py)
+double onlineMaxLostPackets = 0.99 * 180;   // Flujos con tantos perdidos o más fuera (IA/02_Stadistics.py; 0 = ninguno)
+double metricsWindowS = 0.0;                // Métricas por AC cada N segundos simulados (0 = desactivado)
+std::string windowOutput = "";              // CSV de ventanas (por defecto Results_Finals/Windowed_Metrics.csv)
+double convergenceTol = 0.0;                // Parar cuando IC95/media < tol en todas las AC (0 = duración fija)
+uint32_t convergenceMinWindows = 5;         // Ventanas mínimas tras el arranque de todas las STAs
+
+std::string flowProbe = "flowmonitor";      // "flowmonitor" (InstallAll) o "light" (EchoFlowProbe, aún sin medir frente a FlowMonitor)
+bool lossCache = true;                      // model_realist: CachedPropagationLossModel en lugar de la cadena del helper
+
+bool        simSearch       = false;        // Driver: busca los CW simulando cada candidato (successive halving)
+uint32_t    simSearchCandidates = 27;       // Candidatos del primer escalón (los CW de la línea de comandos y del modelo incluidos)
+uint32_t    simSearchSeeds  = 3;            // Semillas (nCorrida consecutivas) por candidato
+uint32_t    simSearchWorkers = 0;           // Procesos simulando a la vez (0 = núcleos disponibles)
+uint32_t    simSearchMaxResident = 0;       // Trabajadores vivos (cada uno con su red en memoria; 0 = simSearchWorkers)
+double      simSearchMinS   = 30.0;         // Tiempo simulado del primer escalón; se multiplica por simSearchEta
+uint32_t    simSearchEta    = 3;            // En cada escalón sigue 1 de cada simSearchEta candidatos
+std::string simSearchOutput = "";           // CSV por escalón (por defecto Results_Finals/Sim_CW_Search.csv)
+int searchRequestFd = -1;                   // Trabajador de simSearch: tramos pedidos por el driver
+int searchReplyFd = -1;                     // Trabajador de simSearch: objetivos por AC al final de cada tramo
+
+double      warmupForkS     = 0.0;          // Fork tras N s simulados: un hijo por configuración de CW (0 = desactivado)
+std::string forkConfigs     = "";           // CSV de CW (columnas CwMinH..CwMaxNRT) que aplica cada hijo
+uint32_t    forkWorkers     = 0;            // Hijos simulando a la vez (0 = núcleos disponibles)
+struct WarmForkConfig {
+    std::array<uint32_t, 8> cw;             // CwMinH, CwMaxH, ..., CwMinNRT, CwMaxNRT
+    int requestFd = -1;                     // Con simSearch: tuberías del trabajador que sale del fork
+    int replyFd = -1;
+};
+std::vector<WarmForkConfig> warmForkConfigs;    // Derivado de forkConfigs (o de los candidatos de simSearch)
+bool warmForkChild = false;                 // Hijo de un fork tras el calentamiento
+
+std::string microbench = "";                // Microbenchmark a ejecutar en lugar de la simulación ("tables", "rxpeek", "queues")
+
+        
 
 std::string AC;                                                     // Access Category
 std::vector<uint32_t> IntervalValues= {1,  1,  1,  1 };             // Interval between packets in seconds per AC
 std::vector<std::string> AcValues   = {"BK", "BE", "VI", "VO"};     // Access Categories
 std::vector<uint32_t> TosValues     = {0x20, 0x60, 0xa0, 0xe0};     // ToS values per AC
+std::vector<uint32_t> AifsnValues   = {7, 3, 2, 2};                 // AIFSN per AC
+std::vector<uint32_t> AmpduValues   = {65535, 32768, 16384, 8192};  // MaxAmpduSize per AC in bytes
 std::map<std::string, uint32_t> ACIndex = {{"BK", 0}, {"BE", 1}, {"VI", 2}, {"VO", 3}};     // AC to index mapping
 
 // Variables globales para saber qué valores se están usando en la corrida
@@ -495,16 +2605,80 @@ struct EdcaConfig {                 // Estructura para configuración EDCA
 };
 
 
+// Salida binaria columnar (.sdwncol): archivo de solo-anexado formado por bloques,
+// uno por corrida (little-endian):
+//   ColumnarRunHeader (144 bytes, incluye escenario y "Resumen General")
+//   f64 throughputKbps[n], f64 delayMs[n],
+//   u32 flowId[n], u32 source[n], u32 destination[n], u32 lost[n], u32 sent[n], u32 received[n]
+//   relleno hasta múltiplo de 8 bytes; blockBytes en la cabecera da el salto al siguiente bloque.
+// Cada bloque se escribe con un único write() en O_APPEND, así que varios procesos pueden
+// anexar al mismo archivo. IA/01_Concatenate_Results.py lo lee con un único memmap.
+struct ColumnarRunHeader {
+    char magic[4] = {'S', 'D', 'W', 'C'};
+    uint32_t version = 1;
+    uint32_t blockBytes = 0;
+    uint32_t nFlows = 0;
+    uint32_t run = 0;
+    uint32_t seed = 0;
+    uint32_t packetSize = 0;
+    uint32_t nStaWifi = 0;
+    uint32_t nSta[4] = {};                  // H, M, L, NRT
+    uint32_t cw[8] = {};                    // CwMinH, CwMaxH, CwMinM, CwMaxM, CwMinL, CwMaxL, CwMinNRT, CwMaxNRT
+    uint32_t mobility = 0;                  // 0 = no, 1 = yes, 2 = mixer
+    uint32_t maxFlowId = 0;
+    uint32_t totalSent = 0;
+    uint32_t totalReceived = 0;
+    uint32_t totalLost = 0;
+    uint32_t reserved = 0;
+    double totalThroughputKbps = 0.0;
+    double averageDelayMs = 0.0;
+    double stddevDelayMs = 0.0;
+    double lossRatePct = 0.0;
+    double maxThroughputKbps = 0.0;
+};
+static_assert(sizeof(ColumnarRunHeader) == 144, "El esquema .sdwncol v1 fija la cabecera en 144 bytes");
+
+struct ColumnarFlowColumns {
+    std::vector<double> throughputKbps;
+    std::vector<double> delayMs;
+    std::vector<uint32_t> flowId;
+    std::vector<uint32_t> source;
+    std::vector<uint32_t> destination;
+    std::vector<uint32_t> lostPackets;
+    std::vector<uint32_t> sentPackets;
+    std::vector<uint32_t> receivedPackets;
+};
+
+
 // *********************************************************************************
 // *********************************** Functions ***********************************
 // *********************************************************************************
-void AnalyzeFlowMonitorResults(Ptr<FlowMonitor>, Ptr<Ipv4FlowClassifier>, 
+void AnalyzeFlowMonitorResults(const std::vector<FlowRecord>&,
                             uint32_t , std::string , std::string , 
                             uint8_t, uint32_t , uint32_t, uint32_t , 
                             uint32_t , uint32_t , uint32_t , uint32_t , uint32_t, uint32_t, uint32_t, uint32_t,uint32_t);
-void Sta_Information(uint32_t index, uint32_t tosValue,std::string ac,  Ipv4InterfaceContainer StaInterfaces, NetDeviceContainer wifiStaDevices);
-void SetupMobility(NodeContainer& wifiStaNodes, double radio, uint32_t RngSeed, 
-                   const std::string& mobilityType);
+std::vector<Vector> ApPositions(uint32_t n, const std::string& layout, double spacing);
+void WriteCellMetrics(const std::vector<FlowRecord>& records, const Ipv4InterfaceContainer& staInterfaces,
+                      const std::vector<uint32_t>& staIds, const std::vector<uint32_t>& staCell,
+                      const ApplicationContainer& pofiApps, const std::vector<Vector>& apPositions,
+                      const KDNController& controller, const std::string& path);
+#ifdef NS3_MPI
+std::vector<FlowRecord> GatherFlowRecords(const std::vector<FlowRecord>& local);
+std::string GatherText(const std::string& local);
+#endif
+int RunMicrobench(const std::string& name);
+bool AppendColumnarBlock(const std::string& path, const ColumnarRunHeader& header, const ColumnarFlowColumns& flows);
+std::string ScenarioFeaturesHeader();
+std::string ScenarioFeatures();
+void EmitOnlineTargets(const OnlineAcStats* stats, const std::string& path);
+bool ParseClassValues(const std::string& text, std::array<double, PoFiAp::N_EDCA_SLOTS>& values, bool allowZero);
+ScenarioSpec ScenarioFromGlobals();
+void ApplyScenario(const ScenarioSpec& spec);
+int RunScenario();
+int RunManifest(const std::string& manifestPath);
+int RunSimSearch();
+bool LoadForkConfigs(const std::string& path);
+void RunSearchSegments(const OnlineAcStats* stats);
 // *********************************************************************************
 // ************************************* Main **************************************
 // *********************************************************************************
@@ -523,6 +2697,8 @@ int main(int argc, char* argv[]) {
     cmd.AddValue("RngSeed", "Random seed for simulation", RngSeed);
     cmd.AddValue("category", "Category for file organization", category);
     cmd.AddValue("mobilityType", "Mobility type: yes, no, or mixer", mobilityType);
+    cmd.AddValue("scenario", "Scenario file (STA classes, traffic, EDCA, mobility, AP mode); command-line values override it", scenarioFile);
+    cmd.AddValue("apMode", "AP application: pofi (PoFiAp + KDNController) or plain (no QoS, UDP echo server as in no_sdwn)", apMode);
 
     // nStas por prioridad (si cualquiera >0 -> usamos distribución ordenada y NO iteramos devices)
     cmd.AddValue("nStaH", "Number of High priority STAs (VO)", nStaH);
@@ -549,30 +2725,345 @@ int main(int argc, char* argv[]) {
     cmd.AddValue("RentryPackets", "Enable packet retry", RentryPackets);
     cmd.AddValue("FragmentationThreshold", "WiFi fragmentation threshold", FragmentationThreshold);
 
+    // planificador del PoFiAp
+    cmd.AddValue("apDrainMode", "PoFiAp drain mode: device or rate", apDrainMode);
+    cmd.AddValue("apTxQueueLimit", "MPDUs allowed per AC in the AP MAC queue (device mode)", apTxQueueLimit);
+    cmd.AddValue("apServiceRate", "PoFiAp service rate (rate mode)", apServiceRate);
+    cmd.AddValue("apPollIntervalMs", "PoFiAp watchdog interval in ms while the MAC queue is full", apPollIntervalMs);
+    cmd.AddValue("apRxCopyHeader", "Classify with Copy()+RemoveHeader() instead of PeekHeader()", apRxCopyHeader);
+    cmd.AddValue("apStatsCsv", "Append the PoFiAp per-priority counters to a CSV next to the per-flow CSV", apStatsCsv);
+    cmd.AddValue("apScheduler", "PoFiAp inter-class scheduling: strict, drr (deficit round robin) or wfq (weighted fair queuing)", apScheduler);
+    cmd.AddValue("apSchedWeights", "Per-class weights H,M,L,NRT for drr/wfq", apSchedWeights);
+    cmd.AddValue("apDrrQuantumBytes", "DRR quantum per unit of weight, in bytes", apDrrQuantumBytes);
+    cmd.AddValue("apAqm", "PoFiAp per-class queue management: taildrop, red or codel", apAqm);
+    cmd.AddValue("apQueueCapacity", "PoFiAp per-class queue capacity in packets H,M,L,NRT (0 = unbounded)", apQueueCapacity);
+    cmd.AddValue("apCodelTargetMs", "CoDel target sojourn time in ms", apCodelTargetMs);
+    cmd.AddValue("apCodelIntervalMs", "CoDel interval in ms", apCodelIntervalMs);
+
+    // plano de control
+    cmd.AddValue("controlLatencyMs", "One-way AP <-> KDNController control channel latency in ms (0 = synchronous PacketIn)", controlLatencyMs);
+    cmd.AddValue("controllerServiceUs", "KDNController processing time per PacketIn in us (FIFO, models PacketIn storms)", controllerServiceUs);
+    cmd.AddValue("pendingAction", "Packets arriving while a FlowMod is pending: buffer or default (forward as LOW)", pendingAction);
+    cmd.AddValue("pendingBufferLimit", "Packets buffered per ToS while its FlowMod is pending", pendingBufferLimit);
+    cmd.AddValue("controlPeriodS", "Period in s of the PoFiAp per-class reports that drive runtime EDCA retuning (0 = static EDCA)", controlPeriodS);
+    cmd.AddValue("nAps", "Number of APs (BSS cells), each running PoFiAp, all sharing one KDNController", nAps);
+    cmd.AddValue("apLayout", "AP placement: grid or hex", apLayout);
+    cmd.AddValue("apSpacing", "Distance between neighbouring APs in m", apSpacing);
+    cmd.AddValue("apChannels", "5 GHz channels assigned round-robin to the cells (a single channel = co-channel)", apChannels);
+    cmd.AddValue("staAssociation", "STA to cell mapping: position (nearest AP) or ssid (STA i joins cell i % nAps and is placed in it)", staAssociation);
+    cmd.AddValue("mpi", "Distributed run under mpirun: KDNController on rank 0, cells spread over the other ranks (needs ns-3 built with --enable-mpi)", mpi);
+    cmd.AddValue("cellOutput", "Per-cell metrics CSV when nAps > 1 (default scratch/Estadisticas/<category>/Results_Finals/Cell_Metrics.csv)", cellOutput);
+    cmd.AddValue("surrogateModel", "Exported Random Forest (.sdwnrf, IA/04_Export_Model.py): KDNController picks the CWs from the STA mix", surrogateModel);
+    cmd.AddValue("edcaTargetsMs", "Per-class AP delay targets H,M,L,NRT in ms for EDCA retuning (0 = no target)", edcaTargetsMs);
+
     // Parámetros de salida/debugging
     cmd.AddValue("enablePcap", "Enable PCAP capture", enablePcap);
     cmd.AddValue("enableAnimation", "Enable animation output", enableAnimation);
     cmd.AddValue("enableXml", "Enable XML flow monitor output", enableXml);
+    cmd.AddValue("logLevel", "Logging: off (production), sampled (every logEvery-th packet) or all", logLevel);
+    cmd.AddValue("logEvery", "Per-packet log sampling period in sampled mode", logEvery);
+    cmd.AddValue("manifest", "CSV of scenarios (nStaH..nStaNRT, CwMin*/CwMax*, PacketSize, RngSeed, nCorrida) run in this process", manifest);
+    cmd.AddValue("batchOutput", "Append per-flow results of every run to this single CSV", batchOutput);
+    cmd.AddValue("resultsFormat", "Results sink: binary (columnar .sdwncol), csv or both", resultsFormat);
+    cmd.AddValue("columnarOutput", "Columnar results file (default scratch/Estadisticas/<category>/Results_Finals/Results.sdwncol)", columnarOutput);
+    cmd.AddValue("onlineStats", "Estimate the per-AC Random Forest targets of this run during the simulation", onlineStats);
+    cmd.AddValue("onlineStatsIntervalS", "Also emit the online targets every N seconds (0 = only at the end)", onlineStatsIntervalS);
+    cmd.AddValue("onlineStatsOutput", "Online targets CSV (default scratch/Estadisticas/<category>/Results_Finals/Online_Targets.csv)", onlineStatsOutput);
+    cmd.AddValue("onlineLostPenaltyMs", "Delay penalty per lost packet in the online targets, in ms (IA/02_Stadistics.py uses 10)", onlineLostPenaltyMs);
+    cmd.AddValue("onlineMaxLostPackets", "Exclude flows with at least this many lost packets from the online targets (IA/02_Stadistics.py uses 0.99*180; 0 = keep all)", onlineMaxLostPackets);
+    cmd.AddValue("metricsWindowS", "Publish per-AC windowed throughput/delay/loss every N simulated seconds (0 = off)", metricsWindowS);
+    cmd.AddValue("windowOutput", "Windowed metrics CSV (default scratch/Estadisticas/<category>/Results_Finals/Windowed_Metrics.csv)", windowOutput);
+    cmd.AddValue("convergenceTol", "Stop once the 95% CI half-width of every windowed metric is below this fraction of its mean (0 = off)", convergenceTol);
+    cmd.AddValue("convergenceMinWindows", "Minimum windows after all STAs started before early stopping", convergenceMinWindows);
+    cmd.AddValue("flowProbe", "Per-flow statistics: flowmonitor (FlowMonitor::InstallAll) or light (STA<->AP echo probe)", flowProbe);
+    cmd.AddValue("lossCache", "With model_realist, cache the log-distance loss of static node pairs and skip fading below the detection floor", lossCache);
+    cmd.AddValue("simSearch", "Search CwMin/CwMax by simulating candidates across seeds in worker processes, with successive halving on simulated time", simSearch);
+    cmd.AddValue("simSearchCandidates", "Candidates in the first simSearch rung (command-line and surrogate CWs included)", simSearchCandidates);
+    cmd.AddValue("simSearchSeeds", "Seeds (consecutive nCorrida) simulated per simSearch candidate", simSearchSeeds);
+    cmd.AddValue("simSearchWorkers", "simSearch worker processes simulating at once (0 = available cores)", simSearchWorkers);
+    cmd.AddValue("simSearchMaxResident", "simSearch worker processes kept alive, each holding a full simulation in memory (0 = simSearchWorkers)", simSearchMaxResident);
+    cmd.AddValue("simSearchMinS", "Simulated seconds of the first simSearch rung (multiplied by simSearchEta per rung)", simSearchMinS);
+    cmd.AddValue("simSearchEta", "simSearch keeps 1 of every simSearchEta candidates per rung", simSearchEta);
+    cmd.AddValue("simSearchOutput", "simSearch per-rung CSV (default scratch/Estadisticas/<category>/Results_Finals/Sim_CW_Search.csv)", simSearchOutput);
+    cmd.AddValue("warmupForkS", "Simulate the shared prefix up to N s once, then fork one child per CW configuration (forkConfigs or simSearch candidates) for the measurement window (0 = off)", warmupForkS);
+    cmd.AddValue("forkConfigs", "CSV of CW configurations (CwMinH..CwMaxNRT columns) applied by each warmupForkS child", forkConfigs);
+    cmd.AddValue("forkWorkers", "warmupForkS children simulating at once (0 = available cores)", forkWorkers);
+    cmd.AddValue("microbench", "Run a PoFiAp microbenchmark instead of the simulation (tables, rxpeek, queues)", microbench);
 
 
     cmd.Parse(argc, argv);
 
+    // Escenario declarativo: el archivo es la base y se vuelve a aplicar la línea de comandos encima
+    if (!scenarioFile.empty()) {
+        ScenarioSpec spec = ScenarioFromGlobals();
+        std::string error;
+        if (!LoadScenarioFile(scenarioFile, spec, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        ApplyScenario(spec);
+        cmd.Parse(argc, argv);
+    }
+
+    if (!microbench.empty()) {
+        return RunMicrobench(microbench);
+    }
+
     // ========== VALIDAR PARÁMETRO DE MOVILIDAD ==========
     if (mobilityType != "yes" && mobilityType != "no" && mobilityType != "mixer") {
         std::cerr << "Error: mobilityType debe ser 'yes', 'no' o 'mixer'\n";
         return 1;
     }
-
-    // ========== CONFIGURACIÓN DE SEMILLA ==========
-    Time::SetResolution(Time::NS);
-    
-    if (RngSeed == 0) {
+    if (logLevel != "off" && logLevel != "sampled" && logLevel != "all") {
+        std::cerr << "Error: logLevel debe ser 'off', 'sampled' o 'all'\n";
+        return 1;
+    }
+    if (apMode != "pofi" && apMode != "plain") {
+        std::cerr << "Error: apMode debe ser 'pofi' o 'plain'\n";
+        return 1;
+    }
+    if (apMode == "plain" && (controlPeriodS > 0 || !surrogateModel.empty() || simSearch || warmupForkS > 0
+                              || mpi || nAps > 1)) {
+        std::cerr << "Error: apMode=plain no tiene controlador ni EDCA: no admite controlPeriodS, surrogateModel, "
+                     "simSearch, warmupForkS, mpi ni nAps > 1\n";
+        return 1;
+    }
+    if (resultsFormat != "binary" && resultsFormat != "csv" && resultsFormat != "both") {
+        std::cerr << "Error: resultsFormat debe ser 'binary', 'csv' o 'both'\n";
+        return 1;
+    }
+    if (apDrainMode != "device" && apDrainMode != "rate") {
+        std::cerr << "Error: apDrainMode debe ser 'device' o 'rate'\n";
+        return 1;
+    }
+    if (apScheduler != "strict" && apScheduler != "drr" && apScheduler != "wfq") {
+        std::cerr << "Error: apScheduler debe ser 'strict', 'drr' o 'wfq'\n";
+        return 1;
+    }
+    if (!ParseClassValues(apSchedWeights, schedWeights, false)) {
+        std::cerr << "Error: apSchedWeights debe tener 4 pesos positivos separados por comas (H,M,L,NRT)\n";
+        return 1;
+    }
+    std::array<double, PoFiAp::N_EDCA_SLOTS> capacities{};
+    if (apAqm != "taildrop" && apAqm != "red" && apAqm != "codel") {
+        std::cerr << "Error: apAqm debe ser 'taildrop', 'red' o 'codel'\n";
+        return 1;
+    }
+    if (!ParseClassValues(apQueueCapacity, capacities, true)) {
+        std::cerr << "Error: apQueueCapacity debe tener 4 capacidades (H,M,L,NRT) >= 0\n";
+        return 1;
+    }
+    for (uint32_t p = 0; p < PoFiAp::N_EDCA_SLOTS; ++p) {
+        queueCapacity[p] = static_cast<uint32_t>(capacities[p]);
+        if (apAqm == "red" && queueCapacity[p] == 0) {
+            std::cerr << "Error: apAqm=red necesita capacidades > 0 (los umbrales son fracción de la capacidad)\n";
+            return 1;
+        }
+    }
+    if (controlLatencyMs < 0 || controllerServiceUs < 0) {
+        std::cerr << "Error: controlLatencyMs y controllerServiceUs deben ser >= 0\n";
+        return 1;
+    }
+    if (pendingAction != "buffer" && pendingAction != "default") {
+        std::cerr << "Error: pendingAction debe ser 'buffer' o 'default'\n";
+        return 1;
+    }
+    if (controlPeriodS < 0) {
+        std::cerr << "Error: controlPeriodS debe ser >= 0\n";
+        return 1;
+    }
+    if (nAps == 0 || nAps > 256 || apSpacing <= 0) {
+        std::cerr << "Error: nAps debe estar entre 1 y 256 y apSpacing ser > 0\n";
+        return 1;
+    }
+    if (apLayout != "grid" && apLayout != "hex") {
+        std::cerr << "Error: apLayout debe ser 'grid' o 'hex'\n";
+        return 1;
+    }
+    if (staAssociation != "position" && staAssociation != "ssid") {
+        std::cerr << "Error: staAssociation debe ser 'position' o 'ssid'\n";
+        return 1;
+    }
+    cellChannels.clear();
+    {
+        std::stringstream ss(apChannels);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            char* end = nullptr;
+            unsigned long channel = std::strtoul(field.c_str(), &end, 10);
+            if (end == field.c_str() || channel == 0 || channel > 200) {
+                cellChannels.clear();
+                break;
+            }
+            cellChannels.push_back(static_cast<uint32_t>(channel));
+        }
+    }
+    if (cellChannels.empty()) {
+        std::cerr << "Error: apChannels debe ser una lista de canales de 5 GHz separados por comas\n";
+        return 1;
+    }
+    if (!ParseClassValues(edcaTargetsMs, edcaTargets, true)) {
+        std::cerr << "Error: edcaTargetsMs debe tener 4 retardos (H,M,L,NRT) >= 0\n";
+        return 1;
+    }
+    if (!surrogateModel.empty()) {
+        auto model = std::make_shared<TreeEnsemble>();
+        std::string error;
+        if (!model->Load(surrogateModel, error) || !KDNController::CheckSurrogate(*model, error)) {
+            std::cerr << "Error: surrogateModel: " << error << "\n";
+            return 1;
+        }
+        std::cout << "Modelo sustituto: " << model->NumTrees() << " árboles, " << model->NumTargets() << " targets\n";
+        surrogate = model;
+    }
+    if (flowProbe != "light" && flowProbe != "flowmonitor") {
+        std::cerr << "Error: flowProbe debe ser 'light' o 'flowmonitor'\n";
+        return 1;
+    }
+    if (convergenceTol > 0 && (metricsWindowS <= 0 || !onlineStats)) {
+        std::cerr << "Error: convergenceTol requiere metricsWindowS > 0 y onlineStats\n";
+        return 1;
+    }
+    if (simSearch && !manifest.empty()) {
+        std::cerr << "Error: simSearch y manifest no se pueden combinar\n";
+        return 1;
+    }
+    if (warmupForkS < 0 || (warmupForkS > 0 && warmupForkS >= (TimeSimulationMin + 1.5) * 60)) {
+        std::cerr << "Error: warmupForkS debe estar entre 0 y la duración de la corrida\n";
+        return 1;
+    }
+    if (warmupForkS > 0 && (metricsWindowS > 0 || !batchOutput.empty() || enablePcap || enableAnimation || enableXml)) {
+        std::cerr << "Error: warmupForkS no admite metricsWindowS, batchOutput, enablePcap, enableAnimation ni enableXml "
+                     "(los hijos compartirían esos archivos)\n";
+        return 1;
+    }
+    if (warmupForkS > 0 && !simSearch && !LoadForkConfigs(forkConfigs)) {
+        return 1;
+    }
+    if (mpi && (!manifest.empty() || simSearch || warmupForkS > 0 || metricsWindowS > 0 || enableAnimation
+                || enableXml)) {
+        std::cerr << "Error: mpi no admite manifest, simSearch, warmupForkS, metricsWindowS, enableAnimation "
+                     "ni enableXml\n";
+        return 1;
+    }
+    if (mpi && flowProbe != "light") {
+        // FlowMonitor no reúne los flujos entre ranks; la sonda ligera sí (GatherFlowRecords)
+        std::cout << "mpi: se usa flowProbe=light (FlowMonitor no admite ejecución distribuida)\n";
+        flowProbe = "light";
+    }
+    if (mpi && (controlLatencyMs <= 0 || RngSeed == 0 || (nAps > 1 && staAssociation != "ssid"))) {
+        std::cerr << "Error: mpi necesita controlLatencyMs > 0 (retardo del enlace troncal y lookahead entre ranks), "
+                     "RngSeed fijo y, con varios APs, staAssociation=ssid (la celda de cada STA decide su rank)\n";
+        return 1;
+    }
+    if (simSearch && (simSearchCandidates == 0 || simSearchSeeds == 0 || simSearchMinS <= 0 || simSearchEta < 2)) {
+        std::cerr << "Error: simSearch necesita simSearchCandidates >= 1, simSearchSeeds >= 1, simSearchMinS > 0 y simSearchEta >= 2\n";
+        return 1;
+    }
+
+    Time::SetResolution(Time::NS);
+
+    // ========== HABILITAR LOGS ==========
+    packetLogEvery = (logLevel == "off") ? 0 : (logLevel == "sampled" ? std::max<uint32_t>(logEvery, 1) : 1);
+    if (logLevel != "off") {
+        LogComponentEnableAll(LOG_PREFIX_TIME);
+        LogComponentEnable("SDWN_PoFi_NS3", LOG_LEVEL_INFO);
+    }
+#if !SDWN_PACKET_LOG
+    if (logLevel != "off") {
+        std::cout << "Nota: logs por paquete compilados fuera (SDWN_PACKET_LOG=0)\n";
+    }
+#endif
+
+    if (!manifest.empty()) {
+        return RunManifest(manifest);
+    }
+    if (simSearch) {
+        return RunSimSearch();
+    }
+
+    // ========== EJECUCIÓN DISTRIBUIDA ==========
+    if (mpi) {
+#ifdef NS3_MPI
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        mpiRank = MpiInterface::GetSystemId();
+        mpiSize = MpiInterface::GetSize();
+        if (mpiSize < 2 || nAps < mpiSize - 1) {
+            if (mpiRank == 0) {
+                std::cerr << "Error: mpi necesita al menos 2 ranks (controlador + celdas) y nAps >= ranks - 1\n";
+            }
+            MpiInterface::Disable();
+            return 1;
+        }
+        // Los objetivos en línea serían parciales en cada rank
+        onlineStats = false;
+        if (mpiRank == 0) {
+            std::cout << "[MPI] " << mpiSize << " ranks: KDNController en el rank 0, " << nAps << " celdas en "
+                      << mpiSize - 1 << " ranks (onlineStats desactivado)\n";
+        }
+        int status = RunScenario();
+        MpiInterface::Disable();
+        return status;
+#else
+        std::cerr << "Error: mpi requiere ns-3 compilado con MPI (./ns3 configure --enable-mpi)\n";
+        return 1;
+#endif
+    }
+    return RunScenario();
+}
+
+// *********************************************************************************
+// ******************************** ESCENARIO **************************************
+// *********************************************************************************
+// Una corrida completa con los valores actuales de las variables globales. Deja el
+// simulador destruido para que la siguiente corrida del manifest parta de cero.
+int RunScenario() {
+    // ========== CONFIGURACIÓN DE SEMILLA ==========
+    if (RngSeed == 0) {
         RngSeed = time(NULL) + nCorrida * 1000;
     }
     
     SeedManager::SetSeed(RngSeed);
     SeedManager::SetRun(nCorrida);
 
+    // ========== CONTROLADOR ==========
+    // Uno por corrida, compartido por el AP; con controlPeriodS > 0 retoca el EDCA durante la simulación
+    auto controller = std::make_shared<KDNController>();
+    // Con mpi la latencia la pone el enlace troncal de cada celda
+    controller->SetControlChannel(MicroSeconds(mpiSize > 1 ? 0.0 : controlLatencyMs * 1000), MicroSeconds(controllerServiceUs));
+
+    // Con modelo sustituto los CW de la corrida los decide el controlador a partir de la mezcla de STAs;
+    // se escriben en las globales para que STAs, AP y resultados usen los mismos valores
+    if (surrogate) {
+        controller->SetSurrogate(surrogate);
+        KDNController::EdcaSet start {{
+            {AifsnValues[3], CwMinH, CwMaxH}, {AifsnValues[2], CwMinM, CwMaxM},
+            {AifsnValues[1], CwMinL, CwMaxL}, {AifsnValues[0], CwMinNRT, CwMaxNRT}
+        }};
+        KDNController::CwDecision decision = controller->ChooseCw({nStaH, nStaM, nStaL, nStaNRT}, PacketSize, start);
+        CwMinH = decision.cw[KDNController::HIGH].cwMin;
+        CwMaxH = decision.cw[KDNController::HIGH].cwMax;
+        CwMinM = decision.cw[KDNController::MEDIUM].cwMin;
+        CwMaxM = decision.cw[KDNController::MEDIUM].cwMax;
+        CwMinL = decision.cw[KDNController::LOW].cwMin;
+        CwMaxL = decision.cw[KDNController::LOW].cwMax;
+        CwMinNRT = decision.cw[KDNController::NRT].cwMin;
+        CwMaxNRT = decision.cw[KDNController::NRT].cwMax;
+        std::ios format(nullptr);
+        format.copyfmt(std::cout);
+        std::cout << "[KDNController] CW elegidos por el modelo: coste " << decision.score << ", "
+                  << decision.evaluations << " evaluaciones en " << std::fixed << std::setprecision(1)
+                  << decision.wallUs / 1000.0 << " ms (" << decision.wallUs / decision.evaluations << " us/evaluación)\n";
+        std::cout.copyfmt(format);
+    }
+
+    // AP plano: DCF sin QoS como no_sdwn.cc, así que los CW de la corrida son los del DCF por defecto
+    if (apMode == "plain") {
+        CwMinH = CwMinM = CwMinL = CwMinNRT = 15;
+        CwMaxH = CwMaxM = CwMaxL = CwMaxNRT = 1023;
+    }
+
     // ========== MOSTRAR CONFIGURACIÓN ==========
     std::cout << "\n=== "<< category <<" Simulation ===\n";
     std::cout << "STAs: " << nStaWifi << ", PacketSize: " << PacketSize << " bytes\n";
@@ -580,22 +3071,18 @@ int main(int argc, char* argv[]) {
     std::cout << "CWmin(H/M/L/NRT): " << CwMinH << "/" << CwMinM << "/" << CwMinL << "/" << CwMinNRT << "\n";
     std::cout << "CWmax(H/M/L/NRT): " << CwMaxH << "/" << CwMaxM << "/" << CwMaxL << "/" << CwMaxNRT << "\n";
     std::cout << "PacketSize: " << PacketSize << " bytes, Time: " << TimeSimulationMin << " min, Corridas: " << (int)nCorrida << "\n";
-    std::cout << "Mobility Type: " << mobilityType << "\n";
+    std::cout << "Mobility Type: " << mobilityType << ", AP: " << apMode << "\n";
     std::cout << "===========================================\n";
 
-    // ========== HABILITAR LOGS ==========
-    LogComponentEnableAll(LOG_PREFIX_TIME);
-    LogComponentEnable("SDWN_PoFi_NS3", LOG_LEVEL_INFO);
-
     uint32_t nStaWifi = nStaH + nStaM + nStaL + nStaNRT;
     Time delayBetweenStarts = MilliSeconds(delayBetweenStartsMs);
 
     //========== CONFIGURACION DE EDCA POR AC ==========
     std::map<std::string, PoFiAp::EdcaConfig> edcaParams = {
-        {"VO", {2, CwMinH, CwMaxH, 8192}},
-        {"VI", {2, CwMinM, CwMaxM, 16384}},
-        {"BE", {3, CwMinL, CwMaxL, 32768}},
-        {"BK", {7, CwMinNRT, CwMaxNRT, 65535}}
+        {"VO", {AifsnValues[3], CwMinH, CwMaxH, AmpduValues[3]}},
+        {"VI", {AifsnValues[2], CwMinM, CwMaxM, AmpduValues[2]}},
+        {"BE", {AifsnValues[1], CwMinL, CwMaxL, AmpduValues[1]}},
+        {"BK", {AifsnValues[0], CwMinNRT, CwMaxNRT, AmpduValues[0]}}
     };
     
     std::cout << "Corrida " << nCorrida
@@ -605,27 +3092,116 @@ int main(int argc, char* argv[]) {
               << ", PacketSize=" << PacketSize
               << std::endl;
 
+    // Baseline del lazo EDCA: los CW de la corrida (tras la elección del modelo, si lo hay)
+    if (controlPeriodS > 0) {
+        KDNController::EdcaSet baseline;
+        for (const auto& [ac, cfg] : edcaParams) {
+            baseline[3 - ACIndex[ac]] = {cfg.aifsn, cfg.cwMin, cfg.cwMax};
+        }
+        controller->EnableEdcaControl(baseline, edcaTargets);
+    }
+
     // ========== CREACIÓN DE NODOS ==========
-    NodeContainer wifiApNode;
-    wifiApNode.Create(1);
+    auto buildStart = std::chrono::steady_clock::now();     // Construcción de la topología (hasta Simulator::Run)
+    // Con mpi todos los ranks crean el nodo del controlador y todos los APs en el mismo orden (los
+    // enlaces troncales entre ranks se identifican por nodo y dispositivo), pero solo sus propias
+    // celdas llevan WiFi, aplicaciones y STAs. Sin mpi todas las celdas son locales.
+    const bool distributed = mpiSize > 1;
+    auto cellRank = [](uint32_t cell) { return mpiSize > 1 ? 1 + cell % (mpiSize - 1) : 0; };
+    Ptr<Node> controllerNode;
+    if (distributed) {
+        controllerNode = CreateObject<Node>(0);
+    }
+    NodeContainer allApNodes;
+    NodeContainer wifiApNode;                   // APs de este rank
+    std::vector<uint32_t> apCells;              // Celda de cada AP de wifiApNode
+    for (uint32_t k = 0; k < nAps; ++k) {
+        Ptr<Node> ap = CreateObject<Node>(cellRank(k));
+        allApNodes.Add(ap);
+        if (cellRank(k) == mpiRank) {
+            wifiApNode.Add(ap);
+            apCells.push_back(k);
+        }
+    }
 
+    // STAs de este rank; staIds es su índice global, que fija su AC
+    std::vector<uint32_t> staIds;
+    for (uint32_t i = 0; i < nStaWifi; ++i) {
+        if (!distributed || cellRank(i % nAps) == mpiRank) {
+            staIds.push_back(i);
+        }
+    }
     NodeContainer wifiStaNodes;
-    wifiStaNodes.Create(nStaWifi);
-
-    // ========== CONFIGURAR MOVILIDAD ==========
-    SetupMobility(wifiStaNodes, radio, RngSeed, mobilityType);
+    wifiStaNodes.Create(staIds.size(), mpiRank);
+    const uint32_t nLocalSta = wifiStaNodes.GetN();
 
-    // ========== AP FIJO EN EL CENTRO ==========
+    // ========== APs FIJOS: UNO POR CELDA (EN EL CENTRO SI SOLO HAY UNO) ==========
+    const std::vector<Vector> apPositions = ApPositions(nAps, apLayout, apSpacing);
+    double layoutRadius = 0.0;
+    Ptr<ListPositionAllocator> apAllocator = CreateObject<ListPositionAllocator>();
+    for (const Vector& position : apPositions) {
+        apAllocator->Add(position);
+        layoutRadius = std::max(layoutRadius, std::hypot(position.x, position.y));
+    }
     MobilityHelper apMobility;
-    apMobility.SetPositionAllocator("ns3::GridPositionAllocator",
-                    "MinX", DoubleValue(0.0),
-                    "MinY", DoubleValue(0.0),
-                    "DeltaX", DoubleValue(1.0),
-                    "DeltaY", DoubleValue(1.0),
-                    "GridWidth", UintegerValue(1),
-                    "LayoutType", StringValue("RowFirst"));
+    apMobility.SetPositionAllocator(apAllocator);
     apMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    apMobility.Install(wifiApNode.Get(0));
+    apMobility.Install(allApNodes);
+
+    // ========== TRONCAL AP <-> KDNController (mpi) ==========
+    // Un enlace punto a punto por celda: su retardo es la latencia del canal de control y el lookahead
+    // entre ranks. Va antes que el WiFi para que sea el dispositivo 0 de cada AP en todos los ranks.
+    std::vector<NetDeviceContainer> backboneLinks;
+    if (distributed) {
+        PointToPointHelper backbone;
+        backbone.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
+        backbone.SetChannelAttribute("Delay", TimeValue(MicroSeconds(controlLatencyMs * 1000)));
+        for (uint32_t k = 0; k < nAps; ++k) {
+            backboneLinks.push_back(backbone.Install(controllerNode, allApNodes.Get(k)));
+        }
+    }
+
+    // ========== CONFIGURAR MOVILIDAD Y CELDA DE CADA STA ==========
+    // "ssid": la STA i pertenece a la celda i % nAps y se despliega alrededor de su AP.
+    // "position": las STAs se reparten por todo el despliegue (SetupMobility usa 0.6 * radio)
+    // y cada una se asocia al SSID del AP más cercano a su posición inicial.
+    std::vector<uint32_t> staCell(nLocalSta, 0);
+    std::vector<std::vector<uint32_t>> cellStas(nAps);
+    if (staAssociation == "ssid" && nAps > 1) {
+        std::vector<NodeContainer> cellNodes(nAps);
+        for (uint32_t i = 0; i < nLocalSta; ++i) {
+            staCell[i] = staIds[i] % nAps;
+            cellNodes[staCell[i]].Add(wifiStaNodes.Get(i));
+        }
+        for (uint32_t k = 0; k < nAps; ++k) {
+            if (cellNodes[k].GetN() > 0) {
+                SetupMobility(cellNodes[k], radio, RngSeed, mobilityType, apPositions[k]);
+            }
+        }
+    } else if (nLocalSta > 0) {
+        SetupMobility(wifiStaNodes, radio + layoutRadius / 0.6, RngSeed, mobilityType, Vector(0.0, 0.0, 0.0));
+        for (uint32_t i = 0; i < nLocalSta && nAps > 1; ++i) {
+            Vector position = wifiStaNodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+            double best = std::numeric_limits<double>::max();
+            for (uint32_t k = 0; k < nAps; ++k) {
+                double d = CalculateDistance(position, apPositions[k]);
+                if (d < best) {
+                    best = d;
+                    staCell[i] = k;
+                }
+            }
+        }
+    }
+    for (uint32_t i = 0; i < nLocalSta; ++i) {
+        cellStas[staCell[i]].push_back(i);
+    }
+    for (uint32_t k = 0; k < nAps && nAps > 1; ++k) {
+        if (cellStas[k].size() > 4093) {
+            std::cerr << "Error: la celda " << k << " tiene " << cellStas[k].size()
+                      << " STAs (máximo 4093 por subred /20)\n";
+            return 1;
+        }
+    }
 
     // ========== CONFIGURAR DISPOSITIVOS WIFI ==========
     WifiHelper wifi;
@@ -637,39 +3213,46 @@ int main(int argc, char* argv[]) {
     YansWifiChannelHelper wifiChannel;
 
     if (model_realist){
-        
-        // Configuración del canal con modelo realista
-        wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-        
-        // Modelo de pérdida por distancia
-        wifiChannel.AddPropagationLoss("ns3::LogDistancePropagationLossModel",
-                                    "Exponent", DoubleValue(3.0),
-                                    "ReferenceLoss", DoubleValue(46.6777));
-
-        // Modelo de desvanecimiento Nakagami 
-        wifiChannel.AddPropagationLoss("ns3::NakagamiPropagationLossModel");
+        ConfigureRealisticChannel(wifiChannel, !lossCache);
     }
-    
-
-    wifiPhy.SetChannel(wifiChannel.Create());
 
-    // Configuración realista para 802_11 en 5GHz
-    wifiPhy.Set("ChannelSettings", StringValue("{36, 20, BAND_5GHZ, 0}"));
-    if (model_realist)
-        {
-            wifiPhy.Set("TxPowerStart", DoubleValue(16.0));
-            wifiPhy.Set("TxPowerEnd", DoubleValue(16.0));
+    // Mismos modelos que la cadena del helper, creados en el mismo orden (mismos streams de Nakagami).
+    // Umbral: RxSensitivity por defecto de la PHY (-101 dBm, 20 MHz, RxGain 0); el margen de 20 dB
+    // deja fuera solo colas de la Nakagami con probabilidad despreciable
+    std::vector<Ptr<CachedPropagationLossModel>> lossCaches;
+    auto createMedium = [&wifiChannel, &lossCaches]() {
+        Ptr<YansWifiChannel> medium = wifiChannel.Create();
+        if (model_realist && lossCache) {
+            Ptr<LogDistancePropagationLossModel> pathLoss = CreateObject<LogDistancePropagationLossModel>();
+            pathLoss->SetAttribute("Exponent", DoubleValue(3.0));
+            pathLoss->SetAttribute("ReferenceLoss", DoubleValue(46.6777));
+            Ptr<CachedPropagationLossModel> loss = CreateObject<CachedPropagationLossModel>(
+                pathLoss, CreateObject<NakagamiPropagationLossModel>(), -101.0, 20.0);
+            medium->SetPropagationLossModel(loss);
+            lossCaches.push_back(loss);
+        }
+        return medium;
+    };
 
-            // Agregar try-catch para compatibilidad
-            try {
-                wifiPhy.Set("RxNoiseFigure", DoubleValue(7.0));
-                wifiPhy.Set("RxGain", DoubleValue(0.0));
-                wifiPhy.Set("TxGain", DoubleValue(0.0));
-                wifiPhy.Set("CcaEdThreshold", DoubleValue(-62.0));
-            } catch (std::exception& e) {
-                std::cout << "Nota: Algunos atributos no disponibles en esta versión de NS3\n";
-            }
+    // Un medio para todas las celdas; con mpi uno por celda local: el medio no puede cruzar ranks,
+    // así que las celdas son independientes (sin interferencia mutua) con cualquier número de ranks
+    Ptr<YansWifiChannel> sharedMedium = createMedium();
+    std::vector<Ptr<YansWifiChannel>> cellMedium(nAps, sharedMedium);
+    if (distributed) {
+        for (uint32_t k : apCells) {
+            cellMedium[k] = createMedium();
+        }
+    }
+    wifiPhy.SetChannel(sharedMedium);
 
+    // Configuración realista para 802_11 en 5GHz
+    // Canal de cada celda: apChannels por turnos (con uno solo, todas co-canal)
+    auto cellChannelSettings = [](uint32_t cell) {
+        return StringValue("{" + std::to_string(cellChannels[cell % cellChannels.size()]) + ", 20, BAND_5GHZ, 0}");
+    };
+    wifiPhy.Set("ChannelSettings", cellChannelSettings(0));
+    if (model_realist) {
+        ConfigureRealisticPhy(wifiPhy);
     }
     
 
@@ -680,102 +3263,214 @@ int main(int argc, char* argv[]) {
     }
 
     WifiMacHelper wifiMac;
-    Ssid ssid = Ssid("SDWN_PoFi_NS3");
+    auto cellSsid = [](uint32_t cell) {
+        return Ssid(nAps == 1 ? "SDWN_PoFi_NS3" : "SDWN_PoFi_NS3_" + std::to_string(cell));
+    };
 
-    // ========== CONFIGURACIÓN AP ==========
+    // ========== CONFIGURACIÓN APs ==========
     NetDeviceContainer wifiApDevice;
-    wifiMac.SetType("ns3::ApWifiMac",
-                    "Ssid", SsidValue(ssid),
-                    "QosSupported", BooleanValue(true),
-                    "BeaconInterval", TimeValue(MicroSeconds(102400)));
-    wifiApDevice = wifi.Install(wifiPhy, wifiMac, wifiApNode.Get(0));
+    for (uint32_t j = 0; j < wifiApNode.GetN(); ++j) {
+        const uint32_t k = apCells[j];
+        wifiPhy.SetChannel(cellMedium[k]);
+        wifiPhy.Set("ChannelSettings", cellChannelSettings(k));
+        wifiMac.SetType("ns3::ApWifiMac",
+                        "Ssid", SsidValue(cellSsid(k)),
+                        "QosSupported", BooleanValue(apMode == "pofi"),
+                        "BeaconInterval", TimeValue(MicroSeconds(102400)));
+        wifiApDevice.Add(wifi.Install(wifiPhy, wifiMac, wifiApNode.Get(j)));
+    }
 
     // ========== CONFIGURACIÓN STAs ==========
-    NetDeviceContainer wifiStaDevices;
+    // AC de la STA de índice global g: VO las nStaH primeras, luego VI, BE y BK
+    auto staAcOf = [](uint32_t g) -> const std::string& {
+        return AcValues[g < nStaH ? 3 : g < nStaH + nStaM ? 2 : g < nStaH + nStaM + nStaL ? 1 : 0];
+    };
+    // Una llamada a wifi.Install por grupo (celda, AC), que comparte canal, SSID y MaxAmpduSize.
+    // Los dispositivos vuelven a wifiStaDevices en el orden de wifiStaNodes (direcciones,
+    // aplicaciones y resultados van por índice de STA) y el Txop de su AC queda en staTxop
+    const std::array<AcIndex, 4> wifiAcOf{{AC_BK, AC_BE, AC_VI, AC_VO}};   // Por ACIndex
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> staGroups;   // (celda, ACIndex) -> STAs
+    for (uint32_t i = 0; i < nLocalSta; ++i) {
+        staGroups[{staCell[i], ACIndex[staAcOf(staIds[i])]}].push_back(i);
+    }
+    std::vector<Ptr<NetDevice>> staDeviceOf(nLocalSta);
+    std::vector<Ptr<QosTxop>> staTxop(nLocalSta);
     WifiMacHelper staWifiMac;
-    for (uint32_t i = 0; i < nStaWifi; ++i) {
-        if (i < nStaH) AC = "VO";
-        else if (i < nStaH + nStaM) AC = "VI";
-        else if (i < nStaH + nStaM + nStaL) AC = "BE";
-        else AC = "BK";
-
-        auto cfg = edcaParams[AC];
+    for (const auto& [group, members] : staGroups) {
+        const auto [cell, acIndex] = group;
+        const std::string& ac = AcValues[acIndex];
+        const PoFiAp::EdcaConfig& cfg = edcaParams[ac];
 
+        NodeContainer groupNodes;
+        for (uint32_t i : members) {
+            groupNodes.Add(wifiStaNodes.Get(i));
+        }
+        wifiPhy.SetChannel(cellMedium[cell]);
+        wifiPhy.Set("ChannelSettings", cellChannelSettings(cell));
         staWifiMac.SetType("ns3::StaWifiMac",
-                           "Ssid", SsidValue(ssid),
+                           "Ssid", SsidValue(cellSsid(cell)),
                            "ActiveProbing", BooleanValue(false),
-                           "QosSupported", BooleanValue(true),
-                           AC + "_MaxAmpduSize", UintegerValue(cfg.ampduSize));                     
-
-        NetDeviceContainer staDev = wifi.Install(wifiPhy, staWifiMac, wifiStaNodes.Get(i));
-        wifiStaDevices.Add(staDev.Get(0));
+                           "QosSupported", BooleanValue(apMode == "pofi"),
+                           ac + "_MaxAmpduSize", UintegerValue(cfg.ampduSize));
+        NetDeviceContainer groupDevices = wifi.Install(wifiPhy, staWifiMac, groupNodes);
 
         //========== CONFIGURAR EDCA EN STAs ==========
-        Ptr<WifiNetDevice> wifiDevice = DynamicCast<WifiNetDevice>(staDev.Get(0));
-        Ptr<WifiMac> wifiMacPtr = wifiDevice->GetMac();
-        PointerValue ptr;
-        wifiMacPtr->GetAttribute(AC + "_Txop", ptr);
-        Ptr<QosTxop> edca = ptr.Get<QosTxop>();
-        if (edca) {
-            edca->SetAifsn(cfg.aifsn);
-            edca->SetMinCw(cfg.cwMin);
-            edca->SetMaxCw(cfg.cwMax);
+        for (uint32_t n = 0; n < members.size(); ++n) {
+            const uint32_t i = members[n];
+            staDeviceOf[i] = groupDevices.Get(n);
+            Ptr<QosTxop> edca = DynamicCast<WifiNetDevice>(groupDevices.Get(n))->GetMac()->GetQosTxop(wifiAcOf[acIndex]);
+            staTxop[i] = edca;
+            if (edca) {
+                edca->SetAifsn(cfg.aifsn);
+                edca->SetMinCw(cfg.cwMin);
+                edca->SetMaxCw(cfg.cwMax);
+                if (controller->EdcaControlEnabled()) {
+                    controller->RegisterStation(cell, static_cast<KDNController::Priority>(3 - acIndex), edca);
+                }
+            }
         }
     }
+    NetDeviceContainer wifiStaDevices;
+    for (const Ptr<NetDevice>& device : staDeviceOf) {
+        wifiStaDevices.Add(device);
+    }
 
     // ========== STACK DE INTERNET ==========
     InternetStackHelper internet;
-    internet.Install(wifiApNode);
+    internet.Install(allApNodes);
     internet.Install(wifiStaNodes);
 
+    // Una subred por celda: la 192.168.1.0/24 de siempre con un AP; con varios, 10.0.0.0/20 + celda.
+    // staInterfaces conserva el orden de wifiStaNodes; staAp es el AP (servidor de eco) de cada STA
     Ipv4AddressHelper address;
-    address.SetBase("192.168.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer staInterfaces = address.Assign(wifiStaDevices);
-    Ipv4InterfaceContainer apInterface = address.Assign(wifiApDevice);
+    std::vector<Ipv4InterfaceContainer> staInterfaceOf(nLocalSta);
+    Ipv4InterfaceContainer apInterface;
+    std::vector<Ipv4Address> cellApAddress(nAps);
+    for (uint32_t j = 0; j < wifiApNode.GetN(); ++j) {
+        const uint32_t k = apCells[j];
+        if (nAps == 1) {
+            address.SetBase("192.168.1.0", "255.255.255.0");
+        } else {
+            address.SetBase(Ipv4Address(0x0A000000 + (k << 12)), Ipv4Mask("255.255.240.0"));
+        }
+        for (uint32_t i : cellStas[k]) {
+            staInterfaceOf[i] = address.Assign(NetDeviceContainer(wifiStaDevices.Get(i)));
+        }
+        apInterface.Add(address.Assign(NetDeviceContainer(wifiApDevice.Get(j))));
+        cellApAddress[k] = apInterface.GetAddress(j);
+    }
+    Ipv4InterfaceContainer staInterfaces;
+    std::vector<Ipv4Address> staAp(nLocalSta);
+    for (uint32_t i = 0; i < nLocalSta; ++i) {
+        staInterfaces.Add(staInterfaceOf[i]);
+        staAp[i] = cellApAddress[staCell[i]];
+    }
+
+    // Troncal (mpi): 172.16.0.0/30 + 4 * celda. El controlador del rank 0 escucha en todos los enlaces;
+    // el de cada rank reenvía por el socket de sus APs
+    if (distributed) {
+        internet.Install(controllerNode);
+        Ptr<Socket> server;
+        if (mpiRank == 0) {
+            server = Socket::CreateSocket(controllerNode, UdpSocketFactory::GetTypeId());
+            server->Bind(InetSocketAddress(Ipv4Address::GetAny(), KDNController::CONTROL_PORT));
+            controller->ServeRemote(server);
+        }
+        for (uint32_t k = 0; k < nAps; ++k) {
+            address.SetBase(Ipv4Address(0xAC100000 + 4 * k), Ipv4Mask("255.255.255.252"));
+            Ipv4InterfaceContainer link = address.Assign(backboneLinks[k]);
+            if (cellRank(k) == mpiRank) {
+                Ptr<Socket> socket = Socket::CreateSocket(allApNodes.Get(k), UdpSocketFactory::GetTypeId());
+                socket->Bind();
+                controller->SetRemoteCell(k, socket, InetSocketAddress(link.GetAddress(0), KDNController::CONTROL_PORT));
+            }
+        }
+    }
 
     // ========== APLICACIONES ==========
-    PoFiApHelper pofiHelper(port);
-    ApplicationContainer pofiApps = pofiHelper.Install(wifiApNode);
-    pofiApps.Start(Seconds(0.0));
-    pofiApps.Stop(Minutes(TimeSimulationMin +1.5));
+    // pofiApps queda vacío con apMode=plain: el AP solo devuelve los ecos (línea base de no_sdwn.cc)
+    ApplicationContainer pofiApps;
+    if (apMode == "pofi") {
+        PoFiApHelper pofiHelper(port);
+        pofiHelper.SetScheduler(apDrainMode == "rate" ? PoFiAp::DRAIN_RATE : PoFiAp::DRAIN_DEVICE,
+                                apTxQueueLimit, DataRate(apServiceRate), MilliSeconds(apPollIntervalMs));
+        pofiHelper.SetRxCopyHeader(apRxCopyHeader);
+        pofiHelper.SetDiscipline(apScheduler, schedWeights, apDrrQuantumBytes);
+        pofiHelper.SetQueueManagement(apAqm == "codel" ? PoFiAp::AQM_CODEL : (apAqm == "red" ? PoFiAp::AQM_RED : PoFiAp::AQM_TAILDROP),
+                                      queueCapacity, MicroSeconds(apCodelTargetMs * 1000), MicroSeconds(apCodelIntervalMs * 1000));
+        pofiHelper.SetController(controller);
+        pofiHelper.SetPendingAction(pendingAction == "default" ? PoFiAp::PENDING_DEFAULT : PoFiAp::PENDING_BUFFER,
+                                    pendingBufferLimit);
+        pofiHelper.SetControlPeriod(Seconds(controlPeriodS));
+        pofiApps = pofiHelper.Install(wifiApNode, apCells);
+        pofiApps.Start(Seconds(0.0));
+        pofiApps.Stop(Minutes(TimeSimulationMin +1.5));
+    } else {
+        UdpEchoServerHelper echoServer(port);
+        ApplicationContainer serverApps = echoServer.Install(wifiApNode);
+        serverApps.Start(Seconds(0.0));
+        serverApps.Stop(Minutes(TimeSimulationMin + 1.5));
+    }
+
+    // ========== ESTADÍSTICAS EN LÍNEA POR AC ==========
+    // Timeout de pérdida de FlowMonitor (10 s) y penalización/filtro de IA/02_Stadistics.py (onlineLostPenaltyMs, onlineMaxLostPackets)
+    std::unique_ptr<OnlineAcStats> onlineAcStats;
+    if (onlineStats) {
+        onlineAcStats = std::make_unique<OnlineAcStats>(Seconds(10), onlineLostPenaltyMs, onlineMaxLostPackets);
+        for (uint32_t j = 0; j < wifiApNode.GetN(); ++j) {
+            onlineAcStats->AttachReceiver(wifiApNode.Get(j));
+        }
+    }
 
     ApplicationContainer clientApps;
     Time startTime = Seconds(1.0);
 
     for (uint32_t i = 0; i < wifiStaNodes.GetN(); ++i) {
-        
-        if (i < nStaH) AC = "VO";
-        else if (i < nStaH + nStaM) AC = "VI";
-        else if (i < nStaH + nStaM + nStaL) AC = "BE";
-        else AC = "BK";
+        const uint32_t g = staIds[i];
+        AC = staAcOf(g);
 
         uint32_t tosValue = TosValues[ACIndex[AC]];
         uint32_t interval = IntervalValues[ACIndex[AC]];
         
         uint32_t MaxPackets = TimeSimulationMin * 60 / interval;
 
-        UdpEchoClientHelper echoClient(apInterface.GetAddress(0), port);
+        UdpEchoClientHelper echoClient(staAp[i], port);
         echoClient.SetAttribute("MaxPackets", UintegerValue(MaxPackets));
         echoClient.SetAttribute("Interval", TimeValue(Seconds(interval)));
         echoClient.SetAttribute("PacketSize", UintegerValue(PacketSize));
         echoClient.SetAttribute("Tos", UintegerValue(tosValue));
 
         ApplicationContainer app = echoClient.Install(wifiStaNodes.Get(i));
+        startTime = Seconds(1.0) + delayBetweenStarts * g;     // Escalonado por índice global (igual con mpi)
         app.Start(startTime);
         app.Stop(Minutes(TimeSimulationMin + 1));
         clientApps.Add(app);
+        if (onlineAcStats) {
+            onlineAcStats->AddStation(app.Get(0), 3 - ACIndex[AC]);    // VO=HIGH(0) ... BK=NRT(3)
+        }
 
         // Incrementar el tiempo de inicio para la próxima STA
         startTime += delayBetweenStarts;
 
-        Sta_Information(i, tosValue, AC, staInterfaces, wifiStaDevices);
+        if (logLevel != "off") {
+            Sta_Information(i, tosValue, AC, staInterfaces, wifiStaDevices);
+        }
     }
 
     // ========== MONITOR DE FLUJO ==========
+    // FlowMonitor por defecto (y siempre con XML); sonda ligera de los ecos con flowProbe=light
     Ptr<FlowMonitor> flowMonitor;
+    Ptr<Ipv4FlowClassifier> classifier;
     FlowMonitorHelper flowHelper;
-    flowMonitor = flowHelper.InstallAll();
-    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
+    std::unique_ptr<EchoFlowProbe> echoProbe;
+    if (flowProbe == "flowmonitor" || enableXml) {
+        flowMonitor = flowHelper.InstallAll();
+        classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
+    } else {
+        echoProbe = std::make_unique<EchoFlowProbe>(staAp, staInterfaces, Seconds(10));
+        echoProbe->Install(wifiApNode);
+        echoProbe->Install(wifiStaNodes);
+    }
     
     // ========== ANIMACIÓN (OPCIONAL) ==========
     if (enableAnimation) {
@@ -790,9 +3485,12 @@ int main(int argc, char* argv[]) {
         
         AnimationInterface anim(filepath_anim + filename_anim);
         anim.EnablePacketMetadata(true);
-        anim.UpdateNodeDescription(0, "Access Point");
-        anim.SetConstantPosition(wifiApNode.Get(0), 0.0, 0.0);
-        anim.UpdateNodeColor(0, 0, 255, 0);  // AP en verde
+        for (uint32_t k = 0; k < nAps; ++k) {
+            Ptr<Node> ap = allApNodes.Get(k);
+            anim.UpdateNodeDescription(ap, nAps == 1 ? "Access Point" : "Access Point " + std::to_string(k));
+            anim.SetConstantPosition(ap, apPositions[k].x, apPositions[k].y);
+            anim.UpdateNodeColor(ap, 0, 255, 0);  // AP en verde
+        }
         
         std::cout << "Animation enabled: " << filepath_anim + filename_anim << "\n";
     }
@@ -815,10 +3513,196 @@ int main(int argc, char* argv[]) {
         wifiPhy.EnablePcap(pcapBasePath + pcapPrefix + "_wifi", wifiApNode);
     }
     
+    // ========== MÉTRICAS POR VENTANA / PARADA POR CONVERGENCIA ==========
+    std::ofstream windowFile;
+    if (onlineAcStats && metricsWindowS > 0) {
+        const std::string windowPath = windowOutput.empty()
+            ? "scratch/Estadisticas/" + category + "/Results_Finals/Windowed_Metrics.csv"
+            : windowOutput;
+        fs::path parent = fs::path(windowPath).parent_path();
+        if (!parent.empty()) {
+            fs::create_directories(parent);
+        }
+        bool writeHeader = !fs::exists(windowPath) || fs::file_size(windowPath) == 0;
+        windowFile.open(windowPath, std::ios::app);
+        if (writeHeader) {
+            windowFile << ScenarioFeaturesHeader();
+            OnlineAcStats::WriteWindowHeader(windowFile);
+            windowFile << "\n";
+        }
+        // startTime quedó en el arranque de la última STA: antes no hay régimen estacionario
+        onlineAcStats->EnableWindows(Seconds(metricsWindowS), &windowFile, ScenarioFeatures(), startTime);
+        if (convergenceTol > 0) {
+            onlineAcStats->EnableEarlyStop(convergenceTol, convergenceMinWindows);
+        }
+    }
+
+    const std::string onlineTargetsPath = onlineStatsOutput.empty()
+        ? "scratch/Estadisticas/" + category + "/Results_Finals/Online_Targets.csv"
+        : onlineStatsOutput;
+    if (onlineAcStats && onlineStatsIntervalS > 0) {
+        for (Time t = Seconds(onlineStatsIntervalS); t < Minutes(TimeSimulationMin + 1.5); t += Seconds(onlineStatsIntervalS)) {
+            Simulator::Schedule(t, &EmitOnlineTargets, onlineAcStats.get(), onlineTargetsPath);
+        }
+    }
+
+    std::chrono::duration<double> buildWall = std::chrono::steady_clock::now() - buildStart;
+    std::cout << "Topología construida en " << buildWall.count() << " s (" << nLocalSta << " STAs, "
+              << wifiApNode.GetN() << " APs)\n";
+
+    // ========== FORK TRAS EL CALENTAMIENTO ==========
+    // Topología, asociación, arranque escalonado de las STAs y Minstrel se simulan una sola vez;
+    // cada hijo hereda ese estado, aplica su configuración de CW y simula solo la ventana de medida
+    if (warmupForkS > 0 && !warmForkConfigs.empty()) {
+        Simulator::Stop(Seconds(warmupForkS));
+        auto warmStart = std::chrono::steady_clock::now();
+        Simulator::Run();
+        std::chrono::duration<double> warmWall = std::chrono::steady_clock::now() - warmStart;
+        std::cout << "Calentamiento compartido: " << warmupForkS << " s simulados en " << warmWall.count()
+                  << " s, " << warmForkConfigs.size() << " configuraciones\n";
+
+        const uint32_t workers = forkWorkers > 0 ? forkWorkers
+                                                 : static_cast<uint32_t>(std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+        auto reap = []() {
+            int status = 0;
+            return ::waitpid(-1, &status, 0) > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        };
+        uint32_t running = 0;
+        uint32_t failed = 0;
+        int chosen = -1;
+        for (size_t i = 0; i < warmForkConfigs.size() && chosen < 0; ++i) {
+            WarmForkConfig& config = warmForkConfigs[i];
+            // Con tuberías (simSearch) los hijos esperan órdenes y el ritmo lo marca el driver
+            for (; config.requestFd < 0 && running >= workers; running--) {
+                failed += reap() ? 0 : 1;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                chosen = static_cast<int>(i);
+            } else if (pid < 0) {
+                std::cerr << "Error: fork: " << std::strerror(errno) << std::endl;
+                failed++;
+            } else {
+                running++;
+            }
+            if (pid != 0 && config.requestFd >= 0) {
+                ::close(config.requestFd);
+                ::close(config.replyFd);
+            }
+        }
+        if (chosen < 0) {
+            for (; running > 0; running--) {
+                failed += reap() ? 0 : 1;
+            }
+            Simulator::Destroy();
+            std::cout << "Fork tras el calentamiento: " << warmForkConfigs.size() << " configuraciones, "
+                      << failed << " fallidas\n";
+            return failed == 0 ? 0 : 1;
+        }
+
+        // Hijo: su configuración de CW sobre la red ya caliente, con la medida desde cero
+        warmForkChild = true;
+        for (size_t i = 0; i < warmForkConfigs.size(); ++i) {
+            if (static_cast<int>(i) != chosen && warmForkConfigs[i].requestFd >= 0) {
+                ::close(warmForkConfigs[i].requestFd);
+                ::close(warmForkConfigs[i].replyFd);
+            }
+        }
+        const WarmForkConfig& config = warmForkConfigs[chosen];
+        searchRequestFd = config.requestFd;
+        searchReplyFd = config.replyFd;
+        CwMinH = config.cw[0];
+        CwMaxH = config.cw[1];
+        CwMinM = config.cw[2];
+        CwMaxM = config.cw[3];
+        CwMinL = config.cw[4];
+        CwMaxL = config.cw[5];
+        CwMinNRT = config.cw[6];
+        CwMaxNRT = config.cw[7];
+
+        KDNController::EdcaSet baseline;
+        for (auto& [ac, cfg] : edcaParams) {
+            const uint32_t priority = 3 - ACIndex[ac];
+            cfg.cwMin = config.cw[2 * priority];
+            cfg.cwMax = config.cw[2 * priority + 1];
+            baseline[priority] = {cfg.aifsn, cfg.cwMin, cfg.cwMax};
+            for (uint32_t k = 0; k < pofiApps.GetN(); ++k) {
+                DynamicCast<PoFiAp>(pofiApps.Get(k))->SetEdcaConfig(static_cast<KDNController::Priority>(priority), cfg);
+            }
+        }
+        for (uint32_t i = 0; i < nLocalSta; ++i) {
+            if (staTxop[i]) {
+                const PoFiAp::EdcaConfig& cfg = edcaParams[staAcOf(staIds[i])];
+                staTxop[i]->SetMinCw(cfg.cwMin);
+                staTxop[i]->SetMaxCw(cfg.cwMax);
+            }
+        }
+        if (controller->EdcaControlEnabled()) {
+            controller->EnableEdcaControl(baseline, edcaTargets);
+        }
+
+        for (uint32_t k = 0; k < pofiApps.GetN(); ++k) {
+            DynamicCast<PoFiAp>(pofiApps.Get(k))->ResetMetrics();
+        }
+        if (onlineAcStats) {
+            onlineAcStats->Reset();
+        }
+        if (echoProbe) {
+            echoProbe->Reset();
+        } else {
+            flowMonitor->ResetAllStats();
+        }
+    }
+
     // ========== EJECUCIÓN ==========
+    // Trabajador de simSearch: la red ya asociada avanza por tramos y el proceso termina ahí
+    if (searchRequestFd >= 0) {
+        RunSearchSegments(onlineAcStats.get());
+    }
     std::cout << "\n=== Iniciando simulación ===\n";
-    Simulator::Stop(Minutes(TimeSimulationMin + 1.5));
+    Simulator::Stop(Minutes(TimeSimulationMin + 1.5) - Simulator::Now());     // Tras un fork, Now() es el calentamiento
+    auto runStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    std::chrono::duration<double> runWall = std::chrono::steady_clock::now() - runStart;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "Sonda de flujos: " << (echoProbe ? "light" : "flowmonitor")
+              << " | Topología: " << buildWall.count() << " s"
+              << " | Simulator::Run: " << runWall.count() << " s"
+              << " | Pico RSS: " << usage.ru_maxrss / 1024.0 << " MB";
+    if (echoProbe) {
+        std::cout << " | Estado de la sonda: " << echoProbe->GetStateBytes() / 1024.0 << " KB";
+    }
+    std::cout << "\n";
+
+    for (uint32_t j = 0; j < pofiApps.GetN(); ++j) {
+        Ptr<PoFiAp> pofiAp = DynamicCast<PoFiAp>(pofiApps.Get(j));
+        const uint32_t k = pofiAp->GetCell();
+        if (nAps > 1) {
+            std::cout << "--- Celda " << k << " (" << cellStas[k].size() << " STAs, canal "
+                      << cellChannels[k % cellChannels.size()] << ") ---\n";
+        }
+        pofiAp->PrintRxStats(std::cout);
+        pofiAp->PrintSchedulerStats(std::cout);
+        pofiAp->PrintControlStats(std::cout);
+    }
+    if (apMode == "pofi" && (!controller->IsInstantaneous() || controller->EdcaControlEnabled())) {
+        controller->PrintStats(std::cout);
+    }
+    for (const Ptr<CachedPropagationLossModel>& loss : lossCaches) {
+        std::cout << "[LossCache] path loss: " << loss->Hits() << " hits, " << loss->Misses()
+                  << " computed (static pairs) | " << loss->Culled() << " below detection floor (no fading)\n";
+    }
+    if (onlineAcStats && onlineAcStats->Converged()) {
+        std::cout << "Convergencia alcanzada: simulación detenida en " << Simulator::Now().GetSeconds()
+                  << " s de " << Minutes(TimeSimulationMin + 1.5).GetSeconds() << " s\n";
+    }
+    if (onlineAcStats) {
+        EmitOnlineTargets(onlineAcStats.get(), onlineTargetsPath);
+    }
 
     // ========== XML OUTPUT (OPCIONAL) ==========
     if (enableXml) {
@@ -836,288 +3720,1467 @@ int main(int argc, char* argv[]) {
     }
 
     // ========== ANÁLISIS DE RESULTADOS ==========
-    AnalyzeFlowMonitorResults(flowMonitor, classifier, nStaWifi, category, std::to_string(PacketSize), nCorrida, CwMinH, CwMaxH, CwMinM, CwMaxM, CwMinL, CwMaxL, CwMinNRT, CwMaxNRT, nStaH, nStaM, nStaL, nStaNRT);
+    std::vector<FlowRecord> flowRecords = echoProbe ? echoProbe->GetFlowRecords()
+                                                    : CollectFlowMonitorRecords(flowMonitor, classifier);
+    // Filas por celda y flujos de todos los ranks se escriben en el rank 0 (con mpi, todos los
+    // ranks entran en WriteCellMetrics para la reunión, también el del controlador sin APs)
+    if (nAps > 1 && (pofiApps.GetN() > 0 || distributed)) {
+        WriteCellMetrics(flowRecords, staInterfaces, staIds, staCell, pofiApps, apPositions, *controller,
+                         cellOutput.empty() ? "scratch/Estadisticas/" + category + "/Results_Finals/Cell_Metrics.csv"
+                                            : cellOutput);
+    }
+#ifdef NS3_MPI
+    if (distributed) {
+        flowRecords = GatherFlowRecords(flowRecords);
+    }
+#endif
+    if (mpiRank == 0) {
+        AnalyzeFlowMonitorResults(flowRecords, nStaWifi, category, std::to_string(PacketSize), nCorrida, CwMinH, CwMaxH, CwMinM, CwMaxM, CwMinL, CwMaxL, CwMinNRT, CwMaxNRT, nStaH, nStaM, nStaL, nStaNRT);
+    }
 
     Simulator::Destroy();
+
+    // Un hijo del fork tras el calentamiento no vuelve al manifest ni al main del padre
+    if (warmForkChild) {
+        std::cout.flush();
+        _exit(0);
+    }
                     
     return 0;
 }
 
-// *********************************************************************************
-// ***************************** FUNCIÓN AUXILIAR DE MOVILIDAD *********************
-// *********************************************************************************
-void SetupMobility(NodeContainer& wifiStaNodes, double radio, uint32_t RngSeed, 
-                   const std::string& mobilityType) {
-    
-    uint32_t fixedSeed = 42; 
-    double Radio = 0.6 * radio;
-    // Margen de seguridad para evitar que NS_ASSERT falle por precisión decimal
-    double epsilon = 0.1; 
-    
-    Ptr<UniformRandomVariable> randVar = CreateObject<UniformRandomVariable>();
-    randVar->SetStream(fixedSeed);
-    
-    MobilityHelper mobility;
-
-    if (mobilityType == "no") {
-        std::cout << "Configurando las STAs como fijas (Disco)\n";
-        mobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                  "rho", DoubleValue(Radio),
-                  "X", DoubleValue(0.0),
-                  "Y", DoubleValue(0.0));
-        mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-        mobility.Install(wifiStaNodes);
-        
-    } else if (mobilityType == "yes") {
-        std::cout << "Configurando las STAs como moviles (Caminata Humana)\n";
-        
-        mobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                  "rho", DoubleValue(Radio),
-                  "X", DoubleValue(0.0),
-                  "Y", DoubleValue(0.0));
-        
-        // CORRECCIÓN: Expandimos los Bounds ligeramente (+ epsilon)
-        mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
-                    "Bounds", RectangleValue(Rectangle(-Radio - epsilon, Radio + epsilon, -Radio - epsilon, Radio + epsilon)),
-                    "Distance", DoubleValue(1.5),
-                    "Speed", StringValue("ns3::UniformRandomVariable[Min=1.0|Max=1.3]"),
-                    "Time", TimeValue(Seconds(2.0)),
-                    "Mode", StringValue("Time"));
-        
-        mobility.Install(wifiStaNodes);
-        
-    } else if (mobilityType == "mixer") {
-        uint32_t totalNodes = wifiStaNodes.GetN();
-        uint32_t maxMobileNodes = totalNodes * 0.2; 
-        uint32_t mobileCount = 0;
-        
-        std::cout << "Configurando mezcla: Máximo " << maxMobileNodes << " móviles (20%)\n";
-
-        for (uint32_t i = 0; i < totalNodes; ++i) {
-            if (mobileCount < maxMobileNodes) {
-                mobileCount++;
-                MobilityHelper mobileMobility;
-                mobileMobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                          "rho", DoubleValue(Radio), 
-                          "X", DoubleValue(0.0),
-                          "Y", DoubleValue(0.0));
-                
-                // CORRECCIÓN: Expandimos los Bounds aquí también
-                mobileMobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
-                                      "Bounds", RectangleValue(Rectangle(-Radio - epsilon, Radio + epsilon, -Radio - epsilon, Radio + epsilon)),
-                                      "Distance", DoubleValue(1.0),
-                                      "Speed", StringValue("ns3::UniformRandomVariable[Min=1.0|Max=1.3]"),
-                                      "Time", TimeValue(Seconds(2.0)));
-                
-                mobileMobility.Install(wifiStaNodes.Get(i));
-            } else {
-                MobilityHelper fixedMobility;
-                fixedMobility.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
-                          "rho", DoubleValue(Radio),
-                          "X", DoubleValue(0.0),
-                          "Y", DoubleValue(0.0));
-                
-                fixedMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-                fixedMobility.Install(wifiStaNodes.Get(i));
-            }
+// "v_H,v_M,v_L,v_NRT" -> un valor por clase del PoFiAp (pesos, capacidades)
+bool ParseClassValues(const std::string& text, std::array<double, PoFiAp::N_EDCA_SLOTS>& values, bool allowZero) {
+    std::stringstream ss(text);
+    std::string field;
+    uint32_t n = 0;
+    while (std::getline(ss, field, ',')) {
+        if (n == values.size()) {
+            return false;
         }
-    } else {
-        NS_FATAL_ERROR("Error: mobilityType '" << mobilityType << "' no es válido.");
+        char* end = nullptr;
+        double value = std::strtod(field.c_str(), &end);
+        if (end == field.c_str() || value < 0 || (value == 0 && !allowZero)) {
+            return false;
+        }
+        values[n++] = value;
     }
+    return n == values.size();
 }
 
-void Sta_Information(uint32_t index, uint32_t tosValue, std::string ac, Ipv4InterfaceContainer staInterfaces, NetDeviceContainer wifiStaDevices) {
-    // Obtener la dirección IP del nodo
-    Ipv4Address ip = staInterfaces.GetAddress(index);
-
-    // Obtener la dirección MAC del nodo
-    Ptr<NetDevice> staDevice = wifiStaDevices.Get(index);
-    Ptr<WifiNetDevice> wifiStaDevice = DynamicCast<WifiNetDevice>(staDevice);
-    ns3::Address macAddr = wifiStaDevice->GetAddress();  
-    Mac48Address macAddress = Mac48Address::ConvertFrom(macAddr);  
+// *********************************************************************************
+// ***************************** ESCENARIO DECLARATIVO *****************************
+// *********************************************************************************
+// Traducción entre las variables globales y el ScenarioSpec de scenario.h. Las de cada AC se
+// indexan por ACIndex (BK=0 ... VO=3); las clases del ScenarioSpec van de H (VO) a NRT (BK).
+ScenarioSpec ScenarioFromGlobals() {
+    const std::array<uint32_t*, 4> stas {{&nStaH, &nStaM, &nStaL, &nStaNRT}};
+    const std::array<uint32_t*, 4> cwMin {{&CwMinH, &CwMinM, &CwMinL, &CwMinNRT}};
+    const std::array<uint32_t*, 4> cwMax {{&CwMaxH, &CwMaxM, &CwMaxL, &CwMaxNRT}};
+    ScenarioSpec spec;
+    for (uint32_t p = 0; p < 4; ++p) {
+        const uint32_t ac = ACIndex[ScenarioSpec::ACS[p]];
+        spec.classes[p] = {*stas[p], *cwMin[p], *cwMax[p], AifsnValues[ac], AmpduValues[ac], IntervalValues[ac], TosValues[ac]};
+    }
+    spec.packetSize = PacketSize;
+    spec.timeMin = TimeSimulationMin;
+    spec.radio = radio;
+    spec.delayBetweenStartsMs = delayBetweenStartsMs;
+    spec.mobility = mobilityType;
+    spec.apMode = apMode;
+    spec.realistic = model_realist;
+    spec.rngSeed = RngSeed;
+    spec.run = nCorrida;
+    spec.category = category;
+    return spec;
+}
 
-    Ptr<WifiMac> macLayer = wifiStaDevice->GetMac();
-    PointerValue ptr;
-    Ptr<QosTxop> edca;
-    
-    // Configuración de TXOP según la categoría de acceso (AC)
-    macLayer->GetAttribute(ac + "_Txop", ptr);
-    edca = ptr.Get<QosTxop>();
-
-    // Extraer el valor AC (Access Category) asociado.
-    uint32_t acValue = edca->GetAccessCategory();
-    std::string  AC; 
-
-    if (acValue == 0)
-        AC = "AC_BE";
-    else if (acValue == 1)
-        AC = "AC_BK";
-    else if (acValue == 2)
-        AC = "AC_VI";
-    else if (acValue == 3)
-        AC = "AC_VO";
-
-    // Imprimir los valores
-    std::cout << "Device " << index + 1 << " : "
-              << "IP: " << ip << ", "
-              << "Tos: 0x" << std::hex << tosValue << std::dec << ", "
-              << "AC: " << AC << ", "
-              << "Max CW: " << edca->GetMaxCw(0) << ", "
-              << "Min CW: " << edca->GetMinCw(0) << ", "
-              << "Txop Limit: " << edca->GetTxopLimit(0) << ", "
-              << "MAC: " << macAddress << std::endl;
+void ApplyScenario(const ScenarioSpec& spec) {
+    const std::array<uint32_t*, 4> stas {{&nStaH, &nStaM, &nStaL, &nStaNRT}};
+    const std::array<uint32_t*, 4> cwMin {{&CwMinH, &CwMinM, &CwMinL, &CwMinNRT}};
+    const std::array<uint32_t*, 4> cwMax {{&CwMaxH, &CwMaxM, &CwMaxL, &CwMaxNRT}};
+    for (uint32_t p = 0; p < 4; ++p) {
+        const uint32_t ac = ACIndex[ScenarioSpec::ACS[p]];
+        const StaClassSpec& cls = spec.classes[p];
+        *stas[p] = cls.stas;
+        *cwMin[p] = cls.cwMin;
+        *cwMax[p] = cls.cwMax;
+        AifsnValues[ac] = cls.aifsn;
+        AmpduValues[ac] = cls.ampduSize;
+        IntervalValues[ac] = cls.intervalS;
+        TosValues[ac] = cls.tos;
+    }
+    nStaWifi = spec.TotalStas();
+    PacketSize = spec.packetSize;
+    TimeSimulationMin = spec.timeMin;
+    radio = spec.radio;
+    delayBetweenStartsMs = spec.delayBetweenStartsMs;
+    mobilityType = spec.mobility;
+    apMode = spec.apMode;
+    model_realist = spec.realistic;
+    RngSeed = spec.rngSeed;
+    nCorrida = spec.run;
+    category = spec.category;
 }
 
 // *********************************************************************************
-// ***************************** FUNCIÓN DE ANÁLISIS *******************************
+// ***************************** EJECUCIÓN POR LOTES *******************************
 // *********************************************************************************
+// Estado global de ns-3 que sobrevive a Simulator::Destroy y debe reiniciarse para que
+// cada fila del manifest sea idéntica a una corrida en un proceso nuevo: direcciones IPv4,
+// direcciones MAC de los dispositivos y flujos del RNG.
+void ResetGlobalSimulationState() {
+    Ipv4AddressGenerator::Reset();
+    Mac48Address::ResetAllocationIndex();
+    RngSeedManager::ResetNextStreamIndex();
+}
 
-void AnalyzeFlowMonitorResults(Ptr<FlowMonitor> flowMonitor, Ptr<Ipv4FlowClassifier> classifier, uint32_t nStaWifi, std::string category, std::string packetsize, uint8_t nCorrida, uint32_t CwMinH, uint32_t CwMaxH, uint32_t CwMinM, uint32_t CwMaxM, uint32_t CwMinL, uint32_t CwMaxL, uint32_t CwMinNRT, uint32_t CwMaxNRT, uint32_t nStaH, uint32_t nStaM, uint32_t nStaL, uint32_t nStaNRT) {
-    auto stats = flowMonitor->GetFlowStats();
-
-    // Variables para métricas agregadas
-    double totalThroughput = 0.0;
-    double totalDelay = 0.0;
-    uint32_t totalLostPackets = 0;
-    uint32_t totalPacketsSent = 0;
-    uint32_t totalPacketsReceived = 0;
-    
-    // Variables para análisis avanzado
-    double maxThroughput = 0.0;
-    FlowId maxFlowId = 0;
-    double latencySum = 0.0;
-    double latencySquaredSum = 0.0;
-    
-    // Vectores para distribución
-    std::vector<double> throughputs;
-    std::vector<double> delays;
-    std::map<uint32_t, double> packetLossByFlow;
-
-    // Crear archivo CSV
-
-    // Nombre del archivo CSV con número de STAs
-    const std::string filepath_statistics = "scratch/Estadisticas/" + category + "/1S/" + packetsize+"/"+ std::to_string(nStaWifi)+"/" ;
-    fs::create_directories(filepath_statistics);
+int RunManifest(const std::string& manifestPath) {
+    std::ifstream in(manifestPath);
+    if (!in.is_open()) {
+        std::cerr << "Error: no se pudo abrir el manifest: " << manifestPath << std::endl;
+        return 1;
+    }
 
-    const std::string filename =  category + "_" +std::to_string(nStaWifi) + "STA_" + packetsize + "B_" +"CWMin(" + std::to_string(CwMinH) + "-" + std::to_string(CwMinM)+ "-" + std::to_string(CwMinL) + "-" + std::to_string(CwMinNRT) + ")" +"_CWMax(" + std::to_string(CwMaxH) + "-" + std::to_string(CwMaxM)+ "-" + std::to_string(CwMaxL) + "-" + std::to_string(CwMaxNRT) + ")" + "_Mobility_" + mobilityType + "_Run" + std::to_string(nCorrida);
+    // Columnas admitidas: las que no aparezcan conservan el valor de la línea de comandos
+    const std::map<std::string, uint32_t*> columns = {
+        {"nStaH", &nStaH}, {"nStaM", &nStaM}, {"nStaL", &nStaL}, {"nStaNRT", &nStaNRT},
+        {"CwMinH", &CwMinH}, {"CwMaxH", &CwMaxH}, {"CwMinM", &CwMinM}, {"CwMaxM", &CwMaxM},
+        {"CwMinL", &CwMinL}, {"CwMaxL", &CwMaxL}, {"CwMinNRT", &CwMinNRT}, {"CwMaxNRT", &CwMaxNRT},
+        {"PacketSize", &PacketSize}, {"RngSeed", &RngSeed}, {"nCorrida", &nCorrida}
+    };
 
-    const std::string csvFilename = filepath_statistics + filename + ".csv";        
+    auto split = [](const std::string& line) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            field.erase(0, field.find_first_not_of(" \t\r"));
+            field.erase(field.find_last_not_of(" \t\r") + 1);
+            fields.push_back(field);
+        }
+        return fields;
+    };
 
-    std::ofstream csvFile(csvFilename);
-    if (!csvFile.is_open()) {
-        std::cerr << "Error: no se pudo abrir el archivo CSV: " << csvFilename << std::endl;
-        return;
+    std::string line;
+    if (!std::getline(in, line)) {
+        std::cerr << "Error: manifest vacío: " << manifestPath << std::endl;
+        return 1;
+    }
+    std::vector<uint32_t*> targets;
+    for (const std::string& name : split(line)) {
+        auto it = columns.find(name);
+        if (it == columns.end()) {
+            std::cerr << "Error: columna desconocida en el manifest: " << name << std::endl;
+            return 1;
+        }
+        targets.push_back(it->second);
     }
 
-    // Encabezados CSV
-    csvFile << "FlowID,Packet Size,nStaWifi,nStaH,nStaM,nStaL,nStaNRT,CWminH,CWmaxH,CWminM,CWmaxM,CWminL,CWmaxL,CWminNRT,CWmaxNRT,SourceAddress,DestAddress,Throughput(Kbps),Delay(ms),LostPackets,SentPackets,ReceivedPackets\n";
+    // Valores de la línea de comandos, restaurados antes de cada fila
+    std::map<uint32_t*, uint32_t> defaults;
+    for (const auto& [name, ptr] : columns) {
+        defaults[ptr] = *ptr;
+    }
 
-    // Procesar cada flujo
-    for (const auto &flow : stats) {
-        auto flowId = flow.first;
-        auto flowStats = flow.second;
-        auto flowClass = classifier->FindFlow(flowId);
+    uint32_t row = 0;
+    uint32_t failed = 0;
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields = split(line);
+        if (fields.empty() || fields[0].empty()) {
+            continue;
+        }
+        row++;
+        if (fields.size() != targets.size()) {
+            std::cerr << "Error: fila " << row << " del manifest con " << fields.size()
+                      << " columnas (esperadas " << targets.size() << ")" << std::endl;
+            failed++;
+            continue;
+        }
+        for (const auto& [ptr, value] : defaults) {
+            *ptr = value;
+        }
+        try {
+            for (size_t i = 0; i < fields.size(); ++i) {
+                *targets[i] = ParseUint32Field(fields[i]);
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: fila " << row << " del manifest con un valor no numérico: " << line << std::endl;
+            failed++;
+            continue;
+        }
 
-        // Calcular throughput
-        double throughput = 0.0;
-        if (flowStats.timeLastRxPacket > flowStats.timeFirstTxPacket) {
-            throughput = (flowStats.rxBytes * 8.0) / 
-                         (flowStats.timeLastRxPacket.GetSeconds() - flowStats.timeFirstTxPacket.GetSeconds()) / 
-                         1000; // Kbps
+        std::cout << "\n##### Manifest fila " << row << " #####\n";
+        ResetGlobalSimulationState();
+        if (RunScenario() != 0) {
+            failed++;
         }
+    }
 
-        // Calcular delay
-        double delay = (flowStats.rxPackets > 0) ? (flowStats.delaySum.GetSeconds() / flowStats.rxPackets) : 0.0;
+    std::cout << "\nManifest completado: " << row << " corridas, " << failed << " fallidas\n";
+    return failed == 0 ? 0 : 1;
+}
 
-        // Actualizar métricas agregadas
-        totalThroughput += throughput;
-        totalDelay += delay * flowStats.rxPackets;
-        totalLostPackets += flowStats.lostPackets;
-        totalPacketsSent += flowStats.txPackets;
-        totalPacketsReceived += flowStats.rxPackets;
+// Configuraciones de CW para warmupForkS: una por fila; las columnas que falten conservan
+// el valor de la línea de comandos
+bool LoadForkConfigs(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line)) {
+        std::cerr << "Error: warmupForkS necesita forkConfigs (CSV con columnas CwMinH..CwMaxNRT): '" << path << "'\n";
+        return false;
+    }
+    const std::array<std::string, 8> names = {"CwMinH", "CwMaxH", "CwMinM", "CwMaxM", "CwMinL", "CwMaxL", "CwMinNRT", "CwMaxNRT"};
+    auto split = [](const std::string& text) {
+        std::vector<std::string> fields;
+        std::stringstream ss(text);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            field.erase(0, field.find_first_not_of(" \t\r"));
+            field.erase(field.find_last_not_of(" \t\r") + 1);
+            fields.push_back(field);
+        }
+        return fields;
+    };
+    std::vector<int> slots;                     // Columna -> posición en WarmForkConfig::cw
+    for (const std::string& name : split(line)) {
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end()) {
+            std::cerr << "Error: columna desconocida en forkConfigs: " << name << "\n";
+            return false;
+        }
+        slots.push_back(static_cast<int>(it - names.begin()));
+    }
 
-        // Actualizar métricas avanzadas
-        if (throughput > maxThroughput) {
-            maxThroughput = throughput;
-            maxFlowId = flowId;
+    const WarmForkConfig defaults{{CwMinH, CwMaxH, CwMinM, CwMaxM, CwMinL, CwMaxL, CwMinNRT, CwMaxNRT}};
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields = split(line);
+        if (fields.empty() || fields[0].empty()) {
+            continue;
         }
-        
-        latencySum += delay;
-        latencySquaredSum += delay * delay;
-
-        // Almacenar para distribución
-        throughputs.push_back(throughput);
-        delays.push_back(delay);
-        packetLossByFlow[flowId] = (flowStats.txPackets > 0) ? 
-                                 (double)flowStats.lostPackets / flowStats.txPackets * 100 : 0.0;
-
-        // Escribir en CSV
-        csvFile << flowId << ","
-                << packetsize << ","
-                << nStaWifi << ","
-                << nStaH << ","
-                << nStaM << ","
-                << nStaL << ","
-                << nStaNRT << ","
-                << CwMinH << ","
-                << CwMaxH << ","
-                << CwMinM << ","
-                << CwMaxM << ","
-                << CwMinL << ","
-                << CwMaxL << ","
-                << CwMinNRT << ","
-                << CwMaxNRT << ","
-                << flowClass.sourceAddress << ","
-                << flowClass.destinationAddress << ","
-                << std::fixed << std::setprecision(2) << throughput << ","
-                << delay * 1000 << ","
-                << flowStats.lostPackets << ","
-                << flowStats.txPackets << ","
-                << flowStats.rxPackets << "\n";
-                
-        // Mostrar por consola
-        std::cout << "Flujo ID: " << flowId
-                  << ", Protocolo: " << flowClass.protocol
-                  << ", Desde: " << flowClass.sourceAddress
-                  << ", Hacia: " << flowClass.destinationAddress
-                  << "\n\tTasa de transferencia: " << throughput << " Kbps"
-                  << "\n\tLatencia promedio: " << delay * 1000 << " ms"
-                  << "\n\tPérdida de paquetes: " << flowStats.lostPackets << " (" 
-                  << packetLossByFlow[flowId] << "%)"
-                  << "\n\tPaquetes enviados: " << flowStats.txPackets
-                  << "\n\tPaquetes recibidos: " << flowStats.rxPackets << "\n";
-    }
-
-    // Cálculos finales
-    double averageDelay = totalPacketsReceived > 0 ? totalDelay / totalPacketsReceived : 0.0;
-    double packetLossRate = totalPacketsSent > 0 ? (double)totalLostPackets / totalPacketsSent * 100 : 0.0;
-    double meanLatency = stats.size() > 0 ? latencySum / stats.size() : 0.0;
-    double variance = stats.size() > 0 ? (latencySquaredSum / stats.size()) - (meanLatency * meanLatency) : 0.0;
-    double stddevLatency = std::sqrt(variance);
-
-    // Escribir resumen en CSV
-    csvFile << "\nResumen General\n";
-    csvFile << "Metrica,Valor\n";
-    csvFile << "Tasa de transferencia total (Kbps)," << totalThroughput << "\n";
-    csvFile << "Latencia promedio (ms)," << averageDelay * 1000 << "\n";
-    csvFile << "Desviación estándar latencia (ms)," << stddevLatency * 1000 << "\n";
-    csvFile << "Porcentaje de pérdida de paquetes (%)," << packetLossRate << "\n";
-    csvFile << "Tasa de transferencia máxima (Kbps)," << maxThroughput << "\n";
-    csvFile << "Flujo con máximo throughput," << maxFlowId << "\n";
-    csvFile << "Total paquetes enviados," << totalPacketsSent << "\n";
-    csvFile << "Total paquetes recibidos," << totalPacketsReceived << "\n";
-    csvFile << "Total paquetes perdidos," << totalLostPackets << "\n";
-
-    // Mostrar resumen por consola
-    std::cout << "\nResumen General:\n";
-    std::cout << "Tasa de transferencia total: " << totalThroughput << " Kbps\n";
-    std::cout << "Latencia promedio: " << averageDelay * 1000 << " ms\n";
-    std::cout << "Desviación estándar de la latencia: " << stddevLatency * 1000 << " ms\n";
-    std::cout << "Porcentaje de pérdida de paquetes: " << packetLossRate << " %\n";
-    std::cout << "Tasa de transferencia máxima: " << maxThroughput << " Kbps (Flujo ID: " << maxFlowId << ")\n";
-    std::cout << "Total paquetes enviados: " << totalPacketsSent << "\n";
-    std::cout << "Total paquetes recibidos: " << totalPacketsReceived << "\n";
-    std::cout << "Total paquetes perdidos: " << totalLostPackets << "\n";
-
-    csvFile.close();
+        if (fields.size() != slots.size()) {
+            std::cerr << "Error: fila de forkConfigs con " << fields.size() << " columnas (esperadas "
+                      << slots.size() << "): " << line << "\n";
+            return false;
+        }
+        WarmForkConfig config = defaults;
+        try {
+            for (size_t i = 0; i < fields.size(); ++i) {
+                config.cw[slots[i]] = ParseUint32Field(fields[i]);
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: fila de forkConfigs con un valor no numérico: " << line << "\n";
+            return false;
+        }
+        warmForkConfigs.push_back(config);
+    }
+    if (warmForkConfigs.empty()) {
+        std::cerr << "Error: forkConfigs sin configuraciones: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// *********************************************************************************
+// *************************** BÚSQUEDA POR SIMULACIÓN *****************************
+// *********************************************************************************
+// simSearch: valida los CW contra el simulador en lugar de fiarse del modelo sustituto.
+// Cada (candidato, semilla) es un proceso hijo (fork) que monta su escenario una sola vez y
+// espera órdenes por una tubería; el driver le pide "avanza hasta t" y el hijo continúa la
+// misma simulación (red ya asociada, colas y estadísticas incluidas) y responde con los
+// objetivos por AC. Successive halving: cada escalón multiplica el tiempo simulado por
+// simSearchEta y solo siguen los mejores 1/simSearchEta candidatos, así que los descartados
+// no llegan a simular la corrida completa y los que siguen no repiten lo ya simulado.
+// Todos los candidatos usan las mismas semillas (números aleatorios comunes).
+// Cada trabajador vivo guarda una simulación completa en memoria, así que como mucho hay
+// simSearchMaxResident: al llenarse, se termina un trabajador que ya acabó el escalón y, si su
+// candidato sigue, el escalón siguiente lo vuelve a simular desde t = 0 (se cambia memoria por
+// tiempo simulado, que con successive halving crece como mucho un factor eta / (eta - 1)).
+// Con warmupForkS > 0 el prefijo común se simula una vez por semilla: un proceso plantilla
+// llega al calentamiento con los CW de la línea de comandos y de ahí salen por fork los
+// trabajadores de todos los candidatos; los escalones miden solo desde el calentamiento. Esos
+// trabajadores no se pueden volver a crear, así que todos (más las plantillas) deben caber en
+// simSearchMaxResident.
+struct SimSearchReply {
+    double simTimeS;
+    std::array<double, OnlineAcStats::N_CLASSES> delayMs;      // Delay_X_mean
+    std::array<double, OnlineAcStats::N_CLASSES> lossPct;      // LostPackets_X_mean
+};
+
+// Lado del trabajador: tramos hasta que el driver pida 0 o cierre la tubería
+void RunSearchSegments(const OnlineAcStats* stats) {
+    double untilS = 0.0;
+    while (::read(searchRequestFd, &untilS, sizeof(untilS)) == sizeof(untilS) && untilS > 0) {
+        if (Seconds(untilS) > Simulator::Now()) {
+            Simulator::Stop(Seconds(untilS) - Simulator::Now());
+            Simulator::Run();
+        }
+        SimSearchReply reply{Simulator::Now().GetSeconds(), {}, {}};
+        stats->ClassTargets(reply.delayMs, reply.lossPct);
+        if (::write(searchReplyFd, &reply, sizeof(reply)) != sizeof(reply)) {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+int RunSimSearch() {
+    typedef std::array<uint32_t, 8> CwVector;      // CwMinH, CwMaxH, ..., CwMinNRT, CwMaxNRT
+
+    struct Trial {
+        pid_t pid = -1;
+        int requestFd = -1;
+        int replyFd = -1;
+        bool failed = false;
+        double liveS = 0.0;                         // Tiempo simulado del proceso vivo (0 sin proceso)
+        SimSearchReply last{};
+    };
+    struct Candidate {
+        CwVector cw;
+        std::vector<Trial> trials;                  // Una por semilla
+        double score = 0.0;
+        double scoreStd = 0.0;
+        std::array<double, OnlineAcStats::N_CLASSES> delayMs{};
+        std::array<double, OnlineAcStats::N_CLASSES> lossPct{};
+    };
+
+    // ====== Semilla común y escalones de tiempo simulado ======
+    if (RngSeed == 0) {
+        RngSeed = time(NULL) + nCorrida * 1000;
+    }
+    const uint32_t baseRun = nCorrida;
+    const double fullS = Minutes(TimeSimulationMin + 1.5).GetSeconds();
+    const bool warm = warmupForkS > 0;
+    std::vector<double> budgets;
+    for (double b = simSearchMinS; warmupForkS + b < fullS; b *= simSearchEta) {
+        budgets.push_back(warmupForkS + b);
+    }
+    budgets.push_back(fullS);
+    uint32_t workers = simSearchWorkers > 0 ? simSearchWorkers
+                                            : static_cast<uint32_t>(std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+    const uint32_t maxResident = simSearchMaxResident > 0 ? simSearchMaxResident : workers;
+    if (workers > maxResident) {
+        // Un trabajador simulando está vivo: el límite de memoria manda sobre el paralelismo
+        std::cout << "[simSearch] simSearchWorkers=" << workers << " supera simSearchMaxResident=" << maxResident
+                  << ": se simulan " << maxResident << " trabajadores a la vez\n";
+        workers = maxResident;
+    }
+
+    // ====== Candidatos: los CW de la línea de comandos, la elección del modelo y muestras de la rejilla ======
+    std::vector<Candidate> candidates;
+    auto addCandidate = [&](const CwVector& cw) {
+        for (const Candidate& c : candidates) {
+            if (c.cw == cw) {
+                return;
+            }
+        }
+        candidates.push_back(Candidate{cw, std::vector<Trial>(simSearchSeeds)});
+    };
+    addCandidate({CwMinH, CwMaxH, CwMinM, CwMaxM, CwMinL, CwMaxL, CwMinNRT, CwMaxNRT});
+    if (surrogate) {
+        SurrogateObjective objective;
+        std::string error;
+        if (objective.Bind(*surrogate, error)) {
+            CwSearchResult result = CoordinateSearch(objective, PacketSize, {nStaH, nStaM, nStaL, nStaNRT}, candidates[0].cw);
+            addCandidate(result.cw);
+        }
+    }
+    std::mt19937 rng(RngSeed);
+    std::uniform_int_distribution<uint32_t> pairDist(0, SurrogateObjective::N_PAIRS - 1);
+    uint32_t attempts = 0;
+    while (candidates.size() < simSearchCandidates && attempts++ < 100 * simSearchCandidates) {
+        CwVector cw;
+        for (uint32_t p = 0; p < 4; ++p) {
+            std::tie(cw[2 * p], cw[2 * p + 1]) = SurrogateObjective::Pair(pairDist(rng));
+        }
+        addCandidate(cw);
+    }
+
+    if (warm && (candidates.size() + 1) * simSearchSeeds > maxResident) {
+        std::cerr << "Error: simSearch con warmupForkS mantiene vivos " << candidates.size() << " trabajadores + 1 plantilla por semilla ("
+                  << (candidates.size() + 1) * simSearchSeeds << " simulaciones completas en memoria) y simSearchMaxResident es "
+                  << maxResident << ": súbelo si hay memoria, reduce simSearchCandidates/simSearchSeeds o quita warmupForkS\n";
+        return 1;
+    }
+
+    const std::string outputPath = simSearchOutput.empty()
+        ? "scratch/Estadisticas/" + category + "/Results_Finals/Sim_CW_Search.csv"
+        : simSearchOutput;
+    if (fs::path(outputPath).has_parent_path()) {
+        fs::create_directories(fs::path(outputPath).parent_path());
+    }
+    std::ofstream csv(outputPath);
+    if (!csv.is_open()) {
+        std::cerr << "Error: no se pudo crear " << outputPath << std::endl;
+        return 1;
+    }
+    csv << "Packet Size,nStaH,nStaM,nStaL,nStaNRT,Rung,SimTime(s),Candidate"
+        << ",CWminH,CWmaxH,CWminM,CWmaxM,CWminL,CWmaxL,CWminNRT,CWmaxNRT,Seeds,Score,Score_std";
+    for (const char* cls : SurrogateObjective::CLASSES) {
+        csv << ",Delay_" << cls << "_mean,LostPackets_" << cls << "_mean";
+    }
+    csv << ",Kept\n";
+
+    std::cout << "\n=== Búsqueda de CW por simulación ===\n"
+              << candidates.size() << " candidatos x " << simSearchSeeds << " semillas (RngSeed " << RngSeed
+              << ", corridas " << baseRun << ".." << baseRun + simSearchSeeds - 1 << "), " << workers
+              << " procesos (" << maxResident << " vivos como mucho), " << budgets.size() << " escalones hasta " << fullS << " s simulados";
+    if (warm) {
+        std::cout << ", fork tras " << warmupForkS << " s de calentamiento";
+    }
+    std::cout << "\n";
+
+    // ====== Trabajadores ======
+    std::signal(SIGPIPE, SIG_IGN);              // Un hijo caído no debe tumbar al driver
+    std::vector<int> parentFds;                 // Extremos del driver: los hijos los cierran al nacer
+
+    std::vector<pid_t> templates;               // Con warm: un proceso por semilla hasta el calentamiento
+
+    // En el hijo recién creado: salida silenciada y variables globales de la corrida
+    auto becomeWorker = [&](const CwVector& cw, uint32_t seed) {
+        for (int fd : parentFds) {
+            ::close(fd);
+        }
+        int devNull = ::open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            ::dup2(devNull, STDOUT_FILENO);
+            ::close(devNull);
+        }
+        CwMinH = cw[0];
+        CwMaxH = cw[1];
+        CwMinM = cw[2];
+        CwMaxM = cw[3];
+        CwMinL = cw[4];
+        CwMaxL = cw[5];
+        CwMinNRT = cw[6];
+        CwMaxNRT = cw[7];
+        nCorrida = baseRun + seed;
+        surrogate.reset();                      // Los CW son los del candidato
+        onlineStats = true;
+        onlineStatsIntervalS = 0;
+        metricsWindowS = 0;
+        convergenceTol = 0;
+        logLevel = "off";
+        packetLogEvery = 0;
+        LogComponentDisableAll(LOG_LEVEL_ALL);
+    };
+
+    auto openPipes = [&](Trial& trial, int& requestRead, int& replyWrite) {
+        int request[2];
+        int reply[2];
+        if (::pipe(request) != 0) {
+            return false;
+        }
+        if (::pipe(reply) != 0) {
+            ::close(request[0]);
+            ::close(request[1]);
+            return false;
+        }
+        trial.requestFd = request[1];
+        trial.replyFd = reply[0];
+        parentFds.push_back(request[1]);
+        parentFds.push_back(reply[0]);
+        requestRead = request[0];
+        replyWrite = reply[1];
+        return true;
+    };
+
+    // Un trabajador que monta su propia red desde t = 0
+    auto spawn = [&](const Candidate& candidate, uint32_t seed, Trial& trial) {
+        int requestRead = -1;
+        int replyWrite = -1;
+        if (!openPipes(trial, requestRead, replyWrite)) {
+            return false;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            becomeWorker(candidate.cw, seed);
+            searchRequestFd = requestRead;
+            searchReplyFd = replyWrite;
+            RunScenario();                      // No vuelve: RunSearchSegments termina el proceso
+            _exit(1);
+        }
+        ::close(requestRead);
+        ::close(replyWrite);
+        trial.pid = pid;
+        return pid > 0;
+    };
+
+    // Plantilla de una semilla: al llegar a warmupForkS, RunScenario crea un trabajador por
+    // candidato (WarmForkConfig con sus tuberías) y espera a que terminen
+    auto spawnWarm = [&](uint32_t seed) {
+        warmForkConfigs.clear();
+        for (Candidate& candidate : candidates) {
+            Trial& trial = candidate.trials[seed];
+            int requestRead = -1;
+            int replyWrite = -1;
+            if (!openPipes(trial, requestRead, replyWrite)) {
+                trial.failed = true;
+                continue;
+            }
+            trial.last.simTimeS = warmupForkS;
+            trial.liveS = warmupForkS;
+            warmForkConfigs.push_back({candidate.cw, requestRead, replyWrite});
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            becomeWorker(candidates[0].cw, seed);
+            _exit(RunScenario());
+        }
+        for (const WarmForkConfig& config : warmForkConfigs) {
+            ::close(config.requestFd);
+            ::close(config.replyFd);
+        }
+        warmForkConfigs.clear();
+        if (pid > 0) {
+            templates.push_back(pid);
+        }
+        return pid > 0;
+    };
+
+    auto stop = [&](Trial& trial) {
+        if (trial.requestFd < 0) {
+            return;
+        }
+        double zero = 0.0;
+        (void)::write(trial.requestFd, &zero, sizeof(zero));
+        ::close(trial.requestFd);
+        ::close(trial.replyFd);
+        parentFds.erase(std::remove_if(parentFds.begin(), parentFds.end(),
+                                       [&](int fd) { return fd == trial.requestFd || fd == trial.replyFd; }),
+                        parentFds.end());
+        if (trial.pid > 0) {
+            ::waitpid(trial.pid, nullptr, 0);
+        }
+        trial.pid = -1;
+        trial.requestFd = -1;
+        trial.replyFd = -1;
+        trial.liveS = 0.0;
+    };
+
+    auto residentCount = [&]() {
+        size_t n = 0;
+        for (const Candidate& candidate : candidates) {
+            for (const Trial& trial : candidate.trials) {
+                n += trial.requestFd >= 0 ? 1 : 0;
+            }
+        }
+        return n;
+    };
+
+    // ====== Escalones ======
+    std::vector<size_t> alive(candidates.size());
+    for (size_t c = 0; c < alive.size(); ++c) {
+        alive[c] = c;
+    }
+    double simulatedS = 0.0;                    // Suma de tramos simulados por todos los trabajadores
+    auto searchStart = std::chrono::steady_clock::now();
+    if (warm) {
+        for (uint32_t s = 0; s < simSearchSeeds; ++s) {
+            if (spawnWarm(s)) {
+                simulatedS += warmupForkS;
+            } else {
+                std::cerr << "Error: simSearch: no se pudo crear la plantilla de la semilla " << s << "\n";
+                for (Candidate& candidate : candidates) {
+                    candidate.trials[s].failed = true;
+                }
+            }
+        }
+    }
+
+    for (size_t rung = 0; rung < budgets.size(); ++rung) {
+        const double untilS = budgets[rung];
+        auto rungStart = std::chrono::steady_clock::now();
+
+        // Reparto (candidato, semilla) entre como mucho 'workers' procesos avanzando a la vez
+        // Primero los que ya tienen proceso: no ocupan más memoria y, al terminar, dejan hueco
+        std::vector<std::pair<size_t, uint32_t>> jobs;
+        for (size_t c : alive) {
+            for (uint32_t s = 0; s < simSearchSeeds; ++s) {
+                jobs.emplace_back(c, s);
+            }
+        }
+        std::stable_partition(jobs.begin(), jobs.end(), [&](const std::pair<size_t, uint32_t>& job) {
+            return candidates[job.first].trials[job.second].requestFd >= 0;
+        });
+        std::vector<pollfd> active;
+        std::vector<std::pair<size_t, uint32_t>> activeJobs;
+
+        // Libera un trabajador inactivo que ya terminó este escalón (su resultado queda en last)
+        auto evictFinished = [&]() {
+            for (size_t c : alive) {
+                for (uint32_t s = 0; s < simSearchSeeds; ++s) {
+                    Trial& trial = candidates[c].trials[s];
+                    bool busy = std::find(activeJobs.begin(), activeJobs.end(), std::make_pair(c, s)) != activeJobs.end();
+                    if (trial.requestFd >= 0 && !busy && trial.liveS >= untilS) {
+                        stop(trial);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        size_t next = 0;
+        while (next < jobs.size() || !active.empty()) {
+            while (next < jobs.size() && active.size() < workers) {
+                auto [c, s] = jobs[next];
+                Trial& trial = candidates[c].trials[s];
+                if (!warm && !trial.failed && trial.requestFd < 0 && residentCount() >= maxResident && !evictFinished() &&
+                    !active.empty()) {
+                    break;                      // Esperar a que alguno termine para hacer sitio
+                }
+                next++;
+                if (trial.failed) {
+                    continue;
+                }
+                if ((trial.requestFd < 0 && (warm || !spawn(candidates[c], s, trial))) ||
+                    ::write(trial.requestFd, &untilS, sizeof(untilS)) != sizeof(untilS)) {
+                    trial.failed = true;
+                    continue;
+                }
+                simulatedS += untilS - trial.liveS;
+                trial.liveS = untilS;
+                active.push_back({trial.replyFd, POLLIN, 0});
+                activeJobs.emplace_back(c, s);
+            }
+            if (active.empty()) {
+                continue;
+            }
+            if (::poll(active.data(), active.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Error: simSearch: poll: " << std::strerror(errno) << std::endl;
+                return 1;
+            }
+            for (size_t i = active.size(); i-- > 0;) {
+                if (active[i].revents == 0) {
+                    continue;
+                }
+                auto [c, s] = activeJobs[i];
+                Trial& trial = candidates[c].trials[s];
+                if (::read(trial.replyFd, &trial.last, sizeof(trial.last)) != sizeof(trial.last)) {
+                    std::cerr << "Error: simSearch: el trabajador del candidato " << c << " (semilla " << s
+                              << ") terminó sin responder\n";
+                    trial.failed = true;
+                    stop(trial);
+                }
+                active.erase(active.begin() + i);
+                activeJobs.erase(activeJobs.begin() + i);
+            }
+        }
+
+        // Objetivo del README sobre la media de las semillas: 0.35(D_H+L_H) + 0.35(D_M+L_M) + 0.30(D_L+L_L)
+        for (size_t c : alive) {
+            Candidate& candidate = candidates[c];
+            std::vector<double> scores;
+            candidate.delayMs.fill(0.0);
+            candidate.lossPct.fill(0.0);
+            for (const Trial& trial : candidate.trials) {
+                if (trial.failed) {
+                    continue;
+                }
+                double score = 0.0;
+                for (uint32_t p = 0; p < OnlineAcStats::N_CLASSES; ++p) {
+                    score += SurrogateObjective::WEIGHTS[p] * (trial.last.delayMs[p] + trial.last.lossPct[p]);
+                    candidate.delayMs[p] += trial.last.delayMs[p];
+                    candidate.lossPct[p] += trial.last.lossPct[p];
+                }
+                scores.push_back(score);
+            }
+            if (scores.empty()) {
+                candidate.score = std::numeric_limits<double>::infinity();
+                candidate.scoreStd = 0.0;
+                continue;
+            }
+            double mean = 0.0;
+            for (double score : scores) {
+                mean += score / scores.size();
+            }
+            double var = 0.0;
+            for (double score : scores) {
+                var += (score - mean) * (score - mean);
+            }
+            candidate.score = mean;
+            candidate.scoreStd = scores.size() > 1 ? std::sqrt(var / (scores.size() - 1)) : 0.0;
+            for (uint32_t p = 0; p < OnlineAcStats::N_CLASSES; ++p) {
+                candidate.delayMs[p] /= scores.size();
+                candidate.lossPct[p] /= scores.size();
+            }
+        }
+        std::stable_sort(alive.begin(), alive.end(),
+                         [&](size_t a, size_t b) { return candidates[a].score < candidates[b].score; });
+
+        const bool last = rung + 1 == budgets.size();
+        const size_t keep = last ? 1 : std::max<size_t>(1, (alive.size() + simSearchEta - 1) / simSearchEta);
+        for (size_t i = 0; i < alive.size(); ++i) {
+            const Candidate& candidate = candidates[alive[i]];
+            uint32_t seeds = 0;
+            for (const Trial& trial : candidate.trials) {
+                seeds += trial.failed ? 0 : 1;
+            }
+            csv << PacketSize << "," << nStaH << "," << nStaM << "," << nStaL << "," << nStaNRT
+                << "," << rung << "," << untilS << "," << alive[i];
+            for (uint32_t cw : candidate.cw) {
+                csv << "," << cw;
+            }
+            csv << "," << seeds << "," << candidate.score << "," << candidate.scoreStd;
+            for (uint32_t p = 0; p < OnlineAcStats::N_CLASSES; ++p) {
+                csv << "," << candidate.delayMs[p] << "," << candidate.lossPct[p];
+            }
+            csv << "," << (i < keep) << "\n";
+        }
+        csv.flush();
+
+        std::chrono::duration<double> rungWall = std::chrono::steady_clock::now() - rungStart;
+        std::cout << "[simSearch] Escalón " << rung << ": " << alive.size() << " candidatos hasta " << untilS
+                  << " s simulados en " << rungWall.count() << " s | mejor coste " << candidates[alive[0]].score
+                  << " (candidato " << alive[0] << ") | siguen " << keep << std::endl;
+
+        for (size_t i = keep; i < alive.size(); ++i) {
+            for (Trial& trial : candidates[alive[i]].trials) {
+                stop(trial);
+            }
+        }
+        alive.resize(keep);
+    }
+
+    // ====== Resultado ======
+    const Candidate& best = candidates[alive[0]];
+    for (Candidate& candidate : candidates) {
+        for (Trial& trial : candidate.trials) {
+            stop(trial);
+        }
+    }
+    for (pid_t pid : templates) {
+        ::waitpid(pid, nullptr, 0);
+    }
+    std::chrono::duration<double> searchWall = std::chrono::steady_clock::now() - searchStart;
+    const double exhaustiveS = fullS * candidates.size() * simSearchSeeds;
+    std::ios format(nullptr);
+    format.copyfmt(std::cout);
+    std::cout << "[simSearch] Mejor CW (H/M/L/NRT): " << best.cw[0] << "/" << best.cw[1] << " " << best.cw[2] << "/"
+              << best.cw[3] << " " << best.cw[4] << "/" << best.cw[5] << " " << best.cw[6] << "/" << best.cw[7]
+              << " | coste " << best.score << " +- " << best.scoreStd << "\n"
+              << "[simSearch] " << simulatedS << " s simulados (" << std::fixed << std::setprecision(1)
+              << 100.0 * simulatedS / exhaustiveS << "% de simular todos los candidatos completos) en "
+              << searchWall.count() << " s\n"
+              << "[simSearch] Resultados en " << outputPath << std::endl;
+    std::cout.copyfmt(format);
+    return std::isfinite(best.score) ? 0 : 1;
+}
+
+// *********************************************************************************
+// ***************************** FUNCIÓN AUXILIAR DE MOVILIDAD *********************
+// *********************************************************************************
+// SetupMobility está en scenario.h (común con no_sdwn.cc)
+
+// Posiciones de los APs centradas en el origen: rejilla de ceil(sqrt(n)) columnas o hexagonal
+// (filas impares desplazadas media separación y filas a spacing * sqrt(3)/2). Con n = 1, (0, 0).
+std::vector<Vector> ApPositions(uint32_t n, const std::string& layout, double spacing) {
+    const uint32_t cols = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+    const bool hex = layout == "hex";
+    const double rowStep = hex ? spacing * std::sqrt(3.0) / 2 : spacing;
+    std::vector<Vector> positions;
+    double cx = 0.0, cy = 0.0;
+    for (uint32_t k = 0; k < n; ++k) {
+        const uint32_t row = k / cols;
+        const double x = (k % cols) * spacing + (hex && row % 2 == 1 ? spacing / 2 : 0.0);
+        positions.emplace_back(x, row * rowStep, 0.0);
+        cx += x / n;
+        cy += row * rowStep / n;
+    }
+    for (Vector& position : positions) {
+        position.x -= cx;
+        position.y -= cy;
+    }
+    return positions;
+}
+
+// *********************************************************************************
+// ***************************** FUNCIÓN DE ANÁLISIS *******************************
+// *********************************************************************************
+// CSV por clase del PoFiAp (--apStatsCsv): junto al CSV por flujo de la corrida, con su mismo
+// nombre más la semilla. Se calcula al parar el AP, ya con los CW del hijo del fork
+std::string PoFiApStatsPath() {
+    if (!apStatsCsv) {
+        return "";
+    }
+    FlowRunInfo info;
+    info.category = category;
+    info.packetSize = PacketSize;
+    info.stas = {{nStaH, nStaM, nStaL, nStaNRT}};
+    info.cwMin = {{CwMinH, CwMinM, CwMinL, CwMinNRT}};
+    info.cwMax = {{CwMaxH, CwMaxM, CwMaxL, CwMaxNRT}};
+    info.run = nCorrida;
+    info.mobility = mobilityType;
+    const std::string flowCsv = FlowCsvPath(info);
+    return flowCsv.substr(0, flowCsv.size() - 4) + "_Seed" + std::to_string(RngSeed) + "_PoFiAp.csv";
+}
+
+// CSV por flujo común (WriteFlowResults, scenario.h); aquí se añaden la salida por lotes y el
+// bloque columnar .sdwncol de la corrida
+void AnalyzeFlowMonitorResults(const std::vector<FlowRecord>& stats, uint32_t nStaWifi, std::string category, std::string packetsize, uint8_t nCorrida, uint32_t CwMinH, uint32_t CwMaxH, uint32_t CwMinM, uint32_t CwMaxM, uint32_t CwMinL, uint32_t CwMaxL, uint32_t CwMinNRT, uint32_t CwMaxNRT, uint32_t nStaH, uint32_t nStaM, uint32_t nStaL, uint32_t nStaNRT) {
+    FlowRunInfo info;
+    info.category = category;
+    info.packetSize = static_cast<uint32_t>(std::stoul(packetsize));
+    info.stas = {{nStaH, nStaM, nStaL, nStaNRT}};
+    info.cwMin = {{CwMinH, CwMinM, CwMinL, CwMinNRT}};
+    info.cwMax = {{CwMaxH, CwMaxM, CwMaxL, CwMaxNRT}};
+    info.run = nCorrida;
+    info.seed = RngSeed;
+    info.mobility = mobilityType;
+
+    FlowCsvOptions options;
+    options.writeCsv = resultsFormat != "binary";
+    options.batchPath = batchOutput;
+    options.logEvery = packetLogEvery;
+
+    FlowResults results;
+    if (!WriteFlowResults(stats, info, options, results)) {
+        return;
+    }
+
+    // Bloque columnar de la corrida: escenario + resumen + columnas por flujo
+    if (resultsFormat != "csv") {
+        ColumnarFlowColumns columns;
+        columns.throughputKbps = results.throughputKbps;
+        columns.delayMs = results.delayMs;
+        for (const FlowRecord& flowStats : stats) {
+            columns.flowId.push_back(flowStats.flowId);
+            columns.source.push_back(flowStats.source.Get());
+            columns.destination.push_back(flowStats.destination.Get());
+            columns.lostPackets.push_back(flowStats.lostPackets);
+            columns.sentPackets.push_back(flowStats.txPackets);
+            columns.receivedPackets.push_back(flowStats.rxPackets);
+        }
+
+        ColumnarRunHeader header{};
+        header.run = nCorrida;
+        header.seed = RngSeed;
+        header.packetSize = info.packetSize;
+        header.nStaWifi = nStaWifi;
+        header.nSta[0] = nStaH;
+        header.nSta[1] = nStaM;
+        header.nSta[2] = nStaL;
+        header.nSta[3] = nStaNRT;
+        const uint32_t cw[8] = {CwMinH, CwMaxH, CwMinM, CwMaxM, CwMinL, CwMaxL, CwMinNRT, CwMaxNRT};
+        std::memcpy(header.cw, cw, sizeof(cw));
+        header.mobility = mobilityType == "no" ? 0 : (mobilityType == "yes" ? 1 : 2);
+        header.maxFlowId = results.maxFlowId;
+        header.totalSent = results.totalSent;
+        header.totalReceived = results.totalReceived;
+        header.totalLost = results.totalLost;
+        header.totalThroughputKbps = results.totalThroughputKbps;
+        header.averageDelayMs = results.averageDelayMs;
+        header.stddevDelayMs = results.stddevDelayMs;
+        header.lossRatePct = results.lossRatePct;
+        header.maxThroughputKbps = results.maxThroughputKbps;
+
+        std::string path = columnarOutput;
+        if (path.empty()) {
+            const std::string dir = "scratch/Estadisticas/" + category + "/Results_Finals/";
+            fs::create_directories(dir);
+            path = dir + "Results.sdwncol";
+        }
+        AppendColumnarBlock(path, header, columns);
+    }
+}
+
+// *********************************************************************************
+// ************************ SALIDA BINARIA COLUMNAR (.sdwncol) *********************
+// *********************************************************************************
+// Un bloque por corrida con un único write() en O_APPEND (formato en ColumnarRunHeader).
+bool AppendColumnarBlock(const std::string& path, const ColumnarRunHeader& header, const ColumnarFlowColumns& flows) {
+    const uint32_t n = flows.flowId.size();
+    const size_t payload = sizeof(ColumnarRunHeader) + n * (2 * sizeof(double) + 6 * sizeof(uint32_t));
+    const size_t blockBytes = (payload + 7) & ~size_t(7);
+
+    std::vector<char> block(blockBytes, 0);
+    ColumnarRunHeader h = header;
+    h.blockBytes = blockBytes;
+    h.nFlows = n;
+
+    char* out = block.data();
+    auto put = [&out](const void* src, size_t bytes) {
+        std::memcpy(out, src, bytes);
+        out += bytes;
+    };
+    put(&h, sizeof(h));
+    put(flows.throughputKbps.data(), n * sizeof(double));
+    put(flows.delayMs.data(), n * sizeof(double));
+    put(flows.flowId.data(), n * sizeof(uint32_t));
+    put(flows.source.data(), n * sizeof(uint32_t));
+    put(flows.destination.data(), n * sizeof(uint32_t));
+    put(flows.lostPackets.data(), n * sizeof(uint32_t));
+    put(flows.sentPackets.data(), n * sizeof(uint32_t));
+    put(flows.receivedPackets.data(), n * sizeof(uint32_t));
+
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: no se pudo abrir el archivo columnar: " << path << std::endl;
+        return false;
+    }
+    ssize_t written = ::write(fd, block.data(), block.size());
+    ::close(fd);
+    if (written != static_cast<ssize_t>(block.size())) {
+        std::cerr << "Error: escritura incompleta en " << path << std::endl;
+        return false;
+    }
+    std::cout << "Resultados columnar anexados: " << path << " (" << n << " flujos)\n";
+    return true;
+}
+
+// *********************************************************************************
+// *************************** OBJETIVOS EN LÍNEA (CSV) ****************************
+// *********************************************************************************
+// Columnas de escenario (features del RF + identificación de la corrida) comunes a los CSV
+// de objetivos en línea y de métricas por ventana.
+std::string ScenarioFeaturesHeader() {
+    return "Packet Size,nStaWifi,nStaH,nStaM,nStaL,nStaNRT,CWminH,CWmaxH,CWminM,CWmaxM,CWminL,CWmaxL,CWminNRT,CWmaxNRT"
+           ",Run,Seed,MobilityType";
+}
+
+std::string ScenarioFeatures() {
+    std::ostringstream row;
+    row << PacketSize << "," << (nStaH + nStaM + nStaL + nStaNRT) << ","
+        << nStaH << "," << nStaM << "," << nStaL << "," << nStaNRT << ","
+        << CwMinH << "," << CwMaxH << "," << CwMinM << "," << CwMaxM << ","
+        << CwMinL << "," << CwMaxL << "," << CwMinNRT << "," << CwMaxNRT << ","
+        << nCorrida << "," << RngSeed << "," << mobilityType;
+    return row.str();
+}
+
+// Una fila por emisión: features del escenario + objetivos de OnlineAcStats. Misma
+// estrategia que AppendColumnarBlock (un único write() en O_APPEND) para poder compartir
+// el archivo entre procesos; flock() hace atómicos la comprobación de archivo vacío y la
+// escritura, para que los hijos del fork tras el calentamiento no dupliquen la cabecera.
+void EmitOnlineTargets(const OnlineAcStats* stats, const std::string& path) {
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) {
+        fs::create_directories(parent);
+    }
+
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: no se pudo abrir el archivo de objetivos: " << path << std::endl;
+        return;
+    }
+
+    ::flock(fd, LOCK_EX);
+    std::ostringstream row;
+    if (::lseek(fd, 0, SEEK_END) == 0) {
+        row << ScenarioFeaturesHeader() << ",Time(s)";
+        OnlineAcStats::WriteHeader(row);
+        row << "\n";
+    }
+    row << ScenarioFeatures() << std::fixed << std::setprecision(5) << "," << Simulator::Now().GetSeconds();
+    stats->WriteRow(row);
+    row << "\n";
+
+    const std::string text = row.str();
+    ssize_t written = ::write(fd, text.data(), text.size());
+    ::close(fd);                // También libera el flock
+    if (written != static_cast<ssize_t>(text.size())) {
+        std::cerr << "Error: escritura incompleta en " << path << std::endl;
+    }
+}
+
+// *********************************************************************************
+// ****************************** MÉTRICAS POR CELDA *******************************
+// *********************************************************************************
+// Una fila por celda de pofiApps (nAps > 1): features del escenario, AP, STAs por clase, métricas
+// de los flujos de sus STAs (subida y bajada) agregadas por clase como en AnalyzeFlowMonitorResults,
+// y contadores del PoFiAp y del controlador compartido. Un único write() en O_APPEND; con mpi las
+// filas de cada rank se reúnen en el rank 0, el único que escribe (y decide la cabecera).
+void WriteCellMetrics(const std::vector<FlowRecord>& records, const Ipv4InterfaceContainer& staInterfaces,
+                      const std::vector<uint32_t>& staIds, const std::vector<uint32_t>& staCell,
+                      const ApplicationContainer& pofiApps, const std::vector<Vector>& apPositions,
+                      const KDNController& controller, const std::string& path) {
+    struct ClassAgg {
+        uint32_t stas = 0;
+        double throughputKbps = 0.0;
+        double delaySumS = 0.0;
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        uint64_t lost = 0;
+    };
+    const uint32_t nCells = static_cast<uint32_t>(apPositions.size());
+    std::vector<std::array<ClassAgg, 4>> cells(nCells);
+
+    auto priorityOf = [](uint32_t sta) {
+        return sta < nStaH ? 0u : sta < nStaH + nStaM ? 1u : sta < nStaH + nStaM + nStaL ? 2u : 3u;
+    };
+    std::unordered_map<uint32_t, uint32_t> staIndex;
+    for (uint32_t i = 0; i < staInterfaces.GetN(); ++i) {
+        staIndex[staInterfaces.GetAddress(i).Get()] = i;
+        cells[staCell[i]][priorityOf(staIds[i])].stas++;
+    }
+
+    for (const FlowRecord& record : records) {
+        auto it = staIndex.find(record.source.Get());
+        if (it == staIndex.end()) {
+            it = staIndex.find(record.destination.Get());
+        }
+        if (it == staIndex.end()) {
+            continue;
+        }
+        ClassAgg& agg = cells[staCell[it->second]][priorityOf(staIds[it->second])];
+        if (record.timeLastRxPacket > record.timeFirstTxPacket) {
+            agg.throughputKbps += record.rxBytes * 8.0
+                                  / (record.timeLastRxPacket.GetSeconds() - record.timeFirstTxPacket.GetSeconds()) / 1000;
+        }
+        agg.delaySumS += record.delaySum.GetSeconds();
+        agg.sent += record.txPackets;
+        agg.received += record.rxPackets;
+        agg.lost += record.lostPackets;
+    }
+
+    std::ostringstream rows;
+    for (uint32_t j = 0; j < pofiApps.GetN(); ++j) {
+        Ptr<PoFiAp> pofiAp = DynamicCast<PoFiAp>(pofiApps.Get(j));
+        const uint32_t k = pofiAp->GetCell();
+        uint64_t apReceived = 0, apSent = 0, apDropped = 0;
+        for (const PoFiAp::Metrics& metrics : pofiAp->metricsTable) {
+            apReceived += metrics.packetsReceived;
+            apSent += metrics.packetsSent;
+            apDropped += metrics.packetsLost;
+        }
+        uint32_t cellSta = 0;
+        for (const ClassAgg& agg : cells[k]) {
+            cellSta += agg.stas;
+        }
+        rows << ScenarioFeatures() << "," << nCells << "," << k << std::fixed << std::setprecision(2)
+             << "," << apPositions[k].x << "," << apPositions[k].y << ","
+             << cellChannels[k % cellChannels.size()] << "," << cellSta;
+        for (const ClassAgg& agg : cells[k]) {
+            rows << "," << agg.stas;
+        }
+        rows << std::setprecision(5);
+        for (const ClassAgg& agg : cells[k]) {
+            rows << "," << agg.throughputKbps
+                 << "," << (agg.received > 0 ? agg.delaySumS / agg.received * 1000 : 0.0)
+                 << "," << (agg.sent > 0 ? 100.0 * agg.lost / agg.sent : 0.0);
+        }
+        rows << "," << apReceived << "," << apSent << "," << apDropped << "," << pofiAp->GetTableMisses()
+             << "," << controller.CellPacketIns(k) << "," << controller.CellEdcaUpdates(k) << "\n";
+        rows.unsetf(std::ios::floatfield);
+    }
+
+    std::string text = rows.str();
+#ifdef NS3_MPI
+    if (mpiSize > 1) {
+        text = GatherText(text);
+        if (mpiRank != 0) {
+            return;
+        }
+    }
+#endif
+
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) {
+        fs::create_directories(parent);
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: no se pudo abrir el archivo de métricas por celda: " << path << std::endl;
+        return;
+    }
+
+    ::flock(fd, LOCK_EX);       // Como en EmitOnlineTargets: hijos del fork con el mismo archivo
+    if (::lseek(fd, 0, SEEK_END) == 0) {
+        std::ostringstream header;
+        header << ScenarioFeaturesHeader() << ",nAps,Cell,ApX,ApY,Channel,CellSta";
+        for (const char* cls : {"H", "M", "L", "NRT"}) {
+            header << ",CellSta" << cls;
+        }
+        for (const char* cls : {"H", "M", "L", "NRT"}) {
+            header << ",Throughput_" << cls << "(Kbps),Delay_" << cls << "(ms),LostPackets_" << cls << "(%)";
+        }
+        header << ",ApReceived,ApSent,ApDropped,TableMisses,PacketIns,EdcaUpdates\n";
+        text = header.str() + text;
+    }
+    ssize_t written = ::write(fd, text.data(), text.size());
+    ::close(fd);
+    if (written != static_cast<ssize_t>(text.size())) {
+        std::cerr << "Error: escritura incompleta en " << path << std::endl;
+    }
+    std::cout << "Métricas por celda (" << nCells << " APs): " << path << "\n";
+}
+
+#ifdef NS3_MPI
+// *********************************************************************************
+// *************************** EJECUCIÓN DISTRIBUIDA (MPI) *************************
+// *********************************************************************************
+// Reúne en el rank 0 el texto de todos los ranks, concatenado en orden de rank (el resto recibe "")
+std::string GatherText(const std::string& local) {
+    int bytes = static_cast<int>(local.size());
+    std::vector<int> counts(mpiSize), offsets(mpiSize);
+    MPI_Gather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    int total = 0;
+    if (mpiRank == 0) {
+        for (uint32_t r = 0; r < mpiSize; ++r) {
+            offsets[r] = total;
+            total += counts[r];
+        }
+    }
+    std::string all(total, '\0');
+    MPI_Gatherv(local.data(), bytes, MPI_CHAR, all.data(), counts.data(), offsets.data(), MPI_CHAR, 0,
+                MPI_COMM_WORLD);
+    return all;
+}
+
+// Reúne en el rank 0 los FlowRecord de todos los ranks (cada uno sondea solo sus STAs) y los
+// renumera en orden de primer envío, como FlowMonitor en una corrida serie (los scripts de IA
+// asignan la prioridad por posición de fila); el resto de ranks devuelve un vector vacío.
+std::vector<FlowRecord> GatherFlowRecords(const std::vector<FlowRecord>& local) {
+    struct PackedRecord {
+        uint32_t source;
+        uint32_t destination;
+        uint32_t protocol;
+        uint32_t txPackets;
+        uint32_t rxPackets;
+        uint32_t lostPackets;
+        uint64_t txBytes;
+        uint64_t rxBytes;
+        int64_t delaySumNs;
+        int64_t timeFirstTxNs;
+        int64_t timeLastRxNs;
+    };
+    std::vector<PackedRecord> packed;
+    packed.reserve(local.size());
+    for (const FlowRecord& record : local) {
+        packed.push_back({record.source.Get(), record.destination.Get(), record.protocol,
+                          record.txPackets, record.rxPackets, record.lostPackets,
+                          record.txBytes, record.rxBytes, record.delaySum.GetNanoSeconds(),
+                          record.timeFirstTxPacket.GetNanoSeconds(), record.timeLastRxPacket.GetNanoSeconds()});
+    }
+
+    int bytes = static_cast<int>(packed.size() * sizeof(PackedRecord));
+    std::vector<int> counts(mpiSize), offsets(mpiSize);
+    MPI_Gather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    int total = 0;
+    if (mpiRank == 0) {
+        for (uint32_t r = 0; r < mpiSize; ++r) {
+            offsets[r] = total;
+            total += counts[r];
+        }
+    }
+    std::vector<PackedRecord> all(total / sizeof(PackedRecord));
+    MPI_Gatherv(packed.data(), bytes, MPI_BYTE, all.data(), counts.data(), offsets.data(), MPI_BYTE, 0,
+                MPI_COMM_WORLD);
+
+    std::stable_sort(all.begin(), all.end(), [](const PackedRecord& a, const PackedRecord& b) {
+        return std::tie(a.timeFirstTxNs, a.source, a.destination) < std::tie(b.timeFirstTxNs, b.source, b.destination);
+    });
+
+    std::vector<FlowRecord> records;
+    records.reserve(all.size());
+    for (const PackedRecord& p : all) {
+        FlowRecord record;
+        record.flowId = static_cast<uint32_t>(records.size() + 1);
+        record.source = Ipv4Address(p.source);
+        record.destination = Ipv4Address(p.destination);
+        record.protocol = static_cast<uint8_t>(p.protocol);
+        record.txPackets = p.txPackets;
+        record.rxPackets = p.rxPackets;
+        record.lostPackets = p.lostPackets;
+        record.txBytes = p.txBytes;
+        record.rxBytes = p.rxBytes;
+        record.delaySum = NanoSeconds(p.delaySumNs);
+        record.timeFirstTxPacket = NanoSeconds(p.timeFirstTxNs);
+        record.timeLastRxPacket = NanoSeconds(p.timeLastRxNs);
+        records.push_back(record);
+    }
+    return records;
+}
+#endif
+
+// *********************************************************************************
+// ***************************** MICROBENCHMARKS ***********************************
+// *********************************************************************************
+
+// operator new/delete globales con contador: los microbenchmarks cuentan las asignaciones
+// reales de cada bucle (AllocCounter). Fuera de ellos solo cuesta comprobar g_countAllocs.
+static bool g_countAllocs = false;
+static uint64_t g_allocCount = 0;
+static uint64_t g_allocBytes = 0;
+
+void* operator new(std::size_t size) {
+    if (g_countAllocs) {
+        g_allocCount++;
+        g_allocBytes += size;
+    }
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Asignaciones hechas entre Start() y Stop()
+struct AllocCounter {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+
+    void Start() {
+        g_allocCount = 0;
+        g_allocBytes = 0;
+        g_countAllocs = true;
+    }
+
+    void Stop() {
+        g_countAllocs = false;
+        count = g_allocCount;
+        bytes = g_allocBytes;
+    }
+};
+
+// Tablas del PoFiAp antes (std::map, reconstrucción de las tablas anteriores) y después (los
+// métodos reales del PoFiAp: StoreStationTos, FlowPriority, RecordReceived, LookupStationTos,
+// InstallFlowMod y RecordSent): mismo patrón de acceso que Ipv4PacketReceived + HandleRead +
+// ForwardPacket para cada paquete de 100 STAs en una /24, con las mismas claves en ambos.
+void MicrobenchTables(uint32_t nPackets) {
+    const uint32_t nStas = 100;
+    const uint32_t subnetBase = Ipv4Address("192.168.1.0").Get();
+    const uint8_t tosByAc[4] = {0xe0, 0xa0, 0x60, 0x20};
+    const uint32_t acRatio = 4;
+
+    std::vector<Ipv4Address> sources(nStas);
+    for (uint32_t i = 0; i < nStas; ++i) {
+        sources[i] = Ipv4Address(subnetBase + i + 1);
+    }
+
+    KDNController controller;
+    uint64_t checksum = 0;
+    const double latencyMs = 1.0;
+
+    // --- Antes: árboles rojo-negro ---
+    std::map<Ipv4Address, uint8_t> tosMap;
+    std::map<uint8_t, KDNController::FlowMod> tosRegistry;
+    std::map<KDNController::Priority, PoFiAp::Metrics> metricsMap;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < nPackets; ++n) {
+        uint32_t sta = n % nStas;
+        uint8_t tos = tosByAc[sta % acRatio];
+        tosMap[sources[sta]] = tos;
+        KDNController::Priority rxPriority = tosRegistry.count(tos) ? tosRegistry[tos].priority : KDNController::LOW;
+        PoFiAp::Metrics& rxMetrics = metricsMap[rxPriority];
+        rxMetrics.packetsReceived++;
+        rxMetrics.bytesReceived += PacketSize;
+        uint8_t lookedUp = tosMap[sources[sta]];
+        if (tosRegistry.find(lookedUp) == tosRegistry.end()) {
+            tosRegistry[lookedUp] = controller.PacketIn(lookedUp, sources[sta]);
+        }
+        PoFiAp::Metrics& txMetrics = metricsMap[tosRegistry[lookedUp].priority];
+        txMetrics.packetsSent++;
+        txMetrics.bytesSent += PacketSize;
+        if (txMetrics.packetsSent > 1) {
+            txMetrics.jitterTotal += std::abs(latencyMs - txMetrics.latencyTotal / (txMetrics.packetsSent - 1));
+        }
+        txMetrics.latencyTotal += latencyMs;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (const auto& [priority, m] : metricsMap) {
+        checksum += m.packetsReceived + m.packetsSent;
+    }
+
+    // --- Después: tablas del PoFiAp (sin arrancar la aplicación: subred fijada a mano) ---
+    Ptr<PoFiAp> ap = CreateObject<PoFiAp>();
+    ap->SetStationSubnet(Ipv4Address(subnetBase), 0xff);
+
+    auto t2 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < nPackets; ++n) {
+        uint32_t sta = n % nStas;
+        uint8_t tos = tosByAc[sta % acRatio];
+        ap->StoreStationTos(sources[sta], tos);
+        ap->RecordReceived(ap->FlowPriority(tos), PacketSize);
+        uint8_t lookedUp = ap->LookupStationTos(sources[sta]);
+        if (!ap->HasFlowMod(lookedUp)) {
+            ap->InstallFlowMod(lookedUp, controller.PacketIn(lookedUp, sources[sta]));
+        }
+        ap->RecordSent(ap->FlowPriority(lookedUp), PacketSize, latencyMs);
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    for (const auto& m : ap->metricsTable) {
+        checksum += m.packetsReceived + m.packetsSent;
+    }
+
+    double mapNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / nPackets;
+    double flatNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / nPackets;
+    std::cout << "=== Microbenchmark: PoFiAp tables (" << nPackets << " packets, " << nStas << " STAs) ===\n";
+    std::cout << "std::map tables:  " << std::fixed << std::setprecision(2) << mapNs << " ns/packet\n";
+    std::cout << "Flat tables:      " << flatNs << " ns/packet\n";
+    std::cout << "Speedup:          " << (flatNs > 0 ? mapNs / flatNs : 0.0) << "x\n";
+    std::cout << "(checksum " << checksum << ")\n";
+}
+
+// Clasificación en Ipv4PacketReceived: Copy()+RemoveHeader() frente a PeekHeader() sobre el paquete const.
+void MicrobenchRxPeek(uint32_t nPackets) {
+    Ipv4Header header;
+    header.SetSource(Ipv4Address("192.168.1.10"));
+    header.SetDestination(Ipv4Address("192.168.1.101"));
+    header.SetTos(0xe0);
+    header.SetProtocol(UdpL4Protocol::PROT_NUMBER);
+    header.SetPayloadSize(PacketSize);
+    Ptr<Packet> received = Create<Packet>(PacketSize);
+    received->AddHeader(header);
+    Ptr<const Packet> packet = received;
+
+    uint64_t checksum = 0;
+    AllocCounter copyAllocs;
+    AllocCounter peekAllocs;
+
+    // Tiempo y asignaciones en pasadas separadas: el contador no entra en la medida de tiempo
+    auto copyPath = [&]() {
+        for (uint32_t n = 0; n < nPackets; ++n) {
+            Ipv4Header ipHeader;
+            Ptr<Packet> copy = packet->Copy();
+            copy->RemoveHeader(ipHeader);
+            checksum += ipHeader.GetTos() + ipHeader.GetSource().Get();
+        }
+    };
+    auto peekPath = [&]() {
+        for (uint32_t n = 0; n < nPackets; ++n) {
+            Ipv4Header ipHeader;
+            packet->PeekHeader(ipHeader);
+            checksum += ipHeader.GetTos() + ipHeader.GetSource().Get();
+        }
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    copyPath();
+    auto t1 = std::chrono::steady_clock::now();
+    peekPath();
+    auto t2 = std::chrono::steady_clock::now();
+
+    copyAllocs.Start();
+    copyPath();
+    copyAllocs.Stop();
+    peekAllocs.Start();
+    peekPath();
+    peekAllocs.Stop();
+
+    double copyNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / nPackets;
+    double peekNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / nPackets;
+    std::cout << "=== Microbenchmark: PoFiAp Rx classification (" << nPackets << " packets of "
+              << PacketSize << " B) ===\n";
+    std::cout << "Copy+RemoveHeader: " << std::fixed << std::setprecision(2) << copyNs << " ns/packet, "
+              << double(copyAllocs.count) / nPackets << " allocations/packet ("
+              << double(copyAllocs.bytes) / nPackets << " B/packet)\n";
+    std::cout << "PeekHeader:        " << peekNs << " ns/packet, "
+              << double(peekAllocs.count) / nPackets << " allocations/packet ("
+              << double(peekAllocs.bytes) / nPackets << " B/packet)\n";
+    std::cout << "Speedup:           " << (peekNs > 0 ? copyNs / peekNs : 0.0) << "x\n";
+    std::cout << "(checksum " << checksum << ")\n";
+}
+
+// Colas por clase antes (std::priority_queue/std::queue con copias de QueueItem) y después
+// (RingQueue con movimiento): nPackets repartidos en ráfagas sobre las 4 clases, encolar y vaciar.
+void MicrobenchQueues(uint32_t nPackets) {
+    const uint32_t burst = 64;
+    const uint8_t tosByClass[PoFiAp::N_EDCA_SLOTS] = {0xe0, 0xa0, 0x60, 0x20};
+    const Ipv4Address sender("192.168.1.10");
+    Ptr<Packet> packet = Create<Packet>(PacketSize);
+    uint64_t checksum = 0;
+
+    // --- Antes: contenedores estándar, QueueItem copiado al encolar y al desencolar ---
+    std::priority_queue<PoFiAp::QueueItem> highQueue;
+    std::priority_queue<PoFiAp::QueueItem> mediumQueue;
+    std::queue<PoFiAp::QueueItem> lowQueue;
+    std::queue<PoFiAp::QueueItem> nrtQueue;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < nPackets; n += burst) {
+        for (uint32_t i = 0; i < burst; ++i) {
+            uint32_t cls = (n + i) % PoFiAp::N_EDCA_SLOTS;
+            PoFiAp::QueueItem item{tosByClass[cls], packet, sender, NanoSeconds(n + i)};
+            switch (cls) {
+                case 0:  highQueue.push(item); break;
+                case 1:  mediumQueue.push(item); break;
+                case 2:  lowQueue.push(item); break;
+                default: nrtQueue.push(item); break;
+            }
+        }
+        while (!highQueue.empty()) {
+            PoFiAp::QueueItem item = highQueue.top();
+            highQueue.pop();
+            checksum += item.tos;
+        }
+        while (!mediumQueue.empty()) {
+            PoFiAp::QueueItem item = mediumQueue.top();
+            mediumQueue.pop();
+            checksum += item.tos;
+        }
+        while (!lowQueue.empty()) {
+            PoFiAp::QueueItem item = lowQueue.front();
+            lowQueue.pop();
+            checksum += item.tos;
+        }
+        while (!nrtQueue.empty()) {
+            PoFiAp::QueueItem item = nrtQueue.front();
+            nrtQueue.pop();
+            checksum += item.tos;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    // --- Después: buffers circulares preasignados, QueueItem movido ---
+    std::array<RingQueue<PoFiAp::QueueItem>, PoFiAp::N_EDCA_SLOTS> queues;
+
+    auto t2 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < nPackets; n += burst) {
+        for (uint32_t i = 0; i < burst; ++i) {
+            uint32_t cls = (n + i) % PoFiAp::N_EDCA_SLOTS;
+            queues[cls].push(PoFiAp::QueueItem{tosByClass[cls], packet, sender, NanoSeconds(n + i)});
+        }
+        for (RingQueue<PoFiAp::QueueItem>& queue : queues) {
+            while (!queue.empty()) {
+                PoFiAp::QueueItem item = queue.pop();
+                checksum += item.tos;
+            }
+        }
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    double stdNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / nPackets;
+    double ringNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / nPackets;
+    std::cout << "=== Microbenchmark: PoFiAp class queues (" << nPackets << " packets, bursts of "
+              << burst << ") ===\n";
+    std::cout << "priority_queue/queue: " << std::fixed << std::setprecision(2) << stdNs << " ns/packet ("
+              << (stdNs > 0 ? 1e3 / stdNs : 0.0) << " Mpkt/s)\n";
+    std::cout << "RingQueue:            " << ringNs << " ns/packet ("
+              << (ringNs > 0 ? 1e3 / ringNs : 0.0) << " Mpkt/s)\n";
+    std::cout << "Speedup:              " << (ringNs > 0 ? stdNs / ringNs : 0.0) << "x\n";
+    std::cout << "(checksum " << checksum << ")\n";
+}
+
+int RunMicrobench(const std::string& name) {
+    if (name == "tables") {
+        MicrobenchTables(1000000);
+        return 0;
+    }
+    if (name == "rxpeek") {
+        MicrobenchRxPeek(1000000);
+        return 0;
+    }
+    if (name == "queues") {
+        MicrobenchQueues(100000);
+        return 0;
+    }
+    std::cerr << "Error: microbench desconocido '" << name << "'\n";
+    return 1;
 }
@@ -0,0 +1,371 @@
+// Modelo sustituto compartido por sdwn.cc (KDNController) y cw_search.cc: el Random Forest de
+// IA/RF Model.py exportado por IA/04_Export_Model.py (.sdwnrf), el coste de IA/Inteligen_Agent.py
+// y la búsqueda por coordenadas sobre la rejilla de CW. Solo biblioteca estándar, sin ns-3.
+#ifndef SDWN_SURROGATE_MODEL_H
+#define SDWN_SURROGATE_MODEL_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Entero sin signo de 32 bits ocupando todo el campo; std::invalid_argument/out_of_range si no.
+// Filas de CSV y argumentos numéricos de sdwn.cc (manifest, forkConfigs) y cw_search.cc
+inline uint32_t ParseUint32Field(const std::string& field) {
+    size_t used = 0;
+    unsigned long value = std::stoul(field, &used);
+    if (used != field.size() || field[0] == '-') {
+        throw std::invalid_argument(field);
+    }
+    if (value > std::numeric_limits<uint32_t>::max()) {
+        throw std::out_of_range(field);
+    }
+    return static_cast<uint32_t>(value);
+}
+
+// *********************************************************************************
+// ********************************* TreeEnsemble **********************************
+// *********************************************************************************
+// Los nodos de todos los árboles van en un único array contiguo con los hijos de cada nodo
+// adyacentes. Al cargar, cada hoja pasa a apuntarse a sí misma con umbral +inf, así un bloque
+// de filas desciende en paralelo exactamente depth[árbol] pasos de "node = child + (x > thr)",
+// sin saltos condicionales: el bucle interno sobre filas es vectorizable (gather).
+class TreeEnsemble {
+    public:
+        static constexpr size_t BATCH = 64;    // Filas que descienden juntas por cada árbol
+
+        bool Load(const std::string& path, std::string& error) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in.is_open()) {
+                error = "no se pudo abrir " + path;
+                return false;
+            }
+            char magic[8];
+            uint32_t header[5];
+            if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, "SDWNRF1", 8) != 0
+                || !in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+                error = path + " no es un modelo .sdwnrf";
+                return false;
+            }
+            const uint32_t nFeatures = header[0];
+            m_nTargets = header[1];
+            const uint32_t nTrees = header[2];
+            const uint32_t nNodes = header[3];
+            const uint32_t nLeaves = header[4];
+
+            auto readStrings = [&in](std::vector<std::string>& names, uint32_t n) {
+                names.resize(n);
+                for (std::string& name : names) {
+                    uint32_t len = 0;
+                    if (!in.read(reinterpret_cast<char*>(&len), sizeof(len)) || len > 256) {
+                        return false;
+                    }
+                    name.resize(len);
+                    if (!in.read(&name[0], len)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            auto readArray = [&in](auto& values, size_t n) {
+                values.resize(n);
+                return static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), n * sizeof(values[0])));
+            };
+
+            if (!readStrings(m_features, nFeatures) || !readStrings(m_targets, m_nTargets)
+                || !readArray(m_roots, nTrees) || !readArray(m_nodes, nNodes)
+                || !readArray(m_leafValues, size_t(nLeaves) * m_nTargets)
+                || !readArray(m_robustCenter, m_nTargets) || !readArray(m_robustScale, m_nTargets)
+                || !readArray(m_ptMean, m_nTargets) || !readArray(m_ptScale, m_nTargets)
+                || !readArray(m_ptLambda, m_nTargets)) {
+                error = path + " truncado";
+                return false;
+            }
+
+            // Índices fuera de rango romperían el descenso sin comprobaciones
+            for (int32_t root : m_roots) {
+                if (root < 0 || uint32_t(root) >= nNodes) {
+                    error = path + ": raíz fuera de rango";
+                    return false;
+                }
+            }
+            for (const Node& node : m_nodes) {
+                bool valid = node.feature < 0
+                    ? node.child >= 0 && uint32_t(node.child) < nLeaves
+                    : uint32_t(node.feature) < nFeatures && node.child >= 0 && uint32_t(node.child) + 1 < nNodes;
+                if (!valid) {
+                    error = path + ": nodo inválido";
+                    return false;
+                }
+            }
+
+            // Hojas autorreferenciadas y profundidad de cada árbol
+            m_leafOf.assign(nNodes, 0);
+            for (uint32_t i = 0; i < nNodes; ++i) {
+                Node& node = m_nodes[i];
+                if (node.feature < 0) {
+                    m_leafOf[i] = node.child;
+                    node = {0, int32_t(i), std::numeric_limits<double>::infinity()};
+                }
+            }
+            m_depth.clear();
+            for (int32_t root : m_roots) {
+                uint32_t depth = 0;
+                std::vector<std::pair<int32_t, uint32_t>> stack{{root, 0}};
+                while (!stack.empty()) {
+                    auto [index, level] = stack.back();
+                    stack.pop_back();
+                    const Node& node = m_nodes[index];
+                    if (node.child == index) {
+                        depth = std::max(depth, level);
+                    } else if (level < nNodes) {
+                        stack.push_back({node.child, level + 1});
+                        stack.push_back({node.child + 1, level + 1});
+                    }
+                }
+                m_depth.push_back(depth);
+            }
+            return nTrees > 0;
+        }
+
+        int FeatureIndex(const std::string& name) const {
+            auto it = std::find(m_features.begin(), m_features.end(), name);
+            return it == m_features.end() ? -1 : int(it - m_features.begin());
+        }
+
+        int TargetIndex(const std::string& name) const {
+            auto it = std::find(m_targets.begin(), m_targets.end(), name);
+            return it == m_targets.end() ? -1 : int(it - m_targets.begin());
+        }
+
+        size_t NumFeatures() const { return m_features.size(); }
+        size_t NumTargets() const { return m_nTargets; }
+        size_t NumTrees() const { return m_roots.size(); }
+
+        // X: n filas de NumFeatures() float32 en el orden del modelo (sklearn compara en float32).
+        // out: n filas de outputs.size() valores en unidades originales (RobustScaler y
+        // Yeo-Johnson invertidos), solo para los targets pedidos.
+        void PredictBatch(const float* X, size_t n, const std::vector<uint32_t>& outputs, double* out) const {
+            const size_t nFeatures = m_features.size();
+            const size_t nOutputs = outputs.size();
+            std::fill(out, out + n * nOutputs, 0.0);
+            std::array<int32_t, BATCH> node;
+
+            for (size_t base = 0; base < n; base += BATCH) {
+                const size_t rows = std::min(BATCH, n - base);
+                const float* xb = X + base * nFeatures;
+                double* ob = out + base * nOutputs;
+                for (size_t tree = 0; tree < m_roots.size(); ++tree) {
+                    std::fill(node.begin(), node.begin() + rows, m_roots[tree]);
+                    for (uint32_t level = 0; level < m_depth[tree]; ++level) {
+                        for (size_t r = 0; r < rows; ++r) {
+                            const Node& nd = m_nodes[node[r]];
+                            node[r] = nd.child + (xb[r * nFeatures + nd.feature] > nd.threshold);
+                        }
+                    }
+                    for (size_t r = 0; r < rows; ++r) {
+                        const double* leaf = &m_leafValues[size_t(m_leafOf[node[r]]) * m_nTargets];
+                        for (size_t k = 0; k < nOutputs; ++k) {
+                            ob[r * nOutputs + k] += leaf[outputs[k]];
+                        }
+                    }
+                }
+            }
+
+            const double invTrees = 1.0 / m_roots.size();
+            for (size_t r = 0; r < n; ++r) {
+                for (size_t k = 0; k < nOutputs; ++k) {
+                    const uint32_t t = outputs[k];
+                    double& v = out[r * nOutputs + k];
+                    double y = v * invTrees * m_robustScale[t] + m_robustCenter[t];
+                    v = YeoJohnsonInverse(y * m_ptScale[t] + m_ptMean[t], m_ptLambda[t]);
+                }
+            }
+        }
+
+    private:
+        struct Node {
+            int32_t feature;        // -1 en hojas (en el archivo)
+            int32_t child;          // Hijo izquierdo (el derecho es child + 1) o índice de hoja
+            double threshold;
+        };
+        static_assert(sizeof(Node) == 16, "Node debe coincidir con NODE_DTYPE del exportador");
+
+        // Misma inversa que sklearn PowerTransformer(method='yeo-johnson')
+        static double YeoJohnsonInverse(double x, double lambda) {
+            const double eps = std::numeric_limits<double>::epsilon();
+            if (x >= 0) {
+                return std::abs(lambda) < eps ? std::expm1(x) : std::pow(x * lambda + 1, 1 / lambda) - 1;
+            }
+            return std::abs(lambda - 2) > eps ? 1 - std::pow(-(2 - lambda) * x + 1, 1 / (2 - lambda))
+                                              : -std::expm1(-x);
+        }
+
+        std::vector<std::string> m_features;
+        std::vector<std::string> m_targets;
+        uint32_t m_nTargets = 0;
+        std::vector<int32_t> m_roots;
+        std::vector<uint32_t> m_depth;
+        std::vector<Node> m_nodes;
+        std::vector<int32_t> m_leafOf;      // Índice de hoja de los nodos hoja
+        std::vector<double> m_leafValues;
+        std::vector<double> m_robustCenter;
+        std::vector<double> m_robustScale;
+        std::vector<double> m_ptMean;
+        std::vector<double> m_ptScale;
+        std::vector<double> m_ptLambda;
+};
+
+// *********************************************************************************
+// ****************************** SurrogateObjective *******************************
+// *********************************************************************************
+// Coste de IA/Inteligen_Agent.py: sum_p w_p (0.4 Delay_p_mean + 0.2 Delay_p_std + 0.4 LostPackets_p_mean)
+// con w = 0.35 (H), 0.35 (M), 0.30 (L); NRT se predice para el informe pero no pesa.
+class SurrogateObjective {
+    public:
+        // Orden de IA/RF Model.py; los CW van como CWminH, CWmaxH, ..., CWminNRT, CWmaxNRT
+        static constexpr std::array<const char*, 14> FEATURES {{
+            "Packet Size", "nStaWifi", "nStaH", "nStaM", "nStaL", "nStaNRT",
+            "CWminH", "CWmaxH", "CWminM", "CWmaxM", "CWminL", "CWmaxL", "CWminNRT", "CWmaxNRT"
+        }};
+        static constexpr std::array<const char*, 4> CLASSES {{"H", "M", "L", "NRT"}};
+        static constexpr std::array<double, 4> WEIGHTS {{0.35, 0.35, 0.30, 0.0}};
+        static constexpr std::array<uint32_t, 9> CW_GRID {{3, 7, 15, 31, 63, 127, 255, 511, 1023}};
+        static constexpr uint32_t N_PAIRS = 36;     // Pares (min, max) de CW_GRID con min < max
+        typedef std::array<uint32_t, 8> Cw;         // CWmin/CWmax por clase H, M, L, NRT
+
+        // Salidas por fila: Delay_mean, Delay_std, LostPackets_mean de cada clase
+        static constexpr size_t OUTPUTS_PER_CLASS = 3;
+
+        bool Bind(const TreeEnsemble& model, std::string& error) {
+            m_model = &model;
+            for (size_t f = 0; f < FEATURES.size(); ++f) {
+                m_featureIndex[f] = model.FeatureIndex(FEATURES[f]);
+                if (m_featureIndex[f] < 0) {
+                    error = std::string("feature ausente en el modelo: ") + FEATURES[f];
+                    return false;
+                }
+            }
+            m_outputs.clear();
+            for (const char* cls : CLASSES) {
+                for (const std::string& name : {"Delay_" + std::string(cls) + "_mean", "Delay_" + std::string(cls) + "_std",
+                                                "LostPackets_" + std::string(cls) + "_mean"}) {
+                    int index = model.TargetIndex(name);
+                    if (index < 0) {
+                        error = "target ausente en el modelo: " + name;
+                        return false;
+                    }
+                    m_outputs.push_back(uint32_t(index));
+                }
+            }
+            return true;
+        }
+
+        const TreeEnsemble& Model() const { return *m_model; }
+        const std::vector<uint32_t>& Outputs() const { return m_outputs; }
+        size_t NumFeatures() const { return m_model->NumFeatures(); }
+
+        // Par p-ésimo (min < max) de la rejilla
+        static std::pair<uint32_t, uint32_t> Pair(uint32_t p) {
+            for (uint32_t i = 0; i + 1 < CW_GRID.size(); ++i) {
+                uint32_t count = CW_GRID.size() - 1 - i;
+                if (p < count) {
+                    return {CW_GRID[i], CW_GRID[i + 1 + p]};
+                }
+                p -= count;
+            }
+            return {CW_GRID.front(), CW_GRID.back()};
+        }
+
+        void SetScenario(float* x, uint32_t packetSize, const std::array<uint32_t, 4>& stas) const {
+            x[m_featureIndex[0]] = float(packetSize);
+            x[m_featureIndex[1]] = float(stas[0] + stas[1] + stas[2] + stas[3]);
+            for (uint32_t p = 0; p < 4; ++p) {
+                x[m_featureIndex[2 + p]] = float(stas[p]);
+            }
+        }
+
+        void SetCw(float* x, const Cw& cw) const {
+            for (uint32_t i = 0; i < cw.size(); ++i) {
+                x[m_featureIndex[6 + i]] = float(cw[i]);
+            }
+        }
+
+        // y: una fila de Outputs()
+        static double Cost(const double* y) {
+            double cost = 0.0;
+            for (uint32_t p = 0; p < CLASSES.size(); ++p) {
+                const double* cls = y + p * OUTPUTS_PER_CLASS;
+                cost += WEIGHTS[p] * (0.4 * cls[0] + 0.2 * cls[1] + 0.4 * cls[2]);
+            }
+            return cost;
+        }
+
+    private:
+        const TreeEnsemble* m_model = nullptr;
+        std::array<int, FEATURES.size()> m_featureIndex{};
+        std::vector<uint32_t> m_outputs;
+};
+
+// Resultado de una búsqueda: CW, coste y predicciones (Outputs()) del mejor punto
+struct CwSearchResult {
+    SurrogateObjective::Cw cw;
+    double score;
+    std::vector<double> prediction;
+    uint64_t evaluations;
+};
+
+// Descenso por coordenadas: cada clase prueba sus 36 pares en un único lote con las demás fijas,
+// hasta que ninguna mejora. start es el punto de partida.
+inline CwSearchResult CoordinateSearch(const SurrogateObjective& objective, uint32_t packetSize,
+                                       const std::array<uint32_t, 4>& stas, const SurrogateObjective::Cw& start) {
+    const size_t nFeatures = objective.NumFeatures();
+    const size_t nOutputs = objective.Outputs().size();
+    std::vector<float> X(SurrogateObjective::N_PAIRS * nFeatures, 0.0f);
+    std::vector<double> Y(SurrogateObjective::N_PAIRS * nOutputs);
+    for (uint32_t r = 0; r < SurrogateObjective::N_PAIRS; ++r) {
+        objective.SetScenario(&X[r * nFeatures], packetSize, stas);
+    }
+
+    CwSearchResult result{start, 0.0, std::vector<double>(nOutputs), 0};
+    objective.SetCw(X.data(), start);
+    objective.Model().PredictBatch(X.data(), 1, objective.Outputs(), result.prediction.data());
+    result.score = SurrogateObjective::Cost(result.prediction.data());
+    result.evaluations = 1;
+
+    for (uint32_t round = 0; round < 8; ++round) {
+        bool improved = false;
+        for (uint32_t cls = 0; cls < 4; ++cls) {
+            for (uint32_t r = 0; r < SurrogateObjective::N_PAIRS; ++r) {
+                SurrogateObjective::Cw candidate = result.cw;
+                std::tie(candidate[2 * cls], candidate[2 * cls + 1]) = SurrogateObjective::Pair(r);
+                objective.SetCw(&X[r * nFeatures], candidate);
+            }
+            objective.Model().PredictBatch(X.data(), SurrogateObjective::N_PAIRS, objective.Outputs(), Y.data());
+            result.evaluations += SurrogateObjective::N_PAIRS;
+            for (uint32_t r = 0; r < SurrogateObjective::N_PAIRS; ++r) {
+                double cost = SurrogateObjective::Cost(&Y[r * nOutputs]);
+                if (cost < result.score) {
+                    result.score = cost;
+                    std::tie(result.cw[2 * cls], result.cw[2 * cls + 1]) = SurrogateObjective::Pair(r);
+                    std::copy(&Y[r * nOutputs], &Y[(r + 1) * nOutputs], result.prediction.begin());
+                    improved = true;
+                }
+            }
+        }
+        if (!improved) {
+            break;
+        }
+    }
+    return result;
+}
+
+#endif